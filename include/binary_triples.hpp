@@ -0,0 +1,193 @@
+/*
+ * binary_triples.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_BINARY_TRIPLES_HPP
+#define RING_BINARY_TRIPLES_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ring {
+
+    //! Read-only memory mapping of a binary triple file.
+    /*!
+     * The file starts with a header (magic, number of triples and maximum ID of S, P and O) followed by
+     * one record of 3x32-bit unsigned integers (s, p, o) per triple, in the byte order of the machine.
+     */
+    class binary_triples {
+    public:
+        typedef uint64_t size_type;
+        typedef std::tuple<uint32_t, uint32_t, uint32_t> triple_type;
+
+        struct header_type {
+            char magic[8];
+            uint64_t n;
+            uint64_t max_s;
+            uint64_t max_p;
+            uint64_t max_o;
+        };
+
+        static const uint64_t header_size = sizeof(header_type);
+
+        static const char *magic() { return "RINGTRP"; }
+
+    private:
+        header_type m_header;
+        void *m_map = nullptr;
+        uint64_t m_map_size = 0;
+        const uint32_t *m_records = nullptr;
+
+        binary_triples(const binary_triples &) = delete;
+        binary_triples &operator=(const binary_triples &) = delete;
+
+    public:
+
+        //! Maps the given binary triple file.
+        explicit binary_triples(const std::string &file) {
+            int fd = open(file.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("Cannot open " + file);
+            struct stat st;
+            if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < header_size) {
+                close(fd);
+                throw std::runtime_error(file + " is not a binary triple file");
+            }
+            m_map_size = st.st_size;
+            m_map = mmap(nullptr, m_map_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (m_map == MAP_FAILED) {
+                m_map = nullptr;
+                throw std::runtime_error("Cannot map " + file);
+            }
+            std::memcpy(&m_header, m_map, header_size);
+            if (std::strncmp(m_header.magic, magic(), sizeof(m_header.magic)) != 0 ||
+                header_size + m_header.n * 3 * sizeof(uint32_t) > m_map_size) {
+                munmap(m_map, m_map_size);
+                m_map = nullptr;
+                throw std::runtime_error(file + " is not a binary triple file");
+            }
+            m_records = (const uint32_t *) ((const char *) m_map + header_size);
+            madvise(m_map, m_map_size, MADV_SEQUENTIAL);
+        }
+
+        ~binary_triples() {
+            if (m_map != nullptr) munmap(m_map, m_map_size);
+        }
+
+        size_type size() const { return m_header.n; }
+
+        uint64_t max_s() const { return m_header.max_s; }
+
+        uint64_t max_p() const { return m_header.max_p; }
+
+        uint64_t max_o() const { return m_header.max_o; }
+
+        //! i-th triple (s, p, o).
+        triple_type operator[](const size_type i) const {
+            return triple_type(m_records[3 * i], m_records[3 * i + 1], m_records[3 * i + 2]);
+        }
+
+        //! Copies the triples into D, which is resized once.
+        template<class t_triple>
+        void copy_to(std::vector<t_triple> &D) const {
+            D.resize(size());
+            for (size_type i = 0; i < size(); ++i) {
+                D[i] = t_triple(m_records[3 * i], m_records[3 * i + 1], m_records[3 * i + 2]);
+            }
+        }
+
+        //! Whether 'file' starts with the header of a binary triple file.
+        static bool is_binary(const std::string &file) {
+            std::ifstream in(file, std::ios::binary);
+            char m[8] = {0};
+            in.read(m, sizeof(m));
+            return in && std::strncmp(m, magic(), sizeof(m)) == 0;
+        }
+
+        //! Calls f(s, p, o) for every "s p o" line of a text dataset.
+        /*!
+        * This is the reading loop of build-index and convert, so both give the same triples. Reading stops at
+        * the first line that cannot be parsed. The records store 32-bit IDs, so larger IDs are rejected.
+        * \param dataset : text file.
+        * \param f       : function called with the IDs of every triple.
+        */
+        template<class t_f>
+        static void read_text(const std::string &dataset, t_f f) {
+            std::ifstream ifs(dataset);
+            if (!ifs) throw std::runtime_error("Cannot open " + dataset);
+            const uint64_t max_id = std::numeric_limits<uint32_t>::max();
+            uint64_t s, p, o, line = 0;
+            while (ifs >> s >> p >> o) {
+                ++line;
+                if (s > max_id || p > max_id || o > max_id) {
+                    throw std::runtime_error(dataset + ":" + std::to_string(line) + ": the IDs of the triples must be below 2^32");
+                }
+                f(s, p, o);
+            }
+        }
+
+        //! Converts a text dataset of "s p o" lines into a binary triple file.
+        /*!
+        * \param dataset : text file, read as build-index does (see read_text).
+        * \param file    : binary file to create.
+        * \returns the header of the new file.
+        */
+        static header_type convert(const std::string &dataset, const std::string &file) {
+            std::ofstream out(file, std::ios::binary | std::ios::trunc);
+            if (!out) throw std::runtime_error("Cannot create " + file);
+
+            header_type header;
+            std::memset(&header, 0, header_size);
+            std::strncpy(header.magic, magic(), sizeof(header.magic));
+            out.write((const char *) &header, header_size);
+
+            std::vector<uint32_t> buffer;
+            buffer.reserve(3 * (1 << 16));
+            read_text(dataset, [&](const uint64_t s, const uint64_t p, const uint64_t o) {
+                if (buffer.size() == buffer.capacity()) {
+                    out.write((const char *) buffer.data(), buffer.size() * sizeof(uint32_t));
+                    buffer.clear();
+                }
+                buffer.push_back(s);
+                buffer.push_back(p);
+                buffer.push_back(o);
+                header.max_s = std::max(header.max_s, s);
+                header.max_p = std::max(header.max_p, p);
+                header.max_o = std::max(header.max_o, o);
+                ++header.n;
+            });
+            out.write((const char *) buffer.data(), buffer.size() * sizeof(uint32_t));
+
+            out.seekp(0);
+            out.write((const char *) &header, header_size);
+            return header;
+        }
+    };
+}
+
+#endif //RING_BINARY_TRIPLES_HPP
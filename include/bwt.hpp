@@ -22,6 +22,7 @@
 #define BWT_T
 
 #include "configuration.hpp"
+#include "wavelet_matrix.hpp"
 
 using namespace std;
 
@@ -38,7 +39,7 @@ namespace ring {
         typedef sdsl::rank_support_v<> c_rank_type;
         typedef sdsl::select_support_mcl<1> c_select_1_type;
         typedef sdsl::select_support_mcl<0> c_select_0_type;
-        typedef sdsl::wm_int<bwt_bit_vector_t> bwt_type;//TODO: MALO, esto es wm type, no bwt type. o no?
+        typedef wavelet_matrix<bwt_bit_vector_t> bwt_type;//TODO: MALO, esto es wm type, no bwt type. o no?
 
     private:
         bwt_type m_L;
@@ -58,6 +59,18 @@ namespace ring {
             m_C_select0.set_vector(&m_C);
         }
 
+        //Building C and its rank and select structures
+        template<class t_C>
+        void build_C(const t_C &C) {
+            m_C = c_type(C[C.size() - 1] + 1 + C.size(), 0);
+            for (uint64_t i = 0; i < C.size(); i++) {
+                m_C[C[i] + i] = 1;
+            }
+            sdsl::util::init_support(m_C_rank, &m_C);
+            sdsl::util::init_support(m_C_select1, &m_C);
+            sdsl::util::init_support(m_C_select0, &m_C);
+        }
+
     public:
 
 
@@ -66,14 +79,14 @@ namespace ring {
         bwt(const sdsl::int_vector<> &L, const vector<uint64_t> &C) {
             //Building the wavelet matrix
             construct_im(m_L, L);
-            //Building C and its rank and select structures
-            m_C = c_type(C[C.size() - 1] + 1 + C.size(), 0);
-            for (uint64_t i = 0; i < C.size(); i++) {
-                m_C[C[i] + i] = 1;
-            }
-            sdsl::util::init_support(m_C_rank, &m_C);
-            sdsl::util::init_support(m_C_select1, &m_C);
-            sdsl::util::init_support(m_C_select0, &m_C);
+            build_C(C);
+        }
+
+        //! Builds the wavelet matrix from an L column stored on disk. C is read in order (see C_array).
+        template<class t_C>
+        bwt(sdsl::int_vector_buffer<> &L, const t_C &C) {
+            m_L = bwt_type(L, L.size());
+            build_C(C);
         }
 
 
@@ -146,56 +159,84 @@ namespace ring {
             return m_C_select1(v + 1) - v;
         }
 
-        inline uint64_t LF(uint64_t i) {
+        inline uint64_t LF(uint64_t i) const {
             uint64_t s = m_L[i];
             return get_C(s) + m_L.rank(i, s) - 1;
         }
 
-        uint64_t nElems(uint64_t val) {
+        uint64_t nElems(uint64_t val) const {
             return get_C(val + 1) - get_C(val);
         }
 
         pair<uint64_t, uint64_t>
-        backward_step(uint64_t left_end, uint64_t right_end, uint64_t value) {
-            return {m_L.rank(left_end, value), m_L.rank(right_end + 1, value) - 1};
+        backward_step(uint64_t left_end, uint64_t right_end, uint64_t value) const {
+            auto r = m_L.rank_pair(left_end, right_end + 1, value);
+            return {r.first, r.second - 1};
         }
 
-        inline uint64_t bsearch_C(uint64_t value) {
+        inline uint64_t bsearch_C(uint64_t value) const {
             return m_C_rank(m_C_select0(value + 1));
         }
 
 
-        inline uint64_t ranky(uint64_t pos, uint64_t val) {
+        inline uint64_t ranky(uint64_t pos, uint64_t val) const {
             return m_L.rank(pos, val);
         }
 
-        inline uint64_t rank(uint64_t pos, uint64_t val) {
+        inline uint64_t rank(uint64_t pos, uint64_t val) const {
             return m_L.rank(get_C(pos), val);
         }
 
-        inline uint64_t select(uint64_t _rank, uint64_t val) {
+        //! Number of occurrences of val in the range of pos in L, that is rank(pos + 1, val) - rank(pos, val).
+        inline uint64_t rank_in_range(uint64_t pos, uint64_t val) const {
+            auto r = m_L.rank_pair(get_C(pos), get_C(pos + 1), val);
+            return r.second - r.first;
+        }
+
+        inline uint64_t select(uint64_t _rank, uint64_t val) const {
             return m_L.select(_rank, val);
         }
 
-        inline std::pair<uint64_t, uint64_t> select_next(uint64_t pos, uint64_t val, uint64_t n_elems) {
+        inline std::pair<uint64_t, uint64_t> select_next(uint64_t pos, uint64_t val, uint64_t n_elems) const {
             return m_L.select_next(get_C(pos), val, n_elems);
         }
 
-        inline uint64_t min_in_range(uint64_t l, uint64_t r) {
+        //! Range of get_L() with the positions [l, r] of L, that is [l, r] (see rl_bwt).
+        inline sdsl::range_type heads_range(uint64_t l, uint64_t r) const {
+            return sdsl::range_type{{l, r}};
+        }
+
+        inline uint64_t min_in_range(uint64_t l, uint64_t r) const {
             return m_L.range_minimum_query(l, r);
         }
 
-        inline uint64_t range_next_value(uint64_t x, uint64_t l, uint64_t r) {
+        inline uint64_t range_next_value(uint64_t x, uint64_t l, uint64_t r) const {
             return m_L.range_next_value(x, l, r);
         }
 
+        //! range_next_value resuming from the path of the previous call on [l, r] kept in 'cursor'.
+        inline uint64_t range_next_value(uint64_t x, uint64_t l, uint64_t r, wm_range_cursor &cursor) const {
+            return m_L.range_next_value(x, l, r, cursor);
+        }
+
         std::vector<uint64_t>
         //inline void
-        values_in_range(uint64_t pos_min, uint64_t pos_max) {
+        values_in_range(uint64_t pos_min, uint64_t pos_max) const {
             //interval_symbols(L, pos_min, pos_max+1, k, values, r_i, r_j);
             return m_L.all_values_in_range(pos_min, pos_max);
         }
 
+        //! Distinct values in [pos_min, pos_max], written to 'values' reusing its capacity.
+        inline void values_in_range(uint64_t pos_min, uint64_t pos_max, std::vector<uint64_t> &values) const {
+            m_L.all_values_in_range(pos_min, pos_max, values);
+        }
+
+        //! Calls f(v) for every distinct value v in [pos_min, pos_max], in increasing order.
+        template<class t_f>
+        inline void values_in_range(uint64_t pos_min, uint64_t pos_max, t_f f) const {
+            m_L.for_each_value_in_range(pos_min, pos_max, f);
+        }
+
         // backward search for pattern of length 1
         pair<uint64_t, uint64_t> backward_search_1_interval(uint64_t P) const {
             return {get_C(P), get_C(P + 1) - 1};
@@ -203,7 +244,7 @@ namespace ring {
 
         // backward search for pattern of length 1
         pair<uint64_t, uint64_t> backward_search_1_rank(uint64_t P, uint64_t S) const {
-            return {m_L.rank(get_C(P), S), m_L.rank(get_C(P + 1), S)};
+            return m_L.rank_pair(get_C(P), get_C(P + 1), S);
         }
 
         // backward search for pattern PQ of length 2
@@ -216,7 +257,7 @@ namespace ring {
         pair<uint64_t, uint64_t>
         backward_search_2_rank(uint64_t P, uint64_t S, pair<uint64_t, uint64_t> &I) const {
             uint64_t c = get_C(P);
-            return {m_L.rank(c + I.first, S), m_L.rank(c + I.second, S)};
+            return m_L.rank_pair(c + I.first, c + I.second, S);
         }
 
         const bwt_type& get_L() const{
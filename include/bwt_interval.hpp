@@ -19,6 +19,7 @@
 #ifndef BWT_INTERVAL
 #define BWT_INTERVAL
 
+#include <memory>
 #include "bwt.hpp"
 
 
@@ -28,6 +29,10 @@ namespace ring {
         uint64_t r;
         uint64_t cur_val;  // current value within the interval
         uint64_t cur_rank;
+        //Path of the last next_value, which only speeds up the next one. It is allocated by the first next_value and
+        //kept when another interval is assigned to this one (the cursor checks its range), so an iterator allocates it
+        //once per interval and the copies of the engines (parallel_ltj) do not copy it.
+        mutable std::unique_ptr<wm_range_cursor> cursor;
 
     private:
 
@@ -75,6 +80,7 @@ namespace ring {
                 r = o.r;
                 cur_val = o.cur_val;
                 cur_rank = o.cur_rank;
+                if (!cursor) cursor = std::move(o.cursor);
             }
             return *this;
         }
@@ -84,28 +90,31 @@ namespace ring {
             std::swap(r, o.r);
             std::swap(cur_val, o.cur_val);
             std::swap(cur_rank, o.cur_rank);
+            cursor.swap(o.cursor);
         }
 
         template<class Bwt>
-        uint64_t begin(Bwt &B) {
+        uint64_t begin(const Bwt &B) const {
             return B.min_in_range(l, r);
         }
 
+        //! Smallest value >= val in the interval of B. Successive calls resume the search of the previous one.
         template<class Bwt>
-        uint64_t next_value(uint64_t val, Bwt &B) {
-            return B.range_next_value(val, l, r);
+        uint64_t next_value(uint64_t val, const Bwt &B) const {
+            if (!cursor) cursor.reset(new wm_range_cursor());
+            return B.range_next_value(val, l, r, *cursor);
         }
 
-        inline uint64_t end() {
+        inline uint64_t end() const {
             return 0;  // assumes 0 is not stored in the triples
         }
 
-        inline uint64_t get_cur_value() {
+        inline uint64_t get_cur_value() const {
             return cur_val;
         }
 
         inline std::pair<uint64_t, uint64_t>
-        get_stored_values() {
+        get_stored_values() const {
             return std::pair<uint64_t, uint64_t>(cur_val, cur_rank);
         }
 
@@ -0,0 +1,124 @@
+/*
+ * cancellation.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_CANCELLATION_HPP
+#define RING_CANCELLATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ring {
+
+    //! Cooperative cancellation of a join: a flag that any thread can set and an optional deadline.
+    /*!
+    * The token is shared by the caller and the threads evaluating the join, which check it while
+    * they search (see cancellation_check). It must outlive the join.
+    */
+    class cancellation_token {
+    public:
+        typedef std::chrono::steady_clock clock_type;
+        typedef clock_type::time_point time_point_type;
+
+    private:
+        std::atomic<bool> m_cancelled{false};
+        bool m_has_deadline = false;
+        time_point_type m_deadline;
+
+        cancellation_token(const cancellation_token &) = delete;
+        cancellation_token &operator=(const cancellation_token &) = delete;
+
+    public:
+        cancellation_token() = default;
+
+        //! Constructor
+        /*!
+        * \param timeout_millis : time in milliseconds from now until the join is cancelled (0 = no timeout).
+        */
+        explicit cancellation_token(const uint64_t timeout_millis) {
+            set_timeout(timeout_millis);
+        }
+
+        //! Cancels the join 'timeout_millis' milliseconds from now, or before if a previous deadline is earlier.
+        /*!
+        * It must be called before the join starts. A timeout of 0 does not change the deadline.
+        */
+        void set_timeout(const uint64_t timeout_millis) {
+            if (timeout_millis == 0) return;
+            time_point_type deadline = clock_type::now() + std::chrono::milliseconds(timeout_millis);
+            if (!m_has_deadline || deadline < m_deadline) {
+                m_deadline = deadline;
+                m_has_deadline = true;
+            }
+        }
+
+        //! Cancels the join. It can be called from any thread.
+        void cancel() {
+            m_cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        inline bool cancelled() const {
+            return m_cancelled.load(std::memory_order_relaxed);
+        }
+
+        //! True if the join was cancelled or its deadline has passed, which cancels it.
+        bool expired() {
+            if (cancelled()) return true;
+            if (m_has_deadline && clock_type::now() >= m_deadline) {
+                cancel();
+                return true;
+            }
+            return false;
+        }
+    };
+
+    //! Checks a cancellation token during a search.
+    /*!
+    * The flag of the token is read at every step, which is a relaxed atomic load, while the
+    * clock is only read every 'steps' steps. Every thread of a join has its own check.
+    */
+    class cancellation_check {
+    public:
+        static const uint32_t steps = 1024;
+
+    private:
+        cancellation_token *m_token = nullptr;
+        uint32_t m_countdown = steps;
+
+    public:
+        cancellation_check() = default;
+
+        explicit cancellation_check(cancellation_token *token) : m_token(token) {}
+
+        cancellation_token *token() const {
+            return m_token;
+        }
+
+        //! True if the search has to stop.
+        inline bool stop() {
+            if (m_token == nullptr) return false;
+            if (--m_countdown == 0) {
+                m_countdown = steps;
+                return m_token->expired();
+            }
+            return m_token->cancelled();
+        }
+    };
+}
+
+#endif //RING_CANCELLATION_HPP
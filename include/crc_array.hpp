@@ -20,7 +20,10 @@
 #define CRC_ARRAY
 
 #include "configuration.hpp"
+#include <array>
 #include <exception> // std::exception
+#include <mutex>
+#include <type_traits>
 #include <unordered_map>
 
 
@@ -33,20 +36,26 @@ namespace ring {
             typedef sdsl::int_vector<>::value_type value_type;
             typedef sdsl::wm_int<bwt_bit_vector_t> wm_type; //TODO: no deberia ser typedef sdsl::wm_int<wm_bit_vector_t> y wm_type?
         private:
-            wm_type m_L;//Reference to BWT's L, useful for crc WM creation.
             wm_type m_crc_L;
-            std::unordered_map<std::string,uint64_t> weight_cache;//Used to cache CRC calculations with key='range.l+_+range.r'
+            //! Part of the weight cache guarded by its own mutex, so concurrent queries only contend on the same ranges.
+            struct cache_shard {
+                std::mutex mutex;
+                std::unordered_map<std::string,uint64_t> weights;
+            };
+            static const size_type cache_shards = 16;
+            mutable std::array<cache_shard, cache_shards> weight_cache;//Used to cache CRC calculations with key='range.l+_+range.r'
             void copy(const crc &o) {
-                m_L = o.m_L;
                 m_crc_L = o.m_crc_L;
             }
-            //! Buiding Colored Range Counting Array (CRC WM) based on the given Wavelet Matrix.
+            //! Buiding Colored Range Counting Array (CRC WM) based on the given column L.
             /*!
+            * L is only read through L[i] for increasing i, so it can be a wavelet matrix or a sequential reader (see crc(const t_L &)).
             * \returns boolean depending whether the CRC WM is created successfully or not. If true then the CRC WM are available as the 'crc_L' member.
             */
-            bool build_crc_wm(value_type x_s, value_type x_e){
-                sdsl::int_vector<> C(x_e - x_s);
-                //std::cout << "L.sigma : " << m_L.sigma << ", L.size() : " << m_L.size() << " x_s : " << x_s << " x_e : " << x_e << std::endl;
+            template<class t_L>
+            bool build_crc_wm(const t_L &L, value_type x_s, value_type x_e){
+                sdsl::int_vector<> C(x_e - x_s, 0, x_e ? sdsl::bits::hi(x_e) + 1 : 1); // its values are at most x_e
+                //std::cout << "L.sigma : " << L.sigma << ", L.size() : " << L.size() << " x_s : " << x_s << " x_e : " << x_e << std::endl;
                 //std::cout << "Building int vector to store CRC (size = " << C.size() << ")." << std::endl;
                 // O ( (x_e - x_s) * log sigma)
                 //  CORE >>
@@ -54,10 +63,11 @@ namespace ring {
                     std::unordered_map<value_type, value_type> hash_map;
                     for (value_type i = x_s; i < x_e; i++)
                     {
-                        auto it = hash_map.find(m_L[i]);
+                        const value_type c = L[i];
+                        auto it = hash_map.find(c);
                         if (it == hash_map.end())
                         {
-                            hash_map.insert({m_L[i], i});
+                            hash_map.insert({c, i});
                             // C positions must start from 0 until x_e - x_s.
                             C[i - x_s] = 0;
                             // std::cout << C[i - x_s] << " ";fflush(stdout);
@@ -93,34 +103,48 @@ namespace ring {
             }
         public:
             crc(){
-                weight_cache.reserve(100);
+                for(auto &shard : weight_cache){
+                    shard.weights.reserve(100 / cache_shards);
+                }
             };
-            crc(const wm_type &wm_l, bool build_index = true){
-                m_L = wm_l;
+            //! Builds the CRC WM of the column L.
+            /*!
+            * t_L only needs size() and L[i] read for increasing i: the L column of a bwt (whatever its bit vector)
+            * or the sequential reader of a run-length column.
+            */
+            template<class t_L, class = typename std::enable_if<!std::is_same<t_L, crc>::value>::type>
+            crc(const t_L &L, bool build_index = true){
                 if (build_index)
                 {
-                    build_crc_wm(0, m_L.size() - 1);
+                    build_crc_wm(L, 0, L.size() - 1);
                 }
             }
             void clear_cache(){
-                weight_cache.clear();
+                for(auto &shard : weight_cache){
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    shard.weights.clear();
+                }
             }
             /*
-            Includes previously weight cache.
+            Includes previously weight cache. Safe to call from concurrent queries: the count is done without holding the lock.
             */
-            value_type get_number_distinct_values_on_range(value_type x_s, value_type x_e, value_type rng_s, value_type rng_e){
+            value_type get_number_distinct_values_on_range(value_type x_s, value_type x_e, value_type rng_s, value_type rng_e) const{
                 uint64_t diff_vals = 0;
                 std::string key = std::to_string(x_s)+"_"+std::to_string(x_e);
                 //uint64_t key = x_s+x_e;
-                auto it=weight_cache.find(key);
-                if(it != weight_cache.end()){
-                    //std::cout << "Using cache..." << std::endl;
-                    diff_vals = it->second;
-                }else{
-                    //std::cout << "Counting..." << std::endl;
-                    diff_vals = m_crc_L.count_range_search_2d(x_s, x_e, rng_s, rng_e);
-                    weight_cache.emplace(key,diff_vals);
+                cache_shard &shard = weight_cache[(x_s * 31 + x_e) % cache_shards];
+                {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    auto it=shard.weights.find(key);
+                    if(it != shard.weights.end()){
+                        //std::cout << "Using cache..." << std::endl;
+                        return it->second;
+                    }
                 }
+                //std::cout << "Counting..." << std::endl;
+                diff_vals = m_crc_L.count_range_search_2d(x_s, x_e, rng_s, rng_e);
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.weights.emplace(key,diff_vals);
                 return diff_vals;
             }
             //! Calculates the number of different values on range [l,r).
@@ -129,7 +153,7 @@ namespace ring {
             * \param value_type r : right
             * \returns number of distinct values on range [l,r) the WMs.
             */
-        value_type get_number_distinct_values(value_type l, value_type r){
+        value_type get_number_distinct_values(value_type l, value_type r) const{
                 assert(l > 0);
                 assert(l <= r);
                 //std::cout << "Calling get_number_distinct_values with range : [" << l << ", " << r << "] length : " <<  (r - l) << std::endl;
@@ -170,7 +194,6 @@ namespace ring {
             //! Move Operator=
             crc &operator=(crc &&o) {
                 if (this != &o) {
-                    m_L = std::move(o.m_L);
                     m_crc_L = std::move(o.m_crc_L);
                 }
                 return *this;
@@ -178,7 +201,6 @@ namespace ring {
 
             void swap(crc &o) {
                 // m_bp.swap(bp_support.m_bp); use set_vector to set the supported bit_vector
-                std::swap(m_L, o.m_L);
                 std::swap(m_crc_L, o.m_crc_L);
             }
 
@@ -23,6 +23,7 @@
 #include <exception> // std::exception
 #include <unordered_map>
 #include "crc_array.hpp"
+#include "parallel.hpp"
 
 namespace ring {
     template <class bwt_bit_vector_t = sdsl::bit_vector>
@@ -32,6 +33,7 @@ namespace ring {
         typedef uint64_t value_type;
         typedef uint64_t size_type;
         typedef sdsl::wm_int<bwt_bit_vector_t> wm_type; //TODO: no deberia ser typedef sdsl::wm_int<wm_bit_vector_t> y wm_type?
+        typedef crc<> crc_type; // plain bit vectors whatever those of the ring (format of the .crc files); built from any column
     private:
         void copy(const crc_arrays &o) {
             spo_BWT_S = std::move(o.spo_BWT_S);
@@ -42,33 +44,62 @@ namespace ring {
             sop_BWT_O = std::move(o.sop_BWT_O);
             sop_BWT_P = std::move(o.sop_BWT_P);
         }
+        template<class t_L>
+        std::vector<parallel::task_type> spo_tasks(const t_L &spo_bwt_s_L,const t_L &spo_bwt_p_L,const t_L &spo_bwt_o_L)
+        {
+            return {
+                [&]() { spo_BWT_S = std::unique_ptr<crc_type>{new crc_type(spo_bwt_s_L)}; },
+                [&]() { spo_BWT_P = std::unique_ptr<crc_type>{new crc_type(spo_bwt_p_L)}; },
+                [&]() { spo_BWT_O = std::unique_ptr<crc_type>{new crc_type(spo_bwt_o_L)}; }
+            };
+        }
+        template<class t_L>
+        std::vector<parallel::task_type> sop_tasks(const t_L &sop_bwt_s_L,const t_L &sop_bwt_o_L,const t_L &sop_bwt_p_L)
+        {
+            return {
+                [&]() { sop_BWT_S = std::unique_ptr<crc_type>{new crc_type(sop_bwt_s_L)}; },
+                [&]() { sop_BWT_O = std::unique_ptr<crc_type>{new crc_type(sop_bwt_o_L)}; },
+                [&]() { sop_BWT_P = std::unique_ptr<crc_type>{new crc_type(sop_bwt_p_L)}; }
+            };
+        }
     public:
-        std::unique_ptr<crc<>> spo_BWT_S;
-        std::unique_ptr<crc<>> spo_BWT_P;
-        std::unique_ptr<crc<>> spo_BWT_O;
+        std::unique_ptr<crc_type> spo_BWT_S;
+        std::unique_ptr<crc_type> spo_BWT_P;
+        std::unique_ptr<crc_type> spo_BWT_O;
 
-        std::unique_ptr<crc<>> sop_BWT_S;
-        std::unique_ptr<crc<>> sop_BWT_P;
-        std::unique_ptr<crc<>> sop_BWT_O;
+        std::unique_ptr<crc_type> sop_BWT_S;
+        std::unique_ptr<crc_type> sop_BWT_P;
+        std::unique_ptr<crc_type> sop_BWT_O;
         crc_arrays() = default;
         void clear_cache(){
             sop_BWT_S->clear_cache();
             sop_BWT_P->clear_cache();
             sop_BWT_O->clear_cache();
         }
-        void build_spo_arrays(const wm_type &spo_bwt_s_L,const wm_type &spo_bwt_p_L,const wm_type &spo_bwt_o_L)
+        //! Builds the SPO arrays from the columns L, given as wavelet matrices or as run-length BWTs (rl_bwt).
+        template<class t_L>
+        void build_spo_arrays(const t_L &spo_bwt_s_L,const t_L &spo_bwt_p_L,const t_L &spo_bwt_o_L,
+                              const uint64_t threads = 1)
         {
-            spo_BWT_S = std::move(std::unique_ptr<crc<>>{new crc<>(spo_bwt_s_L)});
-            spo_BWT_P = std::move(std::unique_ptr<crc<>>{new crc<>(spo_bwt_p_L)});
-            spo_BWT_O = std::move(std::unique_ptr<crc<>>{new crc<>(spo_bwt_o_L)});
+            parallel::run_tasks(spo_tasks(spo_bwt_s_L, spo_bwt_p_L, spo_bwt_o_L), threads);
         }
-        void build_sop_arrays(const wm_type &sop_bwt_s_L,const wm_type &sop_bwt_o_L,const wm_type &sop_bwt_p_L)
+        template<class t_L>
+        void build_sop_arrays(const t_L &sop_bwt_s_L,const t_L &sop_bwt_o_L,const t_L &sop_bwt_p_L,
+                              const uint64_t threads = 1)
         {
-            sop_BWT_S = std::move(std::unique_ptr<crc<>>{new crc<>(sop_bwt_s_L)});
-            sop_BWT_O = std::move(std::unique_ptr<crc<>>{new crc<>(sop_bwt_o_L)});
-            sop_BWT_P = std::move(std::unique_ptr<crc<>>{new crc<>(sop_bwt_p_L)});
+            parallel::run_tasks(sop_tasks(sop_bwt_s_L, sop_bwt_o_L, sop_bwt_p_L), threads);
             //print_arrays();
         }
+        //! Builds the six CRC arrays at once, sharing a pool of 'threads' threads.
+        void build_arrays(const wm_type &spo_bwt_s_L,const wm_type &spo_bwt_p_L,const wm_type &spo_bwt_o_L,
+                          const wm_type &sop_bwt_s_L,const wm_type &sop_bwt_o_L,const wm_type &sop_bwt_p_L,
+                          const uint64_t threads = 1)
+        {
+            auto tasks = spo_tasks(spo_bwt_s_L, spo_bwt_p_L, spo_bwt_o_L);
+            auto sop = sop_tasks(sop_bwt_s_L, sop_bwt_o_L, sop_bwt_p_L);
+            tasks.insert(tasks.end(), sop.begin(), sop.end());
+            parallel::run_tasks(tasks, threads);
+        }
         void print_arrays()
         {
             std::cout << "spo S : "<< std::endl;
@@ -209,12 +240,12 @@ namespace ring {
         }
 
         void load(std::istream &in) {
-            spo_BWT_S = std::unique_ptr<crc<>>{new crc<>};
-            spo_BWT_P = std::unique_ptr<crc<>>{new crc<>};
-            spo_BWT_O = std::unique_ptr<crc<>>{new crc<>};
-            sop_BWT_S = std::unique_ptr<crc<>>{new crc<>};
-            sop_BWT_O = std::unique_ptr<crc<>>{new crc<>};
-            sop_BWT_P = std::unique_ptr<crc<>>{new crc<>};
+            spo_BWT_S = std::unique_ptr<crc_type>{new crc_type};
+            spo_BWT_P = std::unique_ptr<crc_type>{new crc_type};
+            spo_BWT_O = std::unique_ptr<crc_type>{new crc_type};
+            sop_BWT_S = std::unique_ptr<crc_type>{new crc_type};
+            sop_BWT_O = std::unique_ptr<crc_type>{new crc_type};
+            sop_BWT_P = std::unique_ptr<crc_type>{new crc_type};
 
             spo_BWT_S->load(in);
             spo_BWT_P->load(in);
@@ -0,0 +1,431 @@
+/*
+ * dense_ids.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_DENSE_IDS_HPP
+#define RING_DENSE_IDS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <sdsl/sd_vector.hpp>
+#include "query_parser.hpp"
+#include "result_sink.hpp"
+
+namespace ring {
+
+    //! A well-formed query that the index cannot evaluate.
+    class unsupported_query : public std::invalid_argument {
+    public:
+        explicit unsupported_query(const std::string &what) : std::invalid_argument(what) {}
+    };
+
+    //! Compact bidirectional map between the IDs that appear in a role and the dense IDs 1..sigma.
+    /*!
+    * The IDs are marked in a sparse bit vector, so the dense ID of an ID is its rank and the ID of a
+    * dense ID is its select.
+    */
+    class id_map {
+    public:
+        typedef uint64_t size_type;
+        typedef uint64_t value_type;
+        typedef sdsl::sd_vector<> ids_type;
+
+    private:
+        ids_type m_ids;
+        ids_type::rank_1_type m_rank;
+        ids_type::select_1_type m_select;
+        size_type m_sigma = 0;
+        sdsl::int_vector<> m_dense; // dense ID of the rank r at r - 1, empty if the dense ID is the rank
+        sdsl::int_vector<> m_rank_of; // rank of the dense ID d at d - 1
+
+        void copy(const id_map &o) {
+            m_ids = o.m_ids;
+            m_rank = o.m_rank;
+            m_rank.set_vector(&m_ids);
+            m_select = o.m_select;
+            m_select.set_vector(&m_ids);
+            m_sigma = o.m_sigma;
+            m_dense = o.m_dense;
+            m_rank_of = o.m_rank_of;
+        }
+
+    public:
+        id_map() = default;
+
+        //! Map of the IDs i with used[i] = 1.
+        explicit id_map(const sdsl::bit_vector &used) : m_ids(used) {
+            sdsl::util::init_support(m_rank, &m_ids);
+            sdsl::util::init_support(m_select, &m_ids);
+            m_sigma = m_rank(m_ids.size());
+        }
+
+        //! Copy constructor
+        id_map(const id_map &o) {
+            copy(o);
+        }
+
+        //! Move constructor
+        id_map(id_map &&o) {
+            *this = std::move(o);
+        }
+
+        //! Copy Operator=
+        id_map &operator=(const id_map &o) {
+            if (this != &o) {
+                copy(o);
+            }
+            return *this;
+        }
+
+        //! Move Operator=
+        id_map &operator=(id_map &&o) {
+            if (this != &o) {
+                m_ids = std::move(o.m_ids);
+                m_rank = std::move(o.m_rank);
+                m_rank.set_vector(&m_ids);
+                m_select = std::move(o.m_select);
+                m_select.set_vector(&m_ids);
+                m_sigma = o.m_sigma;
+                m_dense = std::move(o.m_dense);
+                m_rank_of = std::move(o.m_rank_of);
+            }
+            return *this;
+        }
+
+        //! Number of IDs of the map.
+        size_type size() const {
+            return m_sigma;
+        }
+
+        //! Dense ID of 'id', or 0 if 'id' does not appear.
+        value_type to_dense(const value_type id) const {
+            if (id >= m_ids.size() || !m_ids[id]) return 0;
+            const value_type r = m_rank(id + 1);
+            return m_dense.empty() ? r : m_dense[r - 1];
+        }
+
+        //! ID of the dense ID 'dense' (1..size()).
+        value_type to_id(const value_type dense) const {
+            return m_select(m_rank_of.empty() ? dense : m_rank_of[dense - 1]);
+        }
+
+        //! Assigns the dense IDs in the given order: order[k] (a current dense ID) becomes k + 1.
+        void reorder(const std::vector<value_type> &order) {
+            sdsl::int_vector<> dense(m_sigma, 0, sdsl::bits::hi(std::max<size_type>(m_sigma, 1)) + 1);
+            sdsl::int_vector<> rank_of(m_sigma, 0, dense.width());
+            for (size_type k = 0; k < m_sigma; ++k) {
+                const value_type r = m_rank_of.empty() ? order[k] : m_rank_of[order[k] - 1];
+                rank_of[k] = r;
+                dense[r - 1] = k + 1;
+            }
+            m_dense = std::move(dense);
+            m_rank_of = std::move(rank_of);
+        }
+
+        //! Serializes the data structure into the given ostream
+        size_type serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr, std::string name = "") const {
+            sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+            size_type written_bytes = 0;
+            written_bytes += m_ids.serialize(out, child, "ids");
+            written_bytes += m_rank.serialize(out, child, "rank");
+            written_bytes += m_select.serialize(out, child, "select");
+            written_bytes += sdsl::write_member(m_sigma, out, child, "sigma");
+            written_bytes += m_dense.serialize(out, child, "dense");
+            written_bytes += m_rank_of.serialize(out, child, "rank_of");
+            sdsl::structure_tree::add_size(child, written_bytes);
+            return written_bytes;
+        }
+
+        void load(std::istream &in) {
+            m_ids.load(in);
+            m_rank.load(in, &m_ids);
+            m_select.load(in, &m_ids);
+            sdsl::read_member(m_sigma, in);
+            m_dense.load(in);
+            m_rank_of.load(in);
+        }
+    };
+
+    //! Order of the dense IDs of a role (see dense_ids::reorder).
+    enum id_order_type {
+        rank_order = 0,   // the order of the IDs of the graph
+        degree_order = 1, // decreasing number of triples
+        bfs_order = 2     // breadth-first traversal of the graph of subjects and objects
+    };
+
+    //! Dense IDs of the subjects and objects, which share an ID space, and of the predicates.
+    /*!
+    * The rings size the alphabets of their columns by the largest ID, so remapping the IDs of a graph
+    * whose IDs are sparse (e.g. a global dictionary) into 1..sigma of each role shrinks the height of
+    * the wavelet matrices, and every rank, to ceil(log2 sigma) levels. The index built on the dense
+    * IDs keeps the maps in the file .ids; the constants of the queries are translated to dense IDs
+    * and the results back to the IDs of the graph. A variable cannot be both a predicate and a
+    * subject or object, since the two roles no longer share IDs. The dense IDs follow the order of
+    * the IDs of the graph unless they are reordered to improve the locality of the index (see reorder).
+    */
+    class dense_ids {
+    public:
+        typedef uint64_t size_type;
+        typedef uint64_t value_type;
+
+    private:
+        id_map m_so;
+        id_map m_p;
+
+        //! Dense IDs 1..degree.size() - 1 by decreasing degree (degree[0] is not used).
+        static std::vector<value_type> by_degree(const std::vector<size_type> &degree) {
+            std::vector<value_type> order(degree.size() - 1);
+            for (size_type d = 0; d < order.size(); ++d) order[d] = d + 1;
+            std::stable_sort(order.begin(), order.end(), [&degree](const value_type a, const value_type b) {
+                return degree[a] > degree[b];
+            });
+            return order;
+        }
+
+        //! Breadth-first order of the graph whose edges join the subject and the object of every triple.
+        /*!
+        * The roots are taken by decreasing degree, so every hub is followed by its neighbours, which
+        * share the ranges of C and the runs of L of the hub.
+        */
+        template<class t_triple>
+        std::vector<value_type> by_bfs(const std::vector<t_triple> &D, const std::vector<size_type> &degree) const {
+            const size_type sigma = m_so.size();
+            // Neighbours of every dense ID (CSR)
+            std::vector<size_type> start(sigma + 2, 0);
+            for (const auto &t : D) {
+                const value_type s = m_so.to_dense(std::get<0>(t)), o = m_so.to_dense(std::get<2>(t));
+                if (s == o) continue;
+                ++start[s + 1];
+                ++start[o + 1];
+            }
+            for (size_type d = 1; d < start.size(); ++d) start[d] += start[d - 1];
+            // Wide enough for any dense ID, and no wider
+            sdsl::int_vector<> neighbours(start[sigma + 1], 0, sigma ? sdsl::bits::hi(sigma) + 1 : 1);
+            {
+                std::vector<size_type> next(start.begin(), start.end() - 1);
+                for (const auto &t : D) {
+                    const value_type s = m_so.to_dense(std::get<0>(t)), o = m_so.to_dense(std::get<2>(t));
+                    if (s == o) continue;
+                    neighbours[next[s]++] = o;
+                    neighbours[next[o]++] = s;
+                }
+            }
+            std::vector<value_type> order;
+            order.reserve(sigma);
+            std::vector<bool> visited(sigma + 1, false);
+            for (const value_type root : by_degree(degree)) {
+                if (visited[root]) continue;
+                visited[root] = true;
+                order.push_back(root);
+                // The order is the queue of the traversal
+                for (size_type head = order.size() - 1; head < order.size(); ++head) {
+                    const value_type v = order[head];
+                    for (size_type i = start[v]; i < start[v + 1]; ++i) {
+                        const value_type u = neighbours[i];
+                        if (visited[u]) continue;
+                        visited[u] = true;
+                        order.push_back(u);
+                    }
+                }
+            }
+            return order;
+        }
+
+    public:
+        dense_ids() = default;
+
+        //! Maps of the IDs marked in 'so' (subjects and objects) and in 'p' (predicates).
+        dense_ids(const sdsl::bit_vector &so, const sdsl::bit_vector &p) : m_so(so), m_p(p) {}
+
+        //! Maps of the IDs that appear in the triples D.
+        template<class t_triple>
+        explicit dense_ids(const std::vector<t_triple> &D) {
+            uint64_t max_so = 0, max_p = 0;
+            for (const auto &t : D) {
+                max_so = std::max<uint64_t>(max_so, std::max(std::get<0>(t), std::get<2>(t)));
+                max_p = std::max<uint64_t>(max_p, std::get<1>(t));
+            }
+            sdsl::bit_vector so(max_so + 1, 0), p(max_p + 1, 0);
+            for (const auto &t : D) {
+                so[std::get<0>(t)] = 1;
+                p[std::get<1>(t)] = 1;
+                so[std::get<2>(t)] = 1;
+            }
+            m_so = id_map(so);
+            m_p = id_map(p);
+        }
+
+        //! Reorders the dense IDs of both roles by decreasing degree.
+        /*!
+        * \param degree_so : number of occurrences of every dense ID of the subjects and objects (index 0 unused).
+        * \param degree_p  : number of occurrences of every dense ID of the predicates (index 0 unused).
+        */
+        void reorder(const std::vector<size_type> &degree_so, const std::vector<size_type> &degree_p) {
+            m_so.reorder(by_degree(degree_so));
+            m_p.reorder(by_degree(degree_p));
+        }
+
+        //! Reorders the dense IDs of the triples D (with the IDs of the graph) to improve the locality of the index.
+        /*!
+        * Related subjects and objects get close IDs, so they share the ranges of C and lengthen the runs
+        * of the L columns. The predicates are ordered by decreasing degree.
+        */
+        template<class t_triple>
+        void reorder(const std::vector<t_triple> &D, const id_order_type order) {
+            if (order == rank_order) return;
+            std::vector<size_type> degree_so(m_so.size() + 1, 0), degree_p(m_p.size() + 1, 0);
+            for (const auto &t : D) {
+                ++degree_so[m_so.to_dense(std::get<0>(t))];
+                ++degree_p[m_p.to_dense(std::get<1>(t))];
+                ++degree_so[m_so.to_dense(std::get<2>(t))];
+            }
+            if (order == bfs_order) {
+                m_so.reorder(by_bfs(D, degree_so));
+                m_p.reorder(by_degree(degree_p));
+            } else {
+                reorder(degree_so, degree_p);
+            }
+        }
+
+        const id_map &so() const {
+            return m_so;
+        }
+
+        const id_map &p() const {
+            return m_p;
+        }
+
+        //! Triple t with dense IDs.
+        template<class t_triple>
+        t_triple remap(const t_triple &t) const {
+            return t_triple(m_so.to_dense(std::get<0>(t)), m_p.to_dense(std::get<1>(t)), m_so.to_dense(std::get<2>(t)));
+        }
+
+        //! Marks the variables of the query that are predicates, throwing unsupported_query if one is also a subject or object.
+        static std::vector<bool> predicate_variables(const bgp_query &query) {
+            std::vector<bool> is_p(query.number_of_variables(), false), is_so(query.number_of_variables(), false);
+            for (const auto &t : query.patterns) {
+                if (t.s_is_variable()) is_so[t.term_s.value] = true;
+                if (t.p_is_variable()) is_p[t.term_p.value] = true;
+                if (t.o_is_variable()) is_so[t.term_o.value] = true;
+            }
+            for (size_type v = 0; v < is_p.size(); ++v) {
+                if (is_p[v] && is_so[v]) {
+                    throw unsupported_query("?" + query.variable_names()[v] + " is both a predicate and a subject or object, which an index with dense IDs does not support");
+                }
+            }
+            return is_p;
+        }
+
+        //! Translates the constants of the query to dense IDs.
+        /*!
+        * \returns false if a constant does not appear in its role, so the query has no results.
+        */
+        bool to_dense(bgp_query &query) const {
+            predicate_variables(query);
+            bool found = true;
+            for (auto &t : query.patterns) {
+                if (!t.s_is_variable()) {
+                    t.term_s.value = m_so.to_dense(t.term_s.value);
+                    found = found && t.term_s.value;
+                }
+                if (!t.p_is_variable()) {
+                    t.term_p.value = m_p.to_dense(t.term_p.value);
+                    found = found && t.term_p.value;
+                }
+                if (!t.o_is_variable()) {
+                    t.term_o.value = m_so.to_dense(t.term_o.value);
+                    found = found && t.term_o.value;
+                }
+            }
+            return found;
+        }
+
+        //! Serializes the data structure into the given ostream
+        size_type serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr, std::string name = "") const {
+            sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+            size_type written_bytes = 0;
+            written_bytes += m_so.serialize(out, child, "so");
+            written_bytes += m_p.serialize(out, child, "p");
+            sdsl::structure_tree::add_size(child, written_bytes);
+            return written_bytes;
+        }
+
+        void load(std::istream &in) {
+            m_so.load(in);
+            m_p.load(in);
+        }
+    };
+
+    //! Passes the results of a query on dense IDs to 'sink' with the IDs of the graph.
+    class dense_ids_sink : public result_sink {
+    private:
+        const dense_ids &m_ids;
+        result_sink &m_sink;
+        std::vector<bool> m_is_p;
+        std::vector<value_type> m_row;
+        std::vector<std::vector<value_type>> m_lists;
+
+        //! The values of the variables that are not projected are 0, which is not a dense ID.
+        value_type to_id(const size_type var, const value_type dense) const {
+            if (dense == 0) return 0;
+            return m_is_p[var] ? m_ids.p().to_id(dense) : m_ids.so().to_id(dense);
+        }
+
+    public:
+        dense_ids_sink(const dense_ids &ids, const bgp_query &query, result_sink &sink)
+                : m_ids(ids), m_sink(sink), m_is_p(dense_ids::predicate_variables(query)) {}
+
+        void begin(const size_type width) override {
+            result_sink::begin(width);
+            m_row.resize(width);
+            m_sink.begin(width);
+        }
+
+        bool push(const value_type *row) override {
+            for (size_type v = 0; v < m_width; ++v) {
+                m_row[v] = to_id(v, row[v]);
+            }
+            return m_sink.push(m_row.data());
+        }
+
+        bool push_product(const value_type *row, const std::vector<size_type> &vars,
+                          const std::vector<std::vector<value_type>> &lists) override {
+            for (size_type v = 0; v < m_width; ++v) {
+                m_row[v] = to_id(v, row[v]);
+            }
+            m_lists.resize(lists.size());
+            for (size_type i = 0; i < lists.size(); ++i) {
+                m_lists[i].clear();
+                for (const value_type value : lists[i]) {
+                    m_lists[i].push_back(to_id(vars[i], value));
+                }
+            }
+            return m_sink.push_product(m_row.data(), vars, m_lists);
+        }
+
+        void end() override {
+            m_sink.end();
+        }
+    };
+}
+
+#endif //RING_DENSE_IDS_HPP
@@ -0,0 +1,392 @@
+/*
+ * external_build.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_EXTERNAL_BUILD_HPP
+#define RING_EXTERNAL_BUILD_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <sys/resource.h>
+#include "configuration.hpp"
+#include "triple_sort.hpp"
+#include "triple_stats.hpp"
+#include "binary_triples.hpp"
+#include "dense_ids.hpp"
+
+namespace ring {
+
+    //! External-memory construction of the rings.
+    /*!
+     * The triples are kept in a binary file of 3x32-bit records. Each L column is obtained by sorting a rotation
+     * of the triples on disk (sorted runs of at most max_memory bytes that are merged afterwards) and streaming
+     * the last component of the sorted rotation into an sdsl::int_vector_buffer, from which the wavelet matrix
+     * is constructed.
+     */
+    namespace external {
+
+        typedef std::tuple<uint32_t, uint32_t, uint32_t> triple_type;
+
+        //! Resets the peak resident set size of the process (Linux only), so that every phase reports its own peak.
+        inline void reset_peak_memory() {
+            std::ofstream clear_refs("/proc/self/clear_refs");
+            if (clear_refs) clear_refs << "5";
+        }
+
+        //! Peak resident set size in bytes since the last call to reset_peak_memory().
+        inline uint64_t peak_memory() {
+            std::ifstream status("/proc/self/status");
+            std::string line;
+            while (std::getline(status, line)) {
+                if (line.compare(0, 6, "VmHWM:") == 0) {
+                    return std::stoull(line.substr(6)) * 1024;
+                }
+            }
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            return (uint64_t) usage.ru_maxrss * 1024;
+        }
+
+        //! Runs a construction phase and reports its time and peak memory.
+        inline void run_phase(const std::string &name, const std::function<void()> &phase) {
+            reset_peak_memory();
+            auto start = std::chrono::high_resolution_clock::now();
+            phase();
+            auto stop = std::chrono::high_resolution_clock::now();
+            std::cout << "  > " << name << ": "
+                      << std::chrono::duration_cast<std::chrono::seconds>(stop - start).count() << " seconds, "
+                      << peak_memory() << " bytes peak." << std::endl;
+        }
+
+        //! Sequential reader of a file of 3x32-bit records.
+        class triple_reader {
+        private:
+            std::ifstream m_in;
+            std::vector<uint32_t> m_buffer;
+            uint64_t m_remaining;
+            uint64_t m_pos = 0;
+            uint64_t m_size = 0;
+
+            void fill() {
+                uint64_t k = std::min<uint64_t>(m_buffer.size() / 3, m_remaining);
+                m_in.read((char *) m_buffer.data(), k * 3 * sizeof(uint32_t));
+                m_remaining -= k;
+                m_pos = 0;
+                m_size = k;
+            }
+
+        public:
+            triple_reader(const std::string &file, const uint64_t n, const uint64_t offset = 0,
+                          const uint64_t buffer_triples = 1 << 16)
+                    : m_in(file, std::ios::binary), m_buffer(3 * std::max<uint64_t>(1, buffer_triples)), m_remaining(n) {
+                if (!m_in) throw std::runtime_error("Cannot open " + file);
+                m_in.seekg(offset);
+            }
+
+            bool next(triple_type &t) {
+                if (m_pos == m_size) {
+                    if (m_remaining == 0) return false;
+                    fill();
+                }
+                t = triple_type(m_buffer[3 * m_pos], m_buffer[3 * m_pos + 1], m_buffer[3 * m_pos + 2]);
+                ++m_pos;
+                return true;
+            }
+        };
+
+        //! Sequential writer of a file of 3x32-bit records.
+        class triple_writer {
+        private:
+            std::ofstream m_out;
+            std::vector<uint32_t> m_buffer;
+
+        public:
+            triple_writer(const std::string &file, const uint64_t buffer_triples = 1 << 16)
+                    : m_out(file, std::ios::binary | std::ios::trunc) {
+                if (!m_out) throw std::runtime_error("Cannot create " + file);
+                m_buffer.reserve(3 * buffer_triples);
+            }
+
+            ~triple_writer() { flush(); }
+
+            void push_back(const triple_type &t) {
+                if (m_buffer.size() == m_buffer.capacity()) flush();
+                m_buffer.push_back(std::get<0>(t));
+                m_buffer.push_back(std::get<1>(t));
+                m_buffer.push_back(std::get<2>(t));
+            }
+
+            void flush() {
+                m_out.write((const char *) m_buffer.data(), m_buffer.size() * sizeof(uint32_t));
+                m_buffer.clear();
+            }
+        };
+
+        //! Triples stored on disk together with the statistics required to build a ring.
+        /*!
+         * The records of the file are always (s, p, o). A permuted view (e.g. (s, o, p) for the reverse ring)
+         * shares the file and the statistics, and reorders the components while reading.
+         */
+        class triple_file {
+        public:
+            typedef uint64_t size_type;
+        private:
+            std::string m_file;
+            uint64_t m_offset = 0;
+            size_type m_n = 0;
+            std::array<uint8_t, 3> m_order = {{0, 1, 2}};
+            std::array<uint64_t, 3> m_max = {{0, 0, 0}};
+            std::shared_ptr<std::array<symbol_counts, 3>> m_count;
+
+            //! Counts the symbols of the c-th component of the records, sorting chunks of at most max_memory bytes.
+            symbol_counts count_symbols(const uint8_t c, const uint64_t max_memory) const {
+                const uint64_t chunk = std::max<uint64_t>(1, max_memory / sizeof(uint32_t));
+                symbol_counts result;
+                std::vector<uint32_t> symbols;
+                triple_reader reader(m_file, m_n, m_offset);
+                triple_type t;
+                bool more = true;
+                while (more) {
+                    symbols.clear();
+                    symbols.reserve(std::min(chunk, m_n));
+                    while (symbols.size() < chunk && (more = reader.next(t))) {
+                        const uint32_t v[3] = {std::get<0>(t), std::get<1>(t), std::get<2>(t)};
+                        symbols.push_back(v[c]);
+                    }
+                    if (symbols.empty()) break;
+                    std::sort(symbols.begin(), symbols.end());
+                    result.add(symbol_counts::from_sorted(symbols));
+                }
+                return result;
+            }
+
+        public:
+            triple_file() = default;
+
+            //! Wraps 'n' records stored at 'offset' in 'file', whose maximum IDs are given.
+            /*!
+            * The symbols of every component are counted by sorting chunks of at most max_memory bytes of the file
+            * (see count_symbols), so the counts take O(sigma) words whatever the maximum IDs are.
+            */
+            triple_file(const std::string &file, const size_type n, const std::array<uint64_t, 3> &max,
+                        const uint64_t max_memory, const uint64_t offset = 0)
+                    : m_file(file), m_offset(offset), m_n(n), m_max(max),
+                      m_count(new std::array<symbol_counts, 3>()) {
+                for (uint8_t c = 0; c < 3; ++c) {
+                    (*m_count)[c] = count_symbols(c, max_memory);
+                }
+            }
+
+            //! Parses a text file of "s p o" lines into a binary triple file (see binary_triples.hpp).
+            static triple_file from_text(const std::string &dataset, const std::string &file, const uint64_t max_memory) {
+                auto header = binary_triples::convert(dataset, file);
+                return triple_file(file, header.n, {{header.max_s, header.max_p, header.max_o}}, max_memory,
+                                   binary_triples::header_size);
+            }
+
+            //! Uses the records of an existing binary triple file.
+            static triple_file from_binary(const std::string &file, const uint64_t max_memory) {
+                binary_triples triples(file);
+                return triple_file(file, triples.size(), {{triples.max_s(), triples.max_p(), triples.max_o()}},
+                                   max_memory, binary_triples::header_size);
+            }
+
+            //! View of the same triples with components (c0, c1, c2) of the records.
+            triple_file permuted(const uint8_t c0, const uint8_t c1, const uint8_t c2) const {
+                triple_file view(*this);
+                view.m_order = {{m_order[c0], m_order[c1], m_order[c2]}};
+                return view;
+            }
+
+            const std::string &file() const { return m_file; }
+
+            uint64_t offset() const { return m_offset; }
+
+            size_type size() const { return m_n; }
+
+            //! Maximum value of the c-th component.
+            uint64_t max(const uint8_t c) const { return m_max[m_order[c]]; }
+
+            //! Number of distinct values of the c-th component.
+            uint64_t sigma(const uint8_t c) const { return (*m_count)[m_order[c]].sigma(); }
+
+            //! Applies the view order to a record.
+            triple_type view(const triple_type &t) const {
+                const uint32_t v[3] = {std::get<0>(t), std::get<1>(t), std::get<2>(t)};
+                return triple_type(v[m_order[0]], v[m_order[1]], v[m_order[2]]);
+            }
+
+            //! C array of the column preceded by the c-th component, over the values 1..alphabet (see C_array).
+            C_array C(const uint8_t c, const uint64_t alphabet) const {
+                return C_array((*m_count)[m_order[c]], alphabet, m_n);
+            }
+        };
+
+        //! Copies the triples into 'file' with the dense IDs of their roles (see dense_ids), which are stored in 'ids'.
+        /*!
+        * The dense IDs can be ordered by degree; a breadth-first order needs the graph in memory.
+        */
+        inline triple_file to_dense_ids(const triple_file &triples, dense_ids &ids, const std::string &file,
+                                        const uint64_t max_memory, const id_order_type order = rank_order) {
+            sdsl::bit_vector so(std::max(triples.max(0), triples.max(2)) + 1, 0), p(triples.max(1) + 1, 0);
+            {
+                triple_reader reader(triples.file(), triples.size(), triples.offset());
+                triple_type t;
+                while (reader.next(t)) {
+                    so[std::get<0>(t)] = 1;
+                    p[std::get<1>(t)] = 1;
+                    so[std::get<2>(t)] = 1;
+                }
+            }
+            ids = dense_ids(so, p);
+            if (order == degree_order) {
+                std::vector<uint64_t> degree_so(ids.so().size() + 1, 0), degree_p(ids.p().size() + 1, 0);
+                triple_reader reader(triples.file(), triples.size(), triples.offset());
+                triple_type t;
+                while (reader.next(t)) {
+                    ++degree_so[ids.so().to_dense(std::get<0>(t))];
+                    ++degree_p[ids.p().to_dense(std::get<1>(t))];
+                    ++degree_so[ids.so().to_dense(std::get<2>(t))];
+                }
+                ids.reorder(degree_so, degree_p);
+            }
+            std::array<uint64_t, 3> max = {{0, 0, 0}};
+            {
+                triple_reader reader(triples.file(), triples.size(), triples.offset());
+                triple_writer writer(file);
+                triple_type t;
+                while (reader.next(t)) {
+                    t = ids.remap(t);
+                    max[0] = std::max<uint64_t>(max[0], std::get<0>(t));
+                    max[1] = std::max<uint64_t>(max[1], std::get<1>(t));
+                    max[2] = std::max<uint64_t>(max[2], std::get<2>(t));
+                    writer.push_back(t);
+                }
+            }
+            return triple_file(file, triples.size(), max, max_memory);
+        }
+
+        //! Rotation of a triple starting at component t_first, i.e. (t[first], t[first+1], t[first+2]) cyclically.
+        template<uint8_t t_first>
+        inline triple_type rotate(const triple_type &t) {
+            return triple_type(std::get<t_first % 3>(t), std::get<(t_first + 1) % 3>(t), std::get<(t_first + 2) % 3>(t));
+        }
+
+        //! Sorts the rotation starting at t_first of the triples and streams its last component into a buffer.
+        /*!
+        * The resulting int_vector_buffer contains the L column of the ring, including the leading 0.
+        * \param triples    : triples stored on disk.
+        * \param max_memory : bytes available for the sorting buffers.
+        * \param column_file: file of the int_vector_buffer, which the caller should remove once used.
+        */
+        template<uint8_t t_first>
+        void sort_column(const triple_file &triples, const uint64_t max_memory, const std::string &column_file) {
+            const uint64_t n = triples.size();
+            const uint64_t max_0 = triples.max(t_first % 3);
+            const uint64_t max_1 = triples.max((t_first + 1) % 3);
+            const uint64_t max_2 = triples.max((t_first + 2) % 3);
+            // A run and its radix sort buffer are in memory at the same time.
+            const uint64_t run_size = std::max<uint64_t>(1, max_memory / (2 * sizeof(triple_type)));
+            const uint8_t width = sdsl::bits::hi(std::max<uint64_t>(max_2, 1)) + 1;
+
+            sdsl::int_vector_buffer<> L(column_file, std::ios::out, 1024 * 1024, width);
+            L.push_back(0);
+
+            std::vector<std::string> runs;
+            {
+                triple_reader reader(triples.file(), n, triples.offset());
+                std::vector<triple_type> D, aux;
+                triple_type t;
+                bool more = true;
+                while (more) {
+                    D.clear();
+                    D.reserve(std::min(run_size, n));
+                    while (D.size() < run_size && (more = reader.next(t))) {
+                        D.push_back(rotate<t_first>(triples.view(t)));
+                    }
+                    if (D.empty()) break;
+                    triple_sort::sort_lexicographic(D, aux, max_0, max_1, max_2);
+                    if (runs.empty() && !more) {
+                        // Everything fits in a single run
+                        for (const auto &r : D) L.push_back(std::get<2>(r));
+                        L.close();
+                        return;
+                    }
+                    runs.push_back(column_file + ".run." + std::to_string(runs.size()));
+                    triple_writer writer(runs.back());
+                    for (const auto &r : D) writer.push_back(r);
+                }
+            }
+
+            // k-way merge of the sorted runs
+            {
+                const uint64_t buffer_triples = std::max<uint64_t>(1024, max_memory / (sizeof(triple_type) * (runs.size() + 1)));
+                std::vector<std::unique_ptr<triple_reader>> readers;
+                typedef std::pair<triple_type, uint64_t> head_type;
+                std::priority_queue<head_type, std::vector<head_type>, std::greater<head_type>> heads;
+                for (uint64_t r = 0; r < runs.size(); ++r) {
+                    uint64_t run_n = (r + 1 < runs.size()) ? run_size : n - run_size * r;
+                    readers.emplace_back(new triple_reader(runs[r], run_n, 0, buffer_triples));
+                    triple_type t;
+                    if (readers[r]->next(t)) heads.push({t, r});
+                }
+                while (!heads.empty()) {
+                    head_type h = heads.top();
+                    heads.pop();
+                    L.push_back(std::get<2>(h.first));
+                    triple_type t;
+                    if (readers[h.second]->next(t)) heads.push({t, h.second});
+                }
+            }
+            for (const auto &run : runs) std::remove(run.c_str());
+            L.close();
+        }
+
+        //! Builds the BWT whose L column is the last component of the rotation starting at t_first.
+        /*!
+        * \param alphabet : upper bound of the values of the t_first-th component, used to build C.
+        * \param name     : label of the BWT in the phase report.
+        */
+        template<uint8_t t_first, class t_bwt>
+        void build_bwt(t_bwt &bwt, const triple_file &triples, const uint64_t alphabet, const uint64_t max_memory,
+                       const std::string &tmp_prefix, const std::string &name) {
+            const std::string column_file = tmp_prefix + ".L";
+            run_phase("Sorting " + name, [&]() {
+                sort_column<t_first>(triples, max_memory, column_file);
+            });
+            run_phase("Building " + name, [&]() {
+                sdsl::int_vector_buffer<> L(column_file);
+                bwt = t_bwt(L, triples.C(t_first, alphabet));
+                L.close(true);
+            });
+        }
+    }
+}
+
+#endif //RING_EXTERNAL_BUILD_HPP
@@ -21,11 +21,11 @@
 #ifndef RING_GAO_HPP
 #define RING_GAO_HPP
 
+#include <algorithm>
 #include <ring.hpp>
-#include <unordered_map>
 #include <vector>
 #include <utils.hpp>
-#include <unordered_set>
+#include <var_to_iterators.hpp>
 
 namespace ring {
 
@@ -41,40 +41,47 @@ namespace ring {
             var_type name;
             size_type weight;
             size_type n_triples;
-            std::unordered_set<var_type> related;
+            bool projected;
+            std::vector<var_type> related;
         } info_var_type;
         std::vector<info_var_type> m_var_info;
         //typedef ltj_iterator<ring_type, var_type, cons_type> ltj_iter_type;
         typedef ltj_iterator_t ltj_iter_type;
         typedef std::pair<size_type, var_type> pair_type;
         typedef std::priority_queue<pair_type, std::vector<pair_type>, greater<pair_type>> min_heap_type;
-        typedef std::unordered_map<var_type, std::vector<ltj_iter_type*>> var_to_iterators_type;
+        typedef ring::var_to_iterators<ltj_iter_type> var_to_iterators_type;
+        //Position of each variable in m_var_info, indexed by variable id.
+        typedef std::vector<size_type> position_type;
         size_type m_number_of_variables;
     private:
         const std::vector<triple_pattern>* m_ptr_triple_patterns;
         const std::vector<ltj_iter_type>* m_ptr_iterators;
-        std::unordered_map<var_type, size_type> m_hash_table_position;
-        ring_type* m_ptr_ring;
+        position_type m_hash_table_position;
+        const ring_type* m_ptr_ring;
         size_type m_lonely_start;
         std::vector<var_type> m_lonely_variables;
         std::stack<std::vector<std::pair<var_type, size_type>>> m_previous_values_stack;
         var_type m_starting_var;
+        size_type m_projection_size;
 
 
         void var_to_vector(const var_type var, const size_type size,
-                            std::unordered_map<var_type, size_type> &hash_table,
+                            position_type &hash_table,
                             std::vector<info_var_type> &vec){
 
-            auto it = hash_table.find(var);
-            if(it == hash_table.end()){
+            if(var >= hash_table.size()){
+                hash_table.resize(var + 1, -1ULL);
+            }
+            if(hash_table[var] == -1ULL){
                 info_var_type info;
                 info.name = var;
                 info.weight = size;
                 info.n_triples = 1;
+                info.projected = true;
                 vec.emplace_back(info);
-                hash_table.insert({var, vec.size()-1});
+                hash_table[var] = vec.size()-1;
             }else{
-                info_var_type& info = vec[it->second];
+                info_var_type& info = vec[hash_table[var]];
                 ++info.n_triples;
                 if(info.weight > size){
                     info.weight = size;
@@ -82,30 +89,22 @@ namespace ring {
             }
         }
 
-        void update_hash_var_index(typename std::vector<info_var_type>::iterator it_start, typename std::vector<info_var_type>::iterator it_end, std::unordered_map<var_type, size_type> &hash_table){
-            int i=0;
-            typename std::vector<info_var_type>::iterator it = it_start;
-            while(it != it_end){
-                auto hash_it = hash_table.find(it->name);
-                if(hash_it != hash_table.end()){
-                    hash_it->second = i;
-                    i++;
-                }
-                it = std::next(it);
-            }
-        }
         void var_to_related(const var_type var, const var_type rel,
-                            std::unordered_map<var_type, size_type> &hash_table,
+                            position_type &hash_table,
                             std::vector<info_var_type> &vec){
 
-            auto pos_var = hash_table[var];
-            vec[pos_var].related.insert(rel);
-            auto pos_rel = hash_table[rel];
-            vec[pos_rel].related.insert(var);
+            auto &related_var = vec[hash_table[var]].related;
+            if(std::find(related_var.begin(), related_var.end(), rel) == related_var.end()){
+                related_var.push_back(rel);
+            }
+            auto &related_rel = vec[hash_table[rel]].related;
+            if(std::find(related_rel.begin(), related_rel.end(), var) == related_rel.end()){
+                related_rel.push_back(var);
+            }
         }
 
         void fill_heap(const var_type var,
-                        std::unordered_map<var_type, size_type> &hash_table,
+                        position_type &hash_table,
                         std::vector<info_var_type> &vec,
                         std::vector<bool> &checked,
                         min_heap_type &heap){
@@ -135,23 +134,25 @@ namespace ring {
         };
 
         void copy(const gao_size &o) {
-            m_ptr_triple_patterns = std::move(o.m_ptr_triple_patterns);
-            m_ptr_iterators = std::move(o.m_ptr_iterators);
-            m_ptr_ring = std::move(o.m_ptr_ring);
-            m_var_info = std::move(o.var_info);
-            m_lonely_variables = std::move(o.m_lonely_variables);
-            m_hash_table_position = std::move(o.m_hash_table_position);
-            m_number_of_variables = std::move(o.m_number_of_variables);
-            m_lonely_start = std::move(o.m_lonely_start);
-            m_starting_var = std::move(o.m_starting_var);
+            m_ptr_triple_patterns = o.m_ptr_triple_patterns;
+            m_ptr_iterators = o.m_ptr_iterators;
+            m_ptr_ring = o.m_ptr_ring;
+            m_var_info = o.m_var_info;
+            m_lonely_variables = o.m_lonely_variables;
+            m_hash_table_position = o.m_hash_table_position;
+            m_number_of_variables = o.m_number_of_variables;
+            m_lonely_start = o.m_lonely_start;
+            m_starting_var = o.m_starting_var;
+            m_projection_size = o.m_projection_size;
+            m_previous_values_stack = o.m_previous_values_stack;
         }
     public:
         gao_size() = default;
 
         gao_size(const std::vector<triple_pattern>* triple_patterns,
                     const std::vector<ltj_iter_type>* iterators,
-                    ring_type* r,
-                    std::vector<var_type> &gao) : m_number_of_variables(0){
+                    const ring_type* r,
+                    std::vector<var_type> &gao) : m_number_of_variables(0), m_projection_size(0){
             m_ptr_triple_patterns = triple_patterns;
             m_ptr_iterators = iterators;
             m_ptr_ring = r;
@@ -216,9 +217,9 @@ namespace ring {
             //2. Sorting variables according to their weights.
             //std::cout << "Sorting... " << std::flush;
             std::sort(m_var_info.begin(), m_var_info.end(), compare_var_info());
-            update_hash_var_index(m_var_info.begin(), m_var_info.end(), m_hash_table_position);
             m_lonely_start = m_var_info.size();
             m_number_of_variables = m_var_info.size();
+            m_projection_size = m_number_of_variables;
             for(i = 0; i < m_var_info.size(); ++i){
                 m_hash_table_position[m_var_info[i].name] = i;
                 if(m_var_info[i].n_triples == 1 && i < m_lonely_start){
@@ -292,6 +293,8 @@ namespace ring {
                 m_number_of_variables = std::move(o.m_number_of_variables);
                 m_lonely_start = std::move(o.m_lonely_start);
                 m_starting_var = std::move(o.m_starting_var);
+                m_projection_size = std::move(o.m_projection_size);
+                m_previous_values_stack = std::move(o.m_previous_values_stack);
             }
             return *this;
         }
@@ -306,15 +309,22 @@ namespace ring {
             std::swap(m_number_of_variables, o.m_number_of_variables);
             std::swap(m_lonely_start, o.m_lonely_start);
             std::swap(m_starting_var, o.m_starting_var);
+            std::swap(m_projection_size, o.m_projection_size);
+            std::swap(m_previous_values_stack, o.m_previous_values_stack);
+        }
+
+        //! Sets the iterators of the triple patterns, after they were copied to another algorithm.
+        void set_iterators(const std::vector<ltj_iter_type>* iterators){
+            m_ptr_iterators = iterators;
         }
-        std::unordered_set<var_type> get_related_variables(const var_type& var){
+        const std::vector<var_type>& get_related_variables(const var_type& var) const{
             return m_var_info[m_hash_table_position[var]].related;
         }
         std::vector<var_type> get_lonely_variables() const{
             return m_lonely_variables;
         }
         /*Updates weights of the related vars of ´cur_var´*/
-        void update_weights(const size_type& j, const var_type& cur_var, const std::unordered_map<var_type, bool> &gao_vars,const var_to_iterators_type &m_var_to_iterators){
+        void update_weights(const size_type& j, const var_type& cur_var, const std::vector<bool> &gao_vars,const var_to_iterators_type &m_var_to_iterators){
             std::vector<std::pair<var_type, size_type>> previous_values;
             //Lonely vars are excluded of this process.
             if(j > 0 && j < m_lonely_start){
@@ -326,24 +336,20 @@ namespace ring {
                         info_var_type& var_info = m_var_info[index];
                         size_type min_weight = -1ULL;
                         //All iterators of 'var'
-                        auto iters =  m_var_to_iterators.find(rel_var);
-                        if(iters != m_var_to_iterators.end()){
-                            std::vector<ltj_iter_type*> var_iters = iters->second;
-                            for(ltj_iter_type* it : var_iters){
-                                //The iterator has a reference to its triple pattern.
-                                //const triple_pattern& triple_pattern = *(it->get_triple_pattern());
-                                const ltj_iter_type &iter = *it;
-                                size_type weight = 0;
-                                if(util::configuration.uses_muthu()){
-                                    weight = util::get_num_diff_values<ring_type, ltj_iter_type>(rel_var, m_ptr_ring, iter);
-                                } else {
-                                    weight = util::get_size_interval<ltj_iter_type>(iter);
-                                }
-                                if(weight < min_weight){
-                                    min_weight = weight;
-                                }
-                                //std::cout << "Cur var: " << int(cur_var) << " rel var: " << int(rel_var) << " min weight : " << min_weight << std::endl;
+                        for(ltj_iter_type* it : m_var_to_iterators[rel_var]){
+                            //The iterator has a reference to its triple pattern.
+                            //const triple_pattern& triple_pattern = *(it->get_triple_pattern());
+                            const ltj_iter_type &iter = *it;
+                            size_type weight = 0;
+                            if(util::configuration.uses_muthu()){
+                                weight = util::get_num_diff_values<ring_type, ltj_iter_type>(rel_var, m_ptr_ring, iter);
+                            } else {
+                                weight = util::get_size_interval<ltj_iter_type>(iter);
+                            }
+                            if(weight < min_weight){
+                                min_weight = weight;
                             }
+                            //std::cout << "Cur var: " << int(cur_var) << " rel var: " << int(rel_var) << " min weight : " << min_weight << std::endl;
                         }
                         if(min_weight != -1ULL){
                             //Storing the previous value on the stack.
@@ -357,21 +363,61 @@ namespace ring {
             }
             m_previous_values_stack.emplace(std::move(previous_values));
         }
-        bool is_var_bound(const size_type& var, const std::unordered_map<var_type,bool> &m_gao_vars) const{
-            auto it = m_gao_vars.find(var);
-            //auto it = std::find(m_gao_vars.begin(), m_gao_vars.end(), var);
-            if (it != m_gao_vars.end())
-                if(it->second)
-                    return true;
-            return false;
+        inline bool is_var_bound(const size_type& var, const std::vector<bool> &m_gao_vars) const{
+            return m_gao_vars[var];
+        }
+        //! Restricts the output to the variables of 'projection', which are moved to the first levels of the GAO.
+        /*!
+        * The relative order of the projected variables and of the other ones is kept. In the adaptive
+        * mode only projected variables are chosen while some of them are not bound.
+        * \param projection : projected variables. Variables that are not in the query are ignored.
+        * \param gao        : GAO computed by the constructor (empty in the adaptive mode).
+        * \returns the number of projected variables of the query.
+        */
+        size_type set_projection(const std::vector<var_type> &projection, std::vector<var_type> &gao){
+            m_projection_size = 0;
+            for(auto& info : m_var_info){
+                info.projected = std::find(projection.begin(), projection.end(), info.name) != projection.end();
+                if(info.projected) ++m_projection_size;
+            }
+            std::stable_partition(gao.begin(), gao.end(), [&](const var_type var){
+                return m_var_info[m_hash_table_position[var]].projected;
+            });
+            if(!gao.empty()){
+                m_starting_var = gao[0];
+            }else{
+                for(const auto& info : m_var_info){
+                    if(info.projected || m_projection_size == 0){
+                        m_starting_var = info.name;
+                        break;
+                    }
+                }
+            }
+            return m_projection_size;
         }
         //Linear search on 'm_var_info' for the non-bound variable with minimum weight.
-        var_type get_next_var(const size_type& j, const std::unordered_map<var_type,bool> &m_gao_vars) const{
+        var_type get_next_var(const size_type& j, const std::vector<bool> &m_gao_vars) const{
             size_type min_weight = -1ULL;
             var_type min_var = '\0';
 
             if(j == 0){
                 min_var = m_starting_var;
+            }else if(m_projection_size < m_number_of_variables){
+                //Projected variables first, and among them non-lonely first (they precede the lonely ones in 'm_var_info').
+                bool found = false;
+                for(const auto& v : m_var_info){
+                    if(is_var_bound(v.name, m_gao_vars) || (j < m_projection_size && !v.projected)) continue;
+                    if(v.n_triples > 1){
+                        if(!found || v.weight < min_weight){
+                            min_weight = v.weight;
+                            min_var = v.name;
+                            found = true;
+                        }
+                    }else{
+                        if(!found) min_var = v.name;
+                        break;
+                    }
+                }
             }else{
                 for(const auto& v : m_var_info){
                     if(!is_var_bound(v.name, m_gao_vars)){
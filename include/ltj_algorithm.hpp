@@ -27,13 +27,19 @@
 #include <ring.hpp>
 #include <ltj_iterator.hpp>
 #include <gao.hpp>
+#include <var_to_iterators.hpp>
+#include <parallel_ltj.hpp>
+#include <result_sink.hpp>
+#include <cancellation.hpp>
+#include <ltj_executor.hpp>
 
 namespace ring {
 
     template<class ring_t = ring<>, class var_t = uint8_t, class cons_t = uint64_t, class ltj_iterator_t = ltj_iterator<ring_t,var_t,cons_t>>//, class gao = gao_t<>
-    class ltj_algorithm {
+    class ltj_algorithm : public ltj_executor<ltj_algorithm<ring_t, var_t, cons_t, ltj_iterator_t>, var_t, ltj_iterator_t, gao_size<ring_t>> {
 
     public:
+        typedef ltj_executor<ltj_algorithm, var_t, ltj_iterator_t, gao_size<ring_t>> executor_type;
         typedef uint64_t value_type;
         typedef uint64_t size_type;
         typedef var_t var_type;
@@ -42,42 +48,29 @@ namespace ring {
         //typedef gao_t gao_type;
         //typedef ltj_iterator<ring_type, var_type, const_type> ltj_iter_type;
         typedef ltj_iterator_t ltj_iter_type;
-        typedef std::unordered_map<var_type, std::vector<ltj_iter_type*>> var_to_iterators_type;
-        typedef std::vector<std::pair<var_type, value_type>> tuple_type;
-        typedef std::chrono::high_resolution_clock::time_point time_point_type;
+        typedef typename executor_type::level_type level_type;
 
         typedef std::pair<size_type, var_type> pair_type;
         typedef std::priority_queue<pair_type, std::vector<pair_type>, greater<pair_type>> min_heap_type;
     private:
-        const std::vector<triple_pattern>* m_ptr_triple_patterns;
-        std::vector<var_type> m_gao; //TODO: should be a class
-        std::stack<var_type> m_gao_stack;
-        //m_gao_vars is a 1:1 umap representation the m_gao_stack, everything in m_gao_stack is true in this structure.
-        std::unordered_map<var_type, bool> m_gao_vars;
-        //gao_type m_gao_test;
-        ring_type* m_ptr_ring;
-        std::vector<ltj_iter_type> m_iterators;
-        var_to_iterators_type m_var_to_iterators;
-        bool m_is_empty = false;
-        gao_size<ring_type> m_gao_size;
+        friend executor_type;
+        using executor_type::m_var_to_iterators;
+
+        const ring_type* m_ptr_ring;
+
         void copy(const ltj_algorithm &o) {
-            m_ptr_triple_patterns = o.m_ptr_triple_patterns;
-            m_gao = o.m_gao;
+            executor_type::copy(o);
             m_ptr_ring = o.m_ptr_ring;
-            m_iterators = o.m_iterators;
-            m_var_to_iterators = o.m_var_to_iterators;
-            m_is_empty = o.m_is_empty;
         }
 
+        //! First value of the intersection of the level that is not below 'first' (0 = no bound).
+        value_type first_value(level_type &level, const value_type first){
+            return (first == 0) ? seek(level.var) : seek(level.var, first);
+        }
 
-        inline void add_var_to_iterator(const var_type var, ltj_iter_type* ptr_iterator){
-            auto it =  m_var_to_iterators.find(var);
-            if(it != m_var_to_iterators.end()){
-                it->second.push_back(ptr_iterator);
-            }else{
-                std::vector<ltj_iter_type*> vec = {ptr_iterator};
-                m_var_to_iterators.insert({var, vec});
-            }
+        //! Next value of the intersection of the level.
+        value_type seek_next(level_type &level){
+            return seek(level.var, level.value + 1);
         }
 
     public:
@@ -85,37 +78,11 @@ namespace ring {
 
         ltj_algorithm() = default;
 
-        ltj_algorithm(const std::vector<triple_pattern>* triple_patterns, ring_type* ring){
-
-            m_ptr_triple_patterns = triple_patterns;
+        ltj_algorithm(const std::vector<triple_pattern>* triple_patterns, const ring_type* ring){
             m_ptr_ring = ring;
-
-            size_type i = 0;
-            m_iterators.resize(m_ptr_triple_patterns->size());
-            for(const auto& triple : *m_ptr_triple_patterns){
-                //Bulding iterators
-                m_iterators[i] = ltj_iter_type(&triple, m_ptr_ring);
-                if(m_iterators[i].is_empty){
-                    m_is_empty = true;
-                    return;
-                }
-
-                //For each variable we add the pointers to its iterators
-                if(triple.o_is_variable()){
-                    add_var_to_iterator(triple.term_o.value, &(m_iterators[i]));
-                }
-                if(triple.p_is_variable()){
-                    add_var_to_iterator(triple.term_p.value, &(m_iterators[i]));
-                }
-                if(triple.s_is_variable()){
-                    add_var_to_iterator(triple.term_s.value, &(m_iterators[i]));
-                }
-                ++i;
-            }
-            m_gao_size = gao_size<ring_type>(m_ptr_triple_patterns, &m_iterators, m_ptr_ring, m_gao);
+            this->build(triple_patterns, m_ptr_ring);
             //m_gao = {'\000', '\001', '\003', '\002'};
             //m_gao = {'\000', '\002', '\001', '\003'};
-            m_gao_vars.reserve(m_gao_size.m_number_of_variables);
         }
 
         //! Copy constructor
@@ -139,159 +106,16 @@ namespace ring {
         //! Move Operator=
         ltj_algorithm &operator=(ltj_algorithm &&o) {
             if (this != &o) {
-                m_ptr_triple_patterns = std::move(o.m_ptr_triple_patterns);
-                m_gao = std::move(o.m_gao);
                 m_ptr_ring = std::move(o.m_ptr_ring);
-                m_iterators = std::move(o.m_iterators);
-                m_var_to_iterators = std::move(o.m_var_to_iterators);
-                m_is_empty = o.m_is_empty;
+                executor_type::move(std::move(o));
             }
             return *this;
         }
 
         void swap(ltj_algorithm &o) {
-            std::swap(m_ptr_triple_patterns, o.m_ptr_triple_patterns);
-            std::swap(m_gao, o.m_gao);
+            executor_type::swap(o);
             std::swap(m_ptr_ring, o.m_ptr_ring);
-            std::swap(m_iterators, o.m_iterators);
-            std::swap(m_var_to_iterators, o.m_var_to_iterators);
-            std::swap(m_is_empty, o.m_is_empty);
-        }
-
-
-        /**
-        *
-        * @param res               Results
-        * @param limit_results     Limit of results
-        * @param timeout_seconds   Timeout in seconds
-        */
-        void join(std::vector<tuple_type> &res,
-                  const size_type limit_results = 0, const size_type timeout_seconds = 0){
-            if(m_is_empty) return;
-            //m_ptr_ring->fw_count = 0;
-            time_point_type start = std::chrono::high_resolution_clock::now();
-            tuple_type t(m_gao_size.m_number_of_variables);
-            search(0, t, res, start, limit_results, timeout_seconds);
-            //std::cout << m_ptr_ring->fw_count << std::endl;
-        };
-
-        std::string get_gao(std::unordered_map<uint8_t, std::string>& ht) const{
-            std::string str = "";
-            for(const auto& var : m_gao){
-                str += "?" + ht[var] + " ";
-            }
-            return str;
-        }
-        var_type next(const size_type j) {
-            if(util::configuration.is_adaptive()){
-                var_type var = '\0';
-                const var_type& cur_var = m_gao_stack.top();
-                const std::unordered_map<var_type, bool> & b_vars = m_gao_vars;
-                m_gao_size.update_weights(j, cur_var, b_vars, m_var_to_iterators);
-                var = m_gao_size.get_next_var(j, m_gao_vars);
-                return var;
-            }
-            else{
-                return m_gao[j];
-            }
-        }
-
-        void push_var_to_stack(const var_type& x_j){
-            //assert (m_gao_stack.top() == x_j);
-            m_gao_stack.push(x_j);
-            m_gao_vars[x_j]=true;
-        }
-
-        void pop_var_of_stack(){
-            auto v = m_gao_stack.top();
-            m_gao_stack.pop();
-            m_gao_vars[v]=false;
         }
-        /**
-         *
-         * @param j                 Index of the variable
-         * @param tuple             Tuple of the current search
-         * @param res               Results
-         * @param start             Initial time to check timeout
-         * @param limit_results     Limit of results
-         * @param timeout_seconds   Timeout in seconds
-         */
-        bool search(const size_type j, tuple_type &tuple, std::vector<tuple_type> &res,
-                    const time_point_type start,
-                    const size_type limit_results = 0, const size_type timeout_seconds = 0){
-
-            //(Optional) Check timeout
-            if(timeout_seconds > 0){
-                time_point_type stop = std::chrono::high_resolution_clock::now();
-                size_type sec = std::chrono::duration_cast<std::chrono::seconds>(stop-start).count();
-                if(sec > timeout_seconds) return false;
-            }
-
-            //(Optional) Check limit
-            if(limit_results > 0 && res.size() == limit_results) return false;
-
-            if(j == m_gao_size.m_number_of_variables){
-                //Report results
-                /*std::cout << "tuple : ";
-                for(auto& pair : tuple){
-                    std::cout << int(pair.first) << " = " << pair.second << std::endl;
-                }
-                std::cout << " " << std::endl;*/
-                res.emplace_back(tuple);
-            }else{
-                //assert(m_gao_stack.size() == m_gao_vars.size());
-                var_type x_j = next(j);
-                push_var_to_stack(x_j);
-                std::vector<ltj_iter_type*>& itrs = m_var_to_iterators[x_j];
-                bool ok;
-                if(itrs.size() == 1 && itrs[0]->in_last_level()) {//Lonely variables
-                    auto results = itrs[0]->seek_all(x_j);
-                    //std::cout << "Results: " << results.size() << std::endl;
-                    for (const auto &c : results) {
-                        //1. Adding result to tuple
-                        tuple[j] = {x_j, c};
-                        //std::cout << "current var: " << int(std::get<0>(tuple[j])) << " = " << std::get<1>(tuple[j]) << std::endl;
-                        //2. Going down in the trie by setting x_j = c (\mu(t_i) in paper)
-                        itrs[0]->down(x_j, c);
-                        //2. Search with the next variable x_{j+1}
-                        ok = search(j + 1, tuple, res, start, limit_results, timeout_seconds);
-                        if(!ok) return false;
-                        //4. Going up in the trie by removing x_j = c
-                        itrs[0]->up(x_j);
-                    }
-                }else {
-                    value_type c = seek(x_j);
-                    //std::cout << "Seek (init): (" << (uint64_t) x_j << ": " << c << ")" <<std::endl;
-
-                    while (c != 0) { //If empty c=0
-                        //1. Adding result to tuple
-                        tuple[j] = {x_j, c};
-                        //std::cout << "current var: " << int(std::get<0>(tuple[j])) << " = " << std::get<1>(tuple[j]) << std::endl;
-                        //2. Going down in the tries by setting x_j = c (\mu(t_i) in paper)
-                        for (ltj_iter_type* iter : itrs) {
-                            iter->down(x_j, c);
-                        }
-                        //3. Search with the next variable x_{j+1}
-                        ok = search(j + 1, tuple, res, start, limit_results, timeout_seconds);
-                        if(!ok) return false;
-                        //4. Going up in the tries by removing x_j = c
-                        for (ltj_iter_type *iter : itrs) {
-                            iter->up(x_j);
-                        }
-                        //5. Next constant for x_j
-                        c = seek(x_j, c + 1);
-                        //std::cout << "Seek (bucle): (" << (uint64_t) x_j << ": " << c << ")" <<std::endl;
-                    }
-                }
-                if(util::configuration.is_adaptive()){
-                    m_gao_size.set_previous_weight();
-                }
-                pop_var_of_stack();
-                //std::cout << " pop. " << std::endl;
-            }
-            return true;
-        };
-
 
         /**
          *
@@ -302,7 +126,7 @@ namespace ring {
          */
 
         value_type seek(const var_type x_j, value_type c=-1){
-            std::vector<ltj_iter_type*>& itrs = m_var_to_iterators[x_j];
+            const auto itrs = m_var_to_iterators[x_j];
             value_type c_i, c_prev = 0, i = 0, n_ok = 0;
             while (true){
                 //Compute leap for each triple that contains x_j
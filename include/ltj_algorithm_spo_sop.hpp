@@ -28,18 +28,34 @@
 #include <reverse_ring.hpp>
 #include <ltj_iterator_manager.hpp>
 #include <gao.hpp>
+#include <var_to_iterators.hpp>
+#include <parallel_ltj.hpp>
+#include <result_sink.hpp>
+#include <cancellation.hpp>
+#include <ltj_executor.hpp>
 
 namespace ring {
 
+    //! Intersection of a level of ltj_algorithm_spo_sop: WMs and ranges of the iterators of its variable.
+    template<class wm_t>
+    struct wm_intersection_state {
+        std::vector<const sdsl::wm_int<wm_t>*> wms;
+        std::vector<sdsl::range_type> ranges;
+    };
+
     template<class ring_t = ring<>,
     class reverse_ring_t = reverse_ring<>,
     class wm_t = sdsl::bit_vector,
     class var_t = uint8_t,
     class cons_t = uint64_t,
     class ltj_iterator_t = ltj_iterator_manager<ring_t,reverse_ring_t, var_t,cons_t, wm_t>>//, class gao = gao_t<>
-    class ltj_algorithm_spo_sop {
+    class ltj_algorithm_spo_sop : public ltj_executor<ltj_algorithm_spo_sop<ring_t, reverse_ring_t, wm_t, var_t, cons_t, ltj_iterator_t>,
+                                                      var_t, ltj_iterator_t, gao_size<ring_t, var_t, cons_t, ltj_iterator_t>,
+                                                      wm_intersection_state<wm_t>> {
 
     public:
+        typedef ltj_executor<ltj_algorithm_spo_sop, var_t, ltj_iterator_t, gao_size<ring_t, var_t, cons_t, ltj_iterator_t>,
+                             wm_intersection_state<wm_t>> executor_type;
         typedef sdsl::wm_int<wm_t> wm_type;
         typedef uint64_t value_type;
         typedef uint64_t size_type;
@@ -51,10 +67,7 @@ namespace ring {
         typedef cons_t const_type;
         //typedef gao_t gao_type;
         typedef ltj_iterator_t ltj_iter_type;
-        typedef std::unordered_map<var_type, std::vector<ltj_iter_type*>> var_to_iterators_type;
-
-        typedef std::vector<std::pair<var_type, value_type>> tuple_type;
-        typedef std::chrono::high_resolution_clock::time_point time_point_type;
+        typedef typename executor_type::level_type level_type;
 
         typedef std::pair<size_type, var_type> pair_type;
         typedef std::priority_queue<pair_type, std::vector<pair_type>, greater<pair_type>> min_heap_type;
@@ -67,21 +80,14 @@ namespace ring {
         using stack_vector_type = std::vector<intersect_tuple_type>;
         typedef std::stack<stack_vector_type> stack_type;
     private:
-        std::unordered_map<var_type, std::unique_ptr<stack_type>> m_var_to_intersection_stack;
-        std::unordered_map<var_type, bool> m_var_intersection_last_element;
-        const std::vector<triple_pattern>* m_ptr_triple_patterns;
-        std::vector<var_type> m_gao; //TODO: should be a class
-        std::stack<var_type> m_gao_stack;
-        //m_gao_vars is a 1:1 umap representation the m_gao_stack, everything in m_gao_stack is true in this structure.
-        std::unordered_map<var_type, bool> m_gao_vars;
-        //gao_type m_gao_test;
-        ring_type* m_ptr_ring;
-        reverse_ring_type* m_ptr_reverse_ring;
-        std::vector<ltj_iter_type> m_iterators;
-
-        var_to_iterators_type m_var_to_iterators;
-        bool m_is_empty = false;
-        gao_size<ring_type, var_type, const_type, ltj_iter_type> m_gao_size;
+        friend executor_type;
+        using executor_type::m_var_to_iterators;
+
+        //State of the intersection of each variable (see next()), indexed by variable id.
+        std::vector<std::unique_ptr<stack_type>> m_var_to_intersection_stack;
+        std::vector<bool> m_var_intersection_last_element;
+        const ring_type* m_ptr_ring;
+        const reverse_ring_type* m_ptr_reverse_ring;
 
         //Stack holding WMs intersection - Variable, intersection results, ptr to last selected.
         /*typedef struct {
@@ -92,25 +98,66 @@ namespace ring {
         std::stack<intersection_type> m_intersection_cache;*/
 
         void copy(const ltj_algorithm_spo_sop &o) {
-            m_ptr_triple_patterns = o.m_ptr_triple_patterns;
-            m_gao = o.m_gao;
+            executor_type::copy(o);
             m_ptr_ring = o.m_ptr_ring;
-            m_iterators = o.m_iterators;
-            m_var_to_iterators = o.m_var_to_iterators;
-            m_is_empty = o.m_is_empty;
+            m_ptr_reverse_ring = o.m_ptr_reverse_ring;
+            m_var_to_intersection_stack.clear();
+            m_var_to_intersection_stack.resize(m_var_to_iterators.size());
+            m_var_intersection_last_element.assign(m_var_to_iterators.size(), false);
         }
 
+        //! Sets the index (SPO / SOP) of the iterators of x_j that do not have one yet.
+        void set_index(const var_type x_j){
+            for(ltj_iter_type* iter : m_var_to_iterators[x_j]){
+                if(!iter->has_index()){
+                    iter->set_iter(x_j);
+                }
+            }
+        }
 
-        inline void add_var_to_iterator(const var_type var, ltj_iter_type* ptr_iterator){
-            auto it =  m_var_to_iterators.find(var);
-            if(it != m_var_to_iterators.end()){
-                it->second.push_back(ptr_iterator);
-            }else{
-                std::vector<ltj_iter_type*> vec = {ptr_iterator};
-                m_var_to_iterators.insert({var, vec});
+        /**
+         * Starts the intersection of the WMs of the iterators of the variable of the level.
+         *
+         * @param level             Level of the variable
+         * @param first             The values below it are skipped (0 = none)
+         * @return                  First value of the intersection, or 0 if it is empty
+         */
+        value_type first_value(level_type &level, const value_type first){
+            const var_type x_j = level.var;
+            level.state.wms.clear();
+            level.state.ranges.clear();
+            for(ltj_iter_type* iter : m_var_to_iterators[x_j]){
+                //Getting the current interval and WMs of each iterator_x_j.
+                level.state.wms.emplace_back(&iter->get_current_wm(x_j));
+                level.state.ranges.emplace_back(iter->get_current_range(x_j));
+            }
+            //The values below the range of a parallel join are skipped by starting the intersection at 'first'.
+            if(first > 0){
+                seek(x_j, level.state.wms, level.state.ranges, first);
+            }
+            return next(x_j, level.state.wms, level.state.ranges);
+        }
+
+        //! Next value of the intersection of the level.
+        value_type seek_next(level_type &level){
+            return next(level.var, level.state.wms, level.state.ranges);
+        }
+
+        //! Discards the intersection of a level whose range ended before it, and unsets the index of its iterators.
+        void close_intersection(level_type &level){
+            if(level.value != 0){
+                m_var_to_intersection_stack[level.var].reset();
+                m_var_intersection_last_element[level.var] = false;
+            }
+            //Unset type of iterator (SPO / SOP). See logic inside unset_iter() function.
+            if(util::configuration.is_adaptive()){
+                for(ltj_iter_type* iter : m_var_to_iterators[level.var]){
+                    iter->unset_iter(level.var);
+                }
             }
         }
 
+
         /*
         bool is_intersection_calculated(var_type x_j) const{
             if(!m_intersection_cache.empty()){
@@ -147,22 +194,88 @@ namespace ring {
                 return val;
             }
         }*/
+        //! Starts the intersection of var at 'first', so that next() returns its first value >= first.
+        /*!
+        * It descends the WMs along the path of 'first' once. The subtrees to the right of the path are
+        * left in the stack of the intersection, to be visited later. The subtrees to the left of it are
+        * dropped. The leaf of 'first' is pushed last if it is in every range.
+        */
+        template<class t_wt, class range_type = sdsl::range_type>
+        void seek(var_type var, const std::vector<t_wt*>& p_wts, const std::vector<range_type>& p_ranges, const value_type first)
+        {
+            using std::get;
+            std::unique_ptr<stack_type> stack{new stack_type};
+            m_var_intersection_last_element[var] = false;
+            if(p_wts.size() > 0 && (first >> p_wts[0]->max_level) == 0){
+                stack_vector_type vec;
+                for(size_type i=0; i < p_wts.size(); i++){
+                    vec.emplace_back(intersect_tuple_type{p_wts[i]->root(), p_ranges[i]});
+                }
+                bool on_path = true;
+                while (on_path && !p_wts[0]->is_leaf(vec[0].node)) {
+                    const bool bit = (first >> (p_wts[0]->max_level - 1 - vec[0].node.level)) & 1ULL;
+                    bool empty_left_range = false, empty_right_range = false;
+                    stack_vector_type left_children_v;
+                    stack_vector_type right_children_v;
+                    for(size_type i = 0; i < vec.size(); i++){
+                        const t_wt& wt = *p_wts[i];
+                        const auto& children = wt.expand(vec[i].node);
+                        const std::array<range_type, 2>& children_ranges = wt.expand(vec[i].node, vec[i].range);
+                        //The left subtree is below 'first' when its bit is 1.
+                        if(!empty_left_range){
+                            if(bit || sdsl::empty(children_ranges[0])){
+                                empty_left_range = true;
+                            }else{
+                                left_children_v.emplace_back(intersect_tuple_type{get<0>(children), get<0>(children_ranges)});
+                            }
+                        }
+                        if(!empty_right_range){
+                            if(sdsl::empty(children_ranges[1])){
+                                empty_right_range = true;
+                            }else{
+                                right_children_v.emplace_back(intersect_tuple_type{get<1>(children), get<1>(children_ranges)});
+                            }
+                        }
+                        if(empty_left_range && empty_right_range){
+                            break;
+                        }
+                    }
+                    if(bit){
+                        on_path = !empty_right_range;
+                        vec = std::move(right_children_v);
+                    }else{
+                        //Values after the whole left subtree, visited once it is done.
+                        if(!empty_right_range){
+                            stack->emplace(std::move(right_children_v));
+                        }
+                        on_path = !empty_left_range;
+                        vec = std::move(left_children_v);
+                    }
+                }
+                if(on_path){
+                    stack->emplace(std::move(vec));
+                }
+            }
+            if(stack->empty()){
+                //Nothing >= first: next() has to return 0 without starting from the roots.
+                m_var_intersection_last_element[var] = true;
+            }
+            m_var_to_intersection_stack[var] = std::move(stack);
+        }
+
         template<class t_wt, class range_type = sdsl::range_type>
         uint64_t next(var_type var, const std::vector<t_wt*>& p_wts, const std::vector<range_type>& p_ranges)
         {
             using std::get;            
             std::unique_ptr<stack_type> stack;
             
-            if(m_var_intersection_last_element.find(var) != m_var_intersection_last_element.end()
-                && m_var_intersection_last_element[var]
-            ){
+            if(m_var_intersection_last_element[var]){
                 m_var_intersection_last_element[var] = false;
                 return 0;
             }
-            if(m_var_to_intersection_stack.find(var) == m_var_to_intersection_stack.end()){
+            stack = std::move(m_var_to_intersection_stack[var]);
+            if(!stack){
                 stack = std::unique_ptr<stack_type>{new stack_type};
-            }else{
-                stack = std::move(m_var_to_intersection_stack[var]);
             }
             
             stack_vector_type vec;
@@ -347,43 +460,12 @@ namespace ring {
 
         ltj_algorithm_spo_sop() = default;
 
-        ltj_algorithm_spo_sop(const std::vector<triple_pattern>* triple_patterns, ring_type* ring, reverse_ring_type* reverse_ring){
-            m_ptr_triple_patterns = triple_patterns;
+        ltj_algorithm_spo_sop(const std::vector<triple_pattern>* triple_patterns, const ring_type* ring, const reverse_ring_type* reverse_ring){
             m_ptr_ring = ring;
-
             m_ptr_reverse_ring = reverse_ring;
-            size_type i = 0;
-            m_iterators.resize(m_ptr_triple_patterns->size());
-            for(const auto& triple : *m_ptr_triple_patterns){
-                //Bulding iterators
-                m_iterators[i] = ltj_iter_type(&triple, m_ptr_ring, m_ptr_reverse_ring);
-                if(m_iterators[i].is_empty){
-                    m_is_empty = true;
-                    return;
-                }
-
-                //For each variable we add the pointers to its iterators
-                if(triple.o_is_variable()){
-                    add_var_to_iterator(triple.term_o.value, &(m_iterators[i]));
-                }
-                if(triple.p_is_variable()){
-                    add_var_to_iterator(triple.term_p.value, &(m_iterators[i]));
-                }
-                if(triple.s_is_variable()){
-                    add_var_to_iterator(triple.term_s.value, &(m_iterators[i]));
-                }
-
-                ++i;
-            }
-            m_gao_size = gao_size<ring_type, var_type, const_type, ltj_iter_type>(m_ptr_triple_patterns, &m_iterators, m_ptr_ring, m_gao);
-            //m_gao = {'\000', '\001', '\003', '\002'};
-            //m_gao = {'\000', '\002', '\001', '\003'};
-            m_gao_vars.reserve(m_gao_size.m_number_of_variables);
-            /*std::cout << "gao : ";
-            for (auto& g : m_gao){
-                std::cout << int(g) << " ";
-            }
-            std::cout << " " << std::endl;*/
+            if(!this->build(triple_patterns, m_ptr_ring, m_ptr_reverse_ring)) return;
+            m_var_to_intersection_stack.resize(m_var_to_iterators.size());
+            m_var_intersection_last_element.assign(m_var_to_iterators.size(), false);
         }
 
         //! Copy constructor
@@ -407,217 +489,22 @@ namespace ring {
         //! Move Operator=
         ltj_algorithm_spo_sop &operator=(ltj_algorithm_spo_sop &&o) {
             if (this != &o) {
-                m_ptr_triple_patterns = std::move(o.m_ptr_triple_patterns);
-                m_gao = std::move(o.m_gao);
                 m_ptr_ring = std::move(o.m_ptr_ring);
-                m_iterators = std::move(o.m_iterators);
-                m_var_to_iterators = std::move(o.m_var_to_iterators);
-                m_is_empty = o.m_is_empty;
+                m_ptr_reverse_ring = std::move(o.m_ptr_reverse_ring);
+                m_var_to_intersection_stack = std::move(o.m_var_to_intersection_stack);
+                m_var_intersection_last_element = std::move(o.m_var_intersection_last_element);
+                executor_type::move(std::move(o));
             }
             return *this;
         }
 
         void swap(ltj_algorithm_spo_sop &o) {
-            std::swap(m_ptr_triple_patterns, o.m_ptr_triple_patterns);
-            std::swap(m_gao, o.m_gao);
+            executor_type::swap(o);
             std::swap(m_ptr_ring, o.m_ptr_ring);
-            std::swap(m_iterators, o.m_iterators);
-            std::swap(m_var_to_iterators, o.m_var_to_iterators);
-            std::swap(m_is_empty, o.m_is_empty);
-        }
-
-
-        /**
-        *
-        * @param res               Results
-        * @param limit_results     Limit of results
-        * @param timeout_seconds   Timeout in seconds
-        */
-        void join(std::vector<tuple_type> &res,
-                  const size_type limit_results = 0, const size_type timeout_seconds = 0){
-            if(m_is_empty) return;
-            time_point_type start = std::chrono::high_resolution_clock::now();
-            tuple_type t(m_gao_size.m_number_of_variables);
-            search(0, t, res, start, limit_results, timeout_seconds);
-        };
-
-        std::string get_gao(std::unordered_map<uint8_t, std::string>& ht) const{
-            std::string str = "";
-            for(const auto& var : m_gao){
-                str += "?" + ht[var] + " ";
-            }
-            return str;
-        }
-        var_type next(const size_type j) {
-            if(util::configuration.is_adaptive()){
-                var_type var = '\0';
-                const var_type& cur_var = m_gao_stack.top();
-                const std::unordered_map<var_type, bool> & b_vars = m_gao_vars;
-                m_gao_size.update_weights(j, cur_var, b_vars, m_var_to_iterators);
-                var = m_gao_size.get_next_var(j, m_gao_vars);
-                return var;
-            }
-            else{
-                return m_gao[j];
-            }
-        }
-
-        void push_var_to_stack(const var_type& x_j){
-            //assert (m_gao_stack.top() == x_j);
-            m_gao_stack.push(x_j);
-            m_gao_vars[x_j]=true;
-        }
-
-        void pop_var_of_stack(){
-            auto v = m_gao_stack.top();
-            m_gao_stack.pop();
-            m_gao_vars[v]=false;
+            std::swap(m_ptr_reverse_ring, o.m_ptr_reverse_ring);
+            std::swap(m_var_to_intersection_stack, o.m_var_to_intersection_stack);
+            std::swap(m_var_intersection_last_element, o.m_var_intersection_last_element);
         }
-        /**
-         *
-         * @param j                 Index of the variable
-         * @param tuple             Tuple of the current search
-         * @param res               Results
-         * @param start             Initial time to check timeout
-         * @param limit_results     Limit of results
-         * @param timeout_seconds   Timeout in seconds
-         */
-        bool search(const size_type j, tuple_type &tuple, std::vector<tuple_type> &res,
-                    const time_point_type start,
-                    const size_type limit_results = 0, const size_type timeout_seconds = 0){
-
-            //(Optional) Check timeout
-            if(timeout_seconds > 0){
-                time_point_type stop = std::chrono::high_resolution_clock::now();
-                size_type sec = std::chrono::duration_cast<std::chrono::seconds>(stop-start).count();
-                if(sec > timeout_seconds) return false;
-            }
-
-            //(Optional) Check limit
-            if(limit_results > 0 && res.size() == limit_results) return false;
-
-            if(j == m_gao_size.m_number_of_variables){
-                //Report results
-                /*std::cout << "tuple : ";
-                for(auto& pair : tuple){
-                    std::cout << int(pair.first) << " = " << pair.second << std::endl;
-                }
-                std::cout << " " << std::endl;*/
-                res.emplace_back(tuple);
-            }else{
-                //assert(m_gao_stack.size() == m_gao_vars.size());
-                var_type x_j = next(j);
-                //std::cout << "next var: " << int(x_j) << std::endl;
-                push_var_to_stack(x_j);
-                std::vector<ltj_iter_type*>& itrs = m_var_to_iterators[x_j];
-                bool ok;
-                if(itrs.size() == 1 && itrs[0]->in_last_level()) {//Lonely variables
-                    auto results = itrs[0]->seek_all(x_j);
-                    //std::cout << "Results: " << results.size() << std::endl;
-                    for (const auto &c : results) {
-                        //1. Adding result to tuple
-                        tuple[j] = {x_j, c};
-                        //std::cout << "current var: " << int(std::get<0>(tuple[j])) << " = " << std::get<1>(tuple[j]) << std::endl;
-                        //2. Going down in the trie by setting x_j = c (\mu(t_i) in paper)
-                        itrs[0]->down(x_j, c);
-                        //2. Search with the next variable x_{j+1}
-                        ok = search(j + 1, tuple, res, start, limit_results, timeout_seconds);
-                        if(!ok) return false;
-                        //4. Going up in the trie by removing x_j = c
-                        itrs[0]->up(x_j);
-                    }
-                }else {
-                    //std::cout << "Intersecting ";
-                    std::vector<wm_type*> wms;
-                    std::vector<sdsl::range_type> ranges;
-                    //std::vector<bool> wm_range_used = [false, false, false];//S, P, O.
-                    for(ltj_iter_type* iter : itrs){
-                        //Set the index the algorithm will use before the first seek and only in the first level.
-                        if(iter->get_index_permutation() == ""){
-                            iter->set_iter(x_j);
-                        }
-                        //Getting the current interval and WMs of each iterator_x_j.
-                        const auto& cur_interval = iter->get_current_interval(x_j);
-                        const wm_type& current_wm  = iter->get_current_wm(x_j);
-                        //Remember: All the iterators belong to the same variable.
-                        /*for(auto& wm: wms){
-                            if(wm.is_owner_variable_subject)
-                        }*/
-                        wms.emplace_back(&current_wm);
-                        //assert (cur_interval.right() >= cur_interval.left() );
-                        ranges.emplace_back(sdsl::range_type{cur_interval.left(), cur_interval.right()});
-                        //std::cout << "iter used: " << iter->get_index_permutation() << " ( " << cur_interval.left() << " , " << cur_interval.right() << ")" ;
-                    }
-                    //std::cout << "" << std::endl;
-                    
-                    value_type c = next(x_j, wms, ranges);
-                    //std::cout << "Seek (init): (" << (uint64_t) x_j << ": " << c << ")" <<std::endl;
-                    while (c != 0) {
-                        
-                        //1. Adding result to tuple
-                        tuple[j] = {x_j, c};
-                        //std::cout << "current var: " << int(std::get<0>(tuple[j])) << " = " << std::get<1>(tuple[j]) << std::endl;
-                        //2. Going down in the tries by setting x_j = c (\mu(t_i) in paper)
-                        for (ltj_iter_type* iter : itrs) {
-                            iter->down(x_j, c);
-                        }
-                        //3. Search with the next variable x_{j+1}
-                        ok = search(j + 1, tuple, res, start, limit_results, timeout_seconds);
-                        if(!ok) return false;
-                        //4. Going up in the tries by removing x_j = c
-                        for (ltj_iter_type *iter : itrs) {
-                            iter->up(x_j);
-                        }
-
-                        c = next(x_j, wms, ranges);
-                        //std::cout << "Seek (bucle): (" << (uint64_t) x_j << ": " << c << ")" <<std::endl;
-                    }
-                    //Unset type of iterator (SPO / SOP). See logic inside unset_iter() function.
-                    if(util::configuration.is_adaptive()){
-                        for(ltj_iter_type* iter : itrs){
-                            iter->unset_iter(x_j);
-                        }
-                    }
-                }
-                if(util::configuration.is_adaptive()){
-                    m_gao_size.set_previous_weight();
-                }
-                pop_var_of_stack();
-            }
-            return true;
-        };
-
-
-        /**
-         *
-         * @param x_j   Variable
-         * @return      The next constant that matches the intersection between the triples of x_j.
-         *              If the intersection is empty, it returns 0.
-         */
-        /*
-        value_type seek(const var_type x_j, value_type c=-1UL){
-            std::vector<ltj_iter_type*>& itrs = m_var_to_iterators[x_j];
-            
-            if(!is_intersection_calculated(x_j)){
-                //std::cout << "Intersecting ";
-                std::vector<wm_type*> wms;
-                std::vector<sdsl::range_vec_type> ranges;
-                for(ltj_iter_type* iter : itrs){
-                    //Getting the current interval and WMs of each iterator_x_j.
-                    const auto& cur_interval = iter->get_current_interval(x_j);
-                    const wm_type& current_wm  = iter->get_current_wm(x_j);
-                    wms.emplace_back(&current_wm);
-                    //assert (cur_interval.right() >= cur_interval.left() );
-                    ranges.emplace_back(sdsl::range_vec_type{{cur_interval.left(), cur_interval.right()}});
-                    //std::cout << "iter used: " << iter->get_index_permutation() << " ( " << cur_interval.left() << " , " << cur_interval.right() << ")" ;
-                }
-                //std::cout << "" << std::endl;
-                push_intersection(x_j, intersect_iter(wms,ranges));
-            }
-
-            size_type next_value = get_next_value_intersection();
-            return next_value;
-        } */
     };
 
 }
@@ -0,0 +1,761 @@
+/*
+ * ltj_executor.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_LTJ_EXECUTOR_HPP
+#define RING_LTJ_EXECUTOR_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <stack>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <triple_pattern.hpp>
+#include <gao.hpp>
+#include <var_to_iterators.hpp>
+#include <parallel_ltj.hpp>
+#include <result_sink.hpp>
+#include <cancellation.hpp>
+
+namespace ring {
+
+    //! State of an intersection level kept by the engines that do not need any.
+    struct no_level_state {};
+
+    /*!
+     * Resumable search of Leapfrog Triejoin shared by the LTJ engines.
+     * The levels of the GAO are visited with an explicit stack, so the search can be paused and resumed
+     * (cursors), split between workers (parallel join), counted, projected and factorized. Only the
+     * intersection of the variables shared by several iterators depends on the engine, which provides
+     * these members (t_engine derives from this class):
+     *  - value_type first_value(level_type &level, value_type first): first value of the intersection of
+     *    level.var, skipping the ones below 'first' (0 = no bound), or 0 if there are none.
+     *  - value_type seek_next(level_type &level): next value of the intersection after level.value, or 0.
+     *  - void set_index(var_type x_j): (optional) chooses the index of the iterators of x_j before they go down.
+     *  - void close_intersection(level_type &level): (optional) releases the intersection of a finished level.
+     *
+     * \tparam t_engine      Engine (CRTP)
+     * \tparam var_t         Type of the variables
+     * \tparam ltj_iter_t    Iterators of the triple patterns
+     * \tparam gao_size_t    GAO of the engine
+     * \tparam level_state_t State of the intersection of a level, kept by the engine in level_type::state
+     */
+    template<class t_engine, class var_t, class ltj_iter_t, class gao_size_t, class level_state_t = no_level_state>
+    class ltj_executor {
+
+    public:
+        typedef uint64_t value_type;
+        typedef uint64_t size_type;
+        typedef var_t var_type;
+        typedef ltj_iter_t ltj_iter_type;
+        typedef var_to_iterators<ltj_iter_type> var_to_iterators_type;
+        typedef std::vector<std::pair<var_type, value_type>> tuple_type;
+        typedef std::chrono::high_resolution_clock::time_point time_point_type;
+        typedef ltj_task<var_type, value_type> task_type;
+        typedef ltj_scheduler<var_type, value_type> scheduler_type;
+
+        //How a level of the GAO visits the values of its variable (see open_level()).
+        enum level_kind_type : uint8_t {count_level, product_level, lonely_level, intersection_level};
+        typedef struct {
+            var_type var;
+            level_kind_type kind;
+            bool bound;                       //The iterators went down with 'value'
+            value_type value;                 //Current value
+            size_type n;                      //Count mode: number of values
+            std::vector<value_type> values;   //Lonely variable: its values and position of the next one
+            size_type next;
+            level_state_t state;              //Intersection: state kept by the engine
+        } level_type;
+
+    protected:
+        const std::vector<triple_pattern>* m_ptr_triple_patterns;
+        std::vector<var_type> m_gao; //TODO: should be a class
+        std::stack<var_type> m_gao_stack;
+        //m_gao_vars is a bitmap representation of the m_gao_stack, indexed by variable id: everything in m_gao_stack is true in this structure.
+        std::vector<bool> m_gao_vars;
+        std::vector<ltj_iter_type> m_iterators;
+        var_to_iterators_type m_var_to_iterators;
+        bool m_is_empty = false;
+        gao_size_t m_gao_size;
+        ltj_splitter<var_type, value_type> m_splitter;
+        //Values of the current result, indexed by variable id, and number of results reported.
+        std::vector<value_type> m_row;
+        size_type m_number_of_results = 0;
+        //Count mode (see count()): results represented by the current bindings.
+        bool m_count_only = false;
+        size_type m_multiplier = 1;
+        //Projection (see set_projection()): number of reported variables, bound in the first levels of the GAO,
+        //and whether the search of the next levels found a binding of the other variables.
+        size_type m_projection_size = 0;
+        bool m_witness = false;
+        //Factorized output (see prepare_product()): lonely variables of the last levels and their values.
+        std::vector<size_type> m_product_vars;
+        std::vector<std::vector<value_type>> m_product_lists;
+        //Stops the search when the join is cancelled or times out.
+        cancellation_check m_cancel;
+        //Explicit stack of the search (see resume()): state of the levels being visited, first level of the search,
+        //level where it stopped and whether it has to enter it, and values of the bound variables.
+        //The values of a lonely variable are kept in its level, so its buffer is reused by every binding of the parents.
+        std::vector<level_type> m_levels;
+        size_type m_base = 0;
+        size_type m_level = 0;
+        bool m_descend = true;
+        bool m_done = false;
+        tuple_type m_tuple;
+        //Cursor (see start()): the search pauses once it reports m_pause results (0 = never).
+        bool m_cursor = false;
+        size_type m_pause = 0;
+
+        inline t_engine &engine(){
+            return *static_cast<t_engine*>(this);
+        }
+
+        /**
+         * Builds the iterators of the triple patterns and the GAO.
+         *
+         * @param triple_patterns   Triple patterns of the join
+         * @param ring              Ring used by the GAO
+         * @param rings             Rings given to the iterators (the first one is 'ring')
+         * @return                  False if the join is empty
+         */
+        template<class ring_t, class... t_rings>
+        bool build(const std::vector<triple_pattern>* triple_patterns, const ring_t* ring, const t_rings*... rings){
+            m_ptr_triple_patterns = triple_patterns;
+            size_type i = 0;
+            m_iterators.resize(m_ptr_triple_patterns->size());
+            for(const auto& triple : *m_ptr_triple_patterns){
+                //Bulding iterators
+                m_iterators[i] = ltj_iter_type(&triple, ring, rings...);
+                if(m_iterators[i].is_empty){
+                    m_is_empty = true;
+                    return false;
+                }
+
+                //For each variable we add the pointers to its iterators
+                if(triple.o_is_variable()){
+                    add_var_to_iterator(triple.term_o.value, &(m_iterators[i]));
+                }
+                if(triple.p_is_variable()){
+                    add_var_to_iterator(triple.term_p.value, &(m_iterators[i]));
+                }
+                if(triple.s_is_variable()){
+                    add_var_to_iterator(triple.term_s.value, &(m_iterators[i]));
+                }
+                ++i;
+            }
+            m_gao_size = gao_size_t(m_ptr_triple_patterns, &m_iterators, ring, m_gao);
+            m_gao_vars.assign(m_var_to_iterators.size(), false);
+            m_projection_size = m_gao_size.m_number_of_variables;
+            return true;
+        }
+
+        void copy(const ltj_executor &o) {
+            m_ptr_triple_patterns = o.m_ptr_triple_patterns;
+            m_gao = o.m_gao;
+            m_gao_stack = o.m_gao_stack;
+            m_gao_vars = o.m_gao_vars;
+            m_iterators = o.m_iterators;
+            //The copied pointers have to refer to the copied iterators
+            m_var_to_iterators = o.m_var_to_iterators;
+            m_var_to_iterators.rebase(o.m_iterators.data(), m_iterators.data());
+            m_is_empty = o.m_is_empty;
+            m_gao_size = o.m_gao_size;
+            m_gao_size.set_iterators(&m_iterators);
+            m_splitter = o.m_splitter;
+            m_count_only = o.m_count_only;
+            m_projection_size = o.m_projection_size;
+        }
+
+        void move(ltj_executor &&o) {
+            m_ptr_triple_patterns = std::move(o.m_ptr_triple_patterns);
+            m_gao = std::move(o.m_gao);
+            m_gao_stack = std::move(o.m_gao_stack);
+            m_gao_vars = std::move(o.m_gao_vars);
+            m_iterators = std::move(o.m_iterators);
+            m_var_to_iterators = std::move(o.m_var_to_iterators);
+            m_is_empty = o.m_is_empty;
+            m_gao_size = std::move(o.m_gao_size);
+            //The GAO refers to the vector of iterators, which is now this one
+            m_gao_size.set_iterators(&m_iterators);
+            m_splitter = std::move(o.m_splitter);
+            m_row = std::move(o.m_row);
+            m_number_of_results = o.m_number_of_results;
+            m_count_only = o.m_count_only;
+            m_multiplier = o.m_multiplier;
+            m_projection_size = o.m_projection_size;
+            m_witness = o.m_witness;
+            m_product_vars = std::move(o.m_product_vars);
+            m_product_lists = std::move(o.m_product_lists);
+            m_cancel = o.m_cancel;
+            m_levels = std::move(o.m_levels);
+            m_base = o.m_base;
+            m_level = o.m_level;
+            m_descend = o.m_descend;
+            m_done = o.m_done;
+            m_tuple = std::move(o.m_tuple);
+            m_cursor = o.m_cursor;
+            m_pause = o.m_pause;
+        }
+
+        void swap(ltj_executor &o) {
+            std::swap(m_ptr_triple_patterns, o.m_ptr_triple_patterns);
+            std::swap(m_gao, o.m_gao);
+            std::swap(m_gao_stack, o.m_gao_stack);
+            std::swap(m_gao_vars, o.m_gao_vars);
+            //The buffers of the iterators are exchanged, so the pointers of m_var_to_iterators stay valid
+            std::swap(m_iterators, o.m_iterators);
+            std::swap(m_var_to_iterators, o.m_var_to_iterators);
+            std::swap(m_is_empty, o.m_is_empty);
+            std::swap(m_gao_size, o.m_gao_size);
+            m_gao_size.set_iterators(&m_iterators);
+            o.m_gao_size.set_iterators(&o.m_iterators);
+            std::swap(m_splitter, o.m_splitter);
+            std::swap(m_row, o.m_row);
+            std::swap(m_number_of_results, o.m_number_of_results);
+            std::swap(m_count_only, o.m_count_only);
+            std::swap(m_multiplier, o.m_multiplier);
+            std::swap(m_projection_size, o.m_projection_size);
+            std::swap(m_witness, o.m_witness);
+            std::swap(m_product_vars, o.m_product_vars);
+            std::swap(m_product_lists, o.m_product_lists);
+            std::swap(m_cancel, o.m_cancel);
+            std::swap(m_levels, o.m_levels);
+            std::swap(m_base, o.m_base);
+            std::swap(m_level, o.m_level);
+            std::swap(m_descend, o.m_descend);
+            std::swap(m_done, o.m_done);
+            std::swap(m_tuple, o.m_tuple);
+            std::swap(m_cursor, o.m_cursor);
+            std::swap(m_pause, o.m_pause);
+        }
+
+        //! Number of values of the rows reported to the sinks, also when the join is empty.
+        size_type row_width() const{
+            return m_is_empty ? number_of_variables(*m_ptr_triple_patterns) : m_gao_size.m_number_of_variables;
+        }
+
+        inline void add_var_to_iterator(const var_type var, ltj_iter_type* ptr_iterator){
+            m_var_to_iterators.add(var, ptr_iterator);
+        }
+
+        //Default hooks of the engines.
+        void set_index(const var_type){}
+
+        void close_intersection(level_type &){}
+
+    public:
+
+        /**
+        *
+        * @param sink              Receives the results as they are produced
+        * @param limit_results     Limit of results
+        * @param timeout_millis    Timeout in milliseconds
+        * @param threads           Number of threads evaluating the join (see parallel_join)
+        * @param token             Cancels the join from another thread (optional)
+        * @return                  Number of results
+        */
+        size_type join(result_sink &sink,
+                       const size_type limit_results = 0, const size_type timeout_millis = 0,
+                       const size_type threads = 1, cancellation_token *token = nullptr){
+            if(m_is_empty){
+                //The sink still sees the beginning and the end of a join without results.
+                m_number_of_results = 0;
+                sink.begin(row_width());
+                sink.end();
+                return 0;
+            }
+            cancellation_token timeout_token;
+            if(token == nullptr && timeout_millis > 0) token = &timeout_token;
+            if(token != nullptr) token->set_timeout(timeout_millis);
+            sink.begin(row_width());
+            if(threads > 1){
+                //Every worker copies the engine, not only this part of it
+                m_number_of_results = parallel_join(engine(), sink, limit_results, token, threads);
+            }else{
+                m_cancel = cancellation_check(token);
+                m_tuple = tuple_type(m_gao_size.m_number_of_variables);
+                m_row.assign(m_gao_size.m_number_of_variables, 0);
+                m_number_of_results = 0;
+                m_witness = false;
+                search(0, sink, limit_results);
+            }
+            sink.end();
+            return m_number_of_results;
+        };
+
+        /**
+        * Counts the results of the join (COUNT(*)).
+        * The values of the lonely variables of the last level are not enumerated: each one of these
+        * variables multiplies the results by the size of its interval, which holds different values
+        * because the triples are distinct.
+        *
+        * @param timeout_millis    Timeout in milliseconds
+        * @param threads           Number of threads evaluating the join (see parallel_join)
+        * @param token             Cancels the join from another thread (optional)
+        * @return                  Number of results
+        */
+        size_type count(const size_type timeout_millis = 0, const size_type threads = 1,
+                        cancellation_token *token = nullptr){
+            count_sink sink;
+            m_count_only = true;
+            size_type n = join(sink, 0, timeout_millis, threads, token);
+            m_count_only = false;
+            return n;
+        }
+
+        /**
+        * Restricts the results to the values of some variables (SELECT DISTINCT).
+        * The projected variables are bound in the first levels of the GAO. For each binding of them, the
+        * search of the next levels stops as soon as it finds a result, so the reported rows are different.
+        * The values of the variables that are not projected are 0. It must be called before the join.
+        *
+        * @param projection        Projected variables
+        */
+        void set_projection(const std::vector<var_type> &projection){
+            if(m_is_empty) return;
+            m_projection_size = m_gao_size.set_projection(projection, m_gao);
+        }
+
+        //! Number of results reported by the last search.
+        size_type number_of_results() const{
+            return m_number_of_results;
+        }
+
+        /**
+        * Starts a join whose results are taken a batch at a time with next_batch(). Between two batches the
+        * search keeps its state, so it resumes where it paused. The products of lonely variables are flattened.
+        */
+        void start(){
+            m_cursor = true;
+            m_tuple = tuple_type(m_gao_size.m_number_of_variables);
+            m_row.assign(m_gao_size.m_number_of_variables, 0);
+            m_number_of_results = 0;
+            m_witness = false;
+            m_levels.resize(m_gao_size.m_number_of_variables);
+            m_base = m_level = 0;
+            m_descend = true;
+            m_done = m_is_empty;
+        }
+
+        /**
+        * Reports the next results of the join started by start().
+        *
+        * @param sink              Receives the results
+        * @param n                 Maximum number of results (0 = all the remaining ones)
+        * @param token             Cancels the batch, which can be resumed by the next one (optional)
+        * @return                  Number of results of the batch
+        */
+        size_type next_batch(result_sink &sink, const size_type n, cancellation_token *token = nullptr){
+            if(m_done){
+                sink.begin(row_width());
+                sink.end();
+                return 0;
+            }
+            const size_type before = m_number_of_results;
+            m_pause = (n == 0) ? 0 : before + n;
+            m_cancel = cancellation_check(token);
+            sink.begin(row_width());
+            resume(sink);
+            sink.end();
+            m_pause = 0;
+            return m_number_of_results - before;
+        }
+
+        //! True once the join started by start() has no more results.
+        bool done() const{
+            return m_done;
+        }
+
+        /**
+        *
+        * @param res               Results, one tuple (pairs variable - value, by variable id) per result
+        * @param limit_results     Limit of results
+        * @param timeout_millis    Timeout in milliseconds
+        * @param threads           Number of threads evaluating the join (see parallel_join)
+        */
+        void join(std::vector<tuple_type> &res,
+                  const size_type limit_results = 0, const size_type timeout_millis = 0,
+                  const size_type threads = 1){
+            tuple_sink<tuple_type> sink(res);
+            join(sink, limit_results, timeout_millis, threads);
+        };
+
+        /**
+        * Evaluates the part of the join given by a task of a parallel join.
+        *
+        * @param task              Values of the first variables and range of values of the next one
+        * @param scheduler         Scheduler of the parallel join
+        * @param sink              Receives the results
+        * @param token             Cancellation of the join (optional)
+        * @return                  False if the search was interrupted
+        */
+        bool run_task(const task_type &task, scheduler_type* scheduler, result_sink &sink,
+                      cancellation_token *token = nullptr){
+            m_cancel = cancellation_check(token);
+            m_splitter.set_scheduler(scheduler, m_gao_size.m_number_of_variables);
+            m_splitter.set_task(task);
+            m_tuple = tuple_type(m_gao_size.m_number_of_variables);
+            m_row.assign(m_gao_size.m_number_of_variables, 0);
+            m_number_of_results = 0;
+            m_witness = false;
+            m_multiplier = 1;
+            //Binding the variables of the prefix as the search that created the task did
+            for(size_type i = 0; i < task.prefix.size(); ++i){
+                var_type x_i = next(i);
+                push_var_to_stack(x_i);
+                m_tuple[i] = task.prefix[i];
+                const auto itrs = m_var_to_iterators[x_i];
+                if(m_count_only && itrs.size() == 1 && itrs[0]->in_last_level()){
+                    m_multiplier *= itrs[0]->count_all(x_i);
+                    continue;
+                }
+                if(itrs.size() > 1 || !itrs[0]->in_last_level()){
+                    engine().set_index(x_i);
+                }
+                for(ltj_iter_type* iter : itrs){
+                    iter->down(x_i, m_tuple[i].second);
+                }
+            }
+            return search(task.prefix.size(), sink);
+        }
+
+        std::string get_gao(std::unordered_map<uint8_t, std::string>& ht) const{
+            std::string str = "";
+            for(const auto& var : m_gao){
+                str += "?" + ht[var] + " ";
+            }
+            return str;
+        }
+
+        var_type next(const size_type j) {
+            if(util::configuration.is_adaptive()){
+                var_type var = '\0';
+                const var_type& cur_var = m_gao_stack.top();
+                m_gao_size.update_weights(j, cur_var, m_gao_vars, m_var_to_iterators);
+                var = m_gao_size.get_next_var(j, m_gao_vars);
+                return var;
+            }
+            else{
+                return m_gao[j];
+            }
+        }
+
+        void push_var_to_stack(const var_type& x_j){
+            //assert (m_gao_stack.top() == x_j);
+            m_gao_stack.push(x_j);
+            m_gao_vars[x_j]=true;
+        }
+
+        void pop_var_of_stack(){
+            auto v = m_gao_stack.top();
+            m_gao_stack.pop();
+            m_gao_vars[v]=false;
+        }
+
+        /**
+         * Reports the values of the projected variables, which are the first ones of the tuple.
+         *
+         * @param tuple             Tuple of the current search
+         * @param sink              Receives the results
+         * @return                  False if the search has to stop
+         */
+        bool report(const tuple_type &tuple, result_sink &sink){
+            if(m_count_only){
+                m_number_of_results += m_multiplier;
+                return true;
+            }
+            if(!m_splitter.add_result()) return false;
+            ++m_number_of_results;
+            for(size_type i = 0; i < m_projection_size; ++i){
+                m_row[tuple[i].first] = tuple[i].second;
+            }
+            return sink.push(m_row.data());
+        }
+
+        /**
+         * Checks whether the variables of the levels [j, n) are lonely variables whose iterators are in the
+         * last level, so their values are independent, and keeps the values of each one of them.
+         * Products are only reported when all their results fit in the limit.
+         *
+         * @param j                 Index of the variable
+         * @param x_j               Variable of the level j, which is lonely
+         * @param limit_results     Limit of results
+         * @return                  True if the results of the next levels have to be reported as a product
+         */
+        bool prepare_product(const size_type j, const var_type x_j, const size_type limit_results){
+            if(m_count_only || m_cursor || m_projection_size < m_gao_size.m_number_of_variables) return false;
+            m_product_vars.clear();
+            m_product_vars.push_back(x_j);
+            for(size_type var = 0; var < m_var_to_iterators.size(); ++var){
+                const auto itrs = m_var_to_iterators[var];
+                if(var == x_j || itrs.empty() || m_gao_vars[var]) continue;
+                if(itrs.size() > 1 || !itrs[0]->in_last_level()) return false;
+                m_product_vars.push_back(var);
+            }
+            if(j + m_product_vars.size() != m_gao_size.m_number_of_variables) return false;
+            m_product_lists.resize(m_product_vars.size());
+            size_type n = 1;
+            for(size_type i = 0; i < m_product_vars.size(); ++i){
+                m_var_to_iterators[m_product_vars[i]][0]->seek_all(m_product_vars[i], m_product_lists[i]);
+                n *= m_product_lists[i].size();
+            }
+            if(limit_results > 0 && m_number_of_results + n > limit_results) return false;
+            if(!m_splitter.add_results(n)) return false;
+            m_number_of_results += n;
+            return true;
+        }
+
+        /**
+         * Reports the results of the product prepared by prepare_product.
+         *
+         * @param j                 Index of the variable
+         * @param tuple             Tuple of the current search
+         * @param sink              Receives the results
+         * @return                  False if the search has to stop
+         */
+        bool report_product(const size_type j, const tuple_type &tuple, result_sink &sink){
+            for(size_type i = 0; i < j; ++i){
+                m_row[tuple[i].first] = tuple[i].second;
+            }
+            return sink.push_product(m_row.data(), m_product_vars, m_product_lists);
+        }
+
+        /**
+         * Evaluates the levels [j, n) of the GAO, the previous ones being bound.
+         *
+         * @param j                 Index of the variable
+         * @param sink              Receives the results
+         * @param limit_results     Limit of results
+         * @return                  False if the search was interrupted
+         */
+        bool search(const size_type j, result_sink &sink, const size_type limit_results = 0){
+            m_levels.resize(m_gao_size.m_number_of_variables);
+            m_base = m_level = j;
+            m_descend = true;
+            m_done = false;
+            return resume(sink, limit_results);
+        }
+
+        /**
+         * Goes on with the search from the level where it stopped. Instead of recursion, the state of the
+         * levels being visited is kept in m_levels, so the search can be paused (see next_batch) and
+         * resumed later without visiting again the values already visited.
+         *
+         * @param sink              Receives the results
+         * @param limit_results     Limit of results
+         * @return                  False if the search was interrupted or paused
+         */
+        bool resume(result_sink &sink, const size_type limit_results = 0){
+            if(m_done) return true;
+            const size_type n = m_gao_size.m_number_of_variables;
+            size_type j = m_level;
+            bool descend = m_descend;
+            while(true){
+                if(descend){
+                    //(Optional) Check cancellation, timeout and limit, and (parallel join) whether another worker stopped the join
+                    if(m_cancel.stop() || (limit_results > 0 && m_number_of_results == limit_results) || m_splitter.stopped()){
+                        m_level = j;
+                        m_descend = true;
+                        return false;
+                    }
+                    //(Parallel join) Share the remaining work. Only the levels of projected variables are shared,
+                    //the others stop at the first result.
+                    m_splitter.share(m_tuple, std::min(j, m_projection_size));
+                    if(j == n){
+                        //Report results
+                        if(j > m_projection_size){
+                            //A binding of the variables that are not projected, whose values are reported by their level
+                            m_witness = true;
+                        }else if(!report(m_tuple, sink)){
+                            m_done = true;
+                            return false;
+                        }
+                        if(j == m_base){
+                            m_done = true;
+                            return true;
+                        }
+                        --j;
+                        descend = false;
+                        if(paused()){
+                            m_level = j;
+                            m_descend = false;
+                            return false;
+                        }
+                        continue;
+                    }
+                    if(!open_level(j, sink, limit_results)){
+                        m_done = true;
+                        return false;
+                    }
+                }
+                //Going down with the next value of x_j, or up once its values are over
+                if(next_value(j)){
+                    ++j;
+                    descend = true;
+                    continue;
+                }
+                if(!close_level(j, sink)){
+                    m_done = true;
+                    return false;
+                }
+                if(j == m_base){
+                    m_done = true;
+                    return true;
+                }
+                --j;
+                descend = false;
+                if(paused()){
+                    m_level = j;
+                    m_descend = false;
+                    return false;
+                }
+            }
+        }
+
+        //! True if the cursor has to pause the search.
+        inline bool paused() const{
+            return m_pause > 0 && m_number_of_results >= m_pause;
+        }
+
+        /**
+         * Chooses the variable of the level j and how its values are visited.
+         *
+         * @param j                 Index of the variable
+         * @param sink              Receives the results
+         * @param limit_results     Limit of results
+         * @return                  False if the search has to stop
+         */
+        bool open_level(const size_type j, result_sink &sink, const size_type limit_results){
+            //assert(m_gao_stack.size() == m_gao_vars.size());
+            var_type x_j = next(j);
+            push_var_to_stack(x_j);
+            level_type &level = m_levels[j];
+            level.var = x_j;
+            level.bound = false;
+            const auto itrs = m_var_to_iterators[x_j];
+            if(m_count_only && itrs.size() == 1 && itrs[0]->in_last_level()) {//Lonely variables (count mode)
+                //No other variable depends on x_j, so each one of its values multiplies the results of the next levels
+                level.kind = count_level;
+                level.n = itrs[0]->count_all(x_j);
+            }else if(itrs.size() == 1 && itrs[0]->in_last_level() && prepare_product(j, x_j, limit_results)) {//Lonely variables (factorized)
+                //The next levels only hold lonely variables, whose values are reported once as a product of lists
+                level.kind = product_level;
+                if(!report_product(j, m_tuple, sink)) return false;
+            }else if(itrs.size() == 1 && itrs[0]->in_last_level()) {//Lonely variables
+                level.kind = lonely_level;
+                itrs[0]->seek_all(x_j, level.values);
+                level.next = 0;
+            }else {
+                level.kind = intersection_level;
+                //Set the index the algorithm will use before the first seek and only in the first level.
+                engine().set_index(x_j);
+                //The values of x_j can be restricted to a range in a parallel join
+                m_splitter.open(j);
+                level.value = engine().first_value(level, m_splitter.first(j));
+            }
+            return true;
+        }
+
+        /**
+         * Binds the next value of the variable of the level j, once the current one is unbound.
+         *
+         * @param j                 Index of the variable
+         * @return                  False if there are no more values
+         */
+        bool next_value(const size_type j){
+            level_type &level = m_levels[j];
+            const var_type x_j = level.var;
+            const auto itrs = m_var_to_iterators[x_j];
+            switch(level.kind){
+                case count_level:
+                    if(level.bound){
+                        m_multiplier /= level.n;
+                        level.bound = false;
+                        return false;
+                    }
+                    if(level.n == 0) return false;
+                    m_multiplier *= level.n;
+                    level.bound = true;
+                    return true;
+                case product_level:
+                    return false;
+                case lonely_level:
+                    if(level.bound){
+                        //Going up in the trie by removing x_j = c
+                        itrs[0]->up(x_j);
+                        level.bound = false;
+                        //The variables that are not projected only need one binding
+                        if(m_witness) return false;
+                    }
+                    if(level.next == level.values.size()) return false;
+                    level.value = level.values[level.next++];
+                    //Adding result to tuple and going down in the trie by setting x_j = c (\mu(t_i) in paper)
+                    m_tuple[j] = {x_j, level.value};
+                    itrs[0]->down(x_j, level.value);
+                    level.bound = true;
+                    return true;
+                default:
+                    if(level.bound){
+                        //Going up in the tries by removing x_j = c
+                        for (ltj_iter_type *iter : itrs) {
+                            iter->up(x_j);
+                        }
+                        level.bound = false;
+                        if(m_witness) return false;
+                        //Next constant for x_j
+                        level.value = engine().seek_next(level);
+                    }
+                    if(level.value == 0 || level.value > m_splitter.last(j)) return false; //If empty c=0
+                    //Adding result to tuple and going down in the tries by setting x_j = c (\mu(t_i) in paper)
+                    m_tuple[j] = {x_j, level.value};
+                    for (ltj_iter_type* iter : itrs) {
+                        iter->down(x_j, level.value);
+                    }
+                    level.bound = true;
+                    return true;
+            }
+        }
+
+        /**
+         * Finishes the level j once its values are over.
+         *
+         * @param j                 Index of the variable
+         * @param sink              Receives the results
+         * @return                  False if the search has to stop
+         */
+        bool close_level(const size_type j, result_sink &sink){
+            level_type &level = m_levels[j];
+            if(level.kind == intersection_level){
+                m_splitter.close(j);
+                engine().close_intersection(level);
+            }
+            if(j == m_projection_size && m_witness){
+                //The values of the projected variables have a binding of the other ones
+                m_witness = false;
+                if(!report(m_tuple, sink)) return false;
+            }
+            if(util::configuration.is_adaptive()){
+                m_gao_size.set_previous_weight();
+            }
+            pop_var_of_stack();
+            return true;
+        }
+    };
+}
+
+#endif //RING_LTJ_EXECUTOR_HPP
@@ -43,11 +43,13 @@ namespace ring {
         typedef ltj_iterator<ring_type, var_type, value_type> ltj_iter_type;
         typedef ltj_reverse_iterator<reverse_ring_type, var_type, value_type> ltj_reverse_iter_type;
         typedef sdsl::wm_int<bwt_bit_vector_t> wm_type;
+        //Index used by the iterator: none yet, SPO or SOP.
+        enum index_type : uint8_t {no_index, spo_index, sop_index};
 
     private:
         const triple_pattern *m_ptr_triple_pattern;
-        ring_type *m_ptr_ring; //TODO: should be const
-        reverse_ring_type *m_ptr_reverse_ring;
+        const ring_type *m_ptr_ring;
+        const reverse_ring_type *m_ptr_reverse_ring;
         //TODO: fix, Currently all the members below are used exclusively to precalculate gao and to do so we use SPO index values.
         bwt_interval m_i_s;
         bwt_interval m_i_o;
@@ -60,7 +62,7 @@ namespace ring {
         ltj_iter_type spo_iter;
         ltj_reverse_iter_type sop_iter;
         //Stores whether the SPO iterator or the SOP iterator has to be used with the variable below.
-        std::string m_last_iter;
+        index_type m_last_iter = no_index;
         //Stores the variable that 'owns' the iterator. This means the following:
         //Any variable which set 'm_last_iter' is flagged as owner, which is useful by adaptive algorithms to 'release' or 'unset' the iterator when needed.
         var_type m_var_owner;
@@ -77,6 +79,8 @@ namespace ring {
             m_is_empty = o.m_is_empty;
             spo_iter = o.spo_iter;
             sop_iter = o.sop_iter;
+            m_last_iter = o.m_last_iter;
+            m_var_owner = o.m_var_owner;
         }
     public:
 
@@ -92,16 +96,17 @@ namespace ring {
             return m_ptr_triple_pattern->term_o.is_variable && m_var_owner == m_ptr_triple_pattern->term_o.value;
         }
 
-        inline bool is_variable_subject(var_type var) {
-            return m_ptr_triple_pattern->term_s.is_variable && var == m_ptr_triple_pattern->term_s.value;
+        //The roles of the variables are kept by the iterators, so the pattern is not read on every call.
+        inline bool is_variable_subject(var_type var) const {
+            return spo_iter.is_variable_subject(var);
         }
 
-        inline bool is_variable_predicate(var_type var) {
-            return m_ptr_triple_pattern->term_p.is_variable && var == m_ptr_triple_pattern->term_p.value;
+        inline bool is_variable_predicate(var_type var) const {
+            return spo_iter.is_variable_predicate(var);
         }
 
-        inline bool is_variable_object(var_type var) {
-            return m_ptr_triple_pattern->term_o.is_variable && var == m_ptr_triple_pattern->term_o.value;
+        inline bool is_variable_object(var_type var) const {
+            return spo_iter.is_variable_object(var);
         }
 
         const bool &is_empty = m_is_empty;
@@ -111,7 +116,7 @@ namespace ring {
 
         ltj_iterator_manager() = default;
 
-        ltj_iterator_manager(const triple_pattern *triple, ring_type *ring, reverse_ring_type *reverse_ring) : m_last_iter(""), m_var_owner('\0') {
+        ltj_iterator_manager(const triple_pattern *triple, const ring_type *ring, const reverse_ring_type *reverse_ring) : m_last_iter(no_index), m_var_owner('\0') {
             m_ptr_triple_pattern = triple;
             m_ptr_ring = ring;
             m_ptr_reverse_ring = reverse_ring;
@@ -173,11 +178,21 @@ namespace ring {
                 m_ptr_reverse_ring = std::move(o.m_ptr_reverse_ring);
                 spo_iter = std::move(o.spo_iter);
                 sop_iter = std::move(o.sop_iter);
+                m_last_iter = std::move(o.m_last_iter);
+                m_var_owner = o.m_var_owner;
             }
             return *this;
         }
         std::string get_index_permutation() const{
-            return m_last_iter;
+            switch(m_last_iter){
+                case spo_index: return "SPO";
+                case sop_index: return "SOP";
+                default: return "";
+            }
+        }
+        //! True once set_iter chose the index of the iterator.
+        inline bool has_index() const{
+            return m_last_iter != no_index;
         }
         void swap(ltj_iterator_manager &o) {
             // m_bp.swap(bp_support.m_bp); use set_vector to set the supported bit_vector
@@ -197,7 +212,7 @@ namespace ring {
         /*Unset the variable iterator ownership. Only used by adaptive algorithms.*/
         void unset_iter(var_type var_owner){
             if(var_owner == m_var_owner){
-                m_last_iter ="";
+                m_last_iter = no_index;
             }
         }
         void set_iter(var_type var){
@@ -205,37 +220,37 @@ namespace ring {
             if (is_variable_subject(var)) {
                 if (m_cur_o != -1UL && m_cur_p != -1UL){
                     //OP->S
-                    m_last_iter = "SPO";
+                    m_last_iter = spo_index;
                     return;
                 } else if (m_cur_o != -1UL) {
                     //OS->P
-                    m_last_iter = "SOP";
+                    m_last_iter = sop_index;
                 } else if (m_cur_p != -1UL) {
                     //PS->O
-                    m_last_iter = "SPO";
+                    m_last_iter = spo_index;
                 }
             } else if (is_variable_predicate(var)) {
                 if (m_cur_s != -1UL && m_cur_o != -1UL){
-                    m_last_iter = "SPO";
+                    m_last_iter = spo_index;
                     return;
                 } else if (m_cur_o != -1UL) {
                     //OP->S
-                    m_last_iter = "SPO";
+                    m_last_iter = spo_index;
                 } else if (m_cur_s != -1UL) {
                     //SP->O
-                    m_last_iter = "SOP";
+                    m_last_iter = sop_index;
                 }
             } else if (is_variable_object(var)) {
                 if (m_cur_s != -1UL && m_cur_p != -1UL){
-                    m_last_iter = "SPO";
+                    m_last_iter = spo_index;
                     return;
                 }
                 if (m_cur_p != -1UL) {
                     //PO->S
-                    m_last_iter = "SOP";
+                    m_last_iter = sop_index;
                 } else if (m_cur_s != -1UL) {
                     //SO->P
-                    m_last_iter = "SPO";
+                    m_last_iter = spo_index;
                 }
             }
         }
@@ -243,7 +258,7 @@ namespace ring {
             //spo_iter.down(var,c);
             if (is_variable_subject(var)) {
                 if (m_cur_o != -1UL && m_cur_p != -1UL){
-                    /*if(m_last_iter == "SPO"){
+                    /*if(m_last_iter == spo_index){
                         spo_iter.down(var,c);
                     } else{
                         sop_iter.down(var,c);
@@ -252,11 +267,11 @@ namespace ring {
                 } else if (m_cur_o != -1UL) {
                     //OS->P
                     sop_iter.down(var,c);
-                    //m_last_iter = "SOP";
+                    //m_last_iter = sop_index;
                 } else if (m_cur_p != -1UL) {
                     //PS->O
                     spo_iter.down(var,c);
-                    //m_last_iter = "SPO";
+                    //m_last_iter = spo_index;
                 } else {
                     //S->{OP,PO} same range in SOP and SPO
                     spo_iter.down(var,c);
@@ -265,7 +280,7 @@ namespace ring {
                 m_cur_s = c;
             } else if (is_variable_predicate(var)) {
                 if (m_cur_s != -1UL && m_cur_o != -1UL){
-                    /*if(m_last_iter == "SPO"){
+                    /*if(m_last_iter == spo_index){
                         spo_iter.down(var,c);
                     } else{
                         sop_iter.down(var,c);
@@ -274,11 +289,11 @@ namespace ring {
                 } else if (m_cur_o != -1UL) {
                     //OP->S
                     spo_iter.down(var,c);
-                    //m_last_iter = "SPO";
+                    //m_last_iter = spo_index;
                 } else if (m_cur_s != -1UL) {
                     //SP->O
                     sop_iter.down(var,c);
-                    //m_last_iter = "SOP";
+                    //m_last_iter = sop_index;
                 } else {
                     //P->{OS,SO} same range in POS and PSO
                     spo_iter.down(var,c);
@@ -287,7 +302,7 @@ namespace ring {
                 m_cur_p = c;
             } else if (is_variable_object(var)) {
                 if (m_cur_s != -1UL && m_cur_p != -1UL){
-                    /*if(m_last_iter == "SPO"){
+                    /*if(m_last_iter == spo_index){
                         spo_iter.down(var,c);
                     } else{
                         sop_iter.down(var,c);
@@ -297,11 +312,11 @@ namespace ring {
                 if (m_cur_p != -1UL) {
                     //PO->S
                     sop_iter.down(var,c);
-                    //m_last_iter = "SOP";
+                    //m_last_iter = sop_index;
                 } else if (m_cur_s != -1UL) {
                     //SO->P
                     spo_iter.down(var,c);
-                    //m_last_iter = "SPO";
+                    //m_last_iter = spo_index;
                 } else {
                     //O->{PS,SP} same range in OPS and OSP
                     spo_iter.down(var,c);
@@ -316,13 +331,13 @@ namespace ring {
             //spo_iter.up(var);
             if (is_variable_subject(var)) {
                 if (m_cur_o != -1UL && m_cur_p != -1UL){ //leaf of virtual trie.
-                    if(m_last_iter == "SPO"){
+                    if(m_last_iter == spo_index){
                         spo_iter.up(var);
                     } else{
                         sop_iter.up(var);
                     }
                 } else if (m_cur_o != -1UL || m_cur_p != -1UL) {//second level nodes.
-                    if(m_last_iter == "SPO"){
+                    if(m_last_iter == spo_index){
                         spo_iter.up(var);
                     } else{
                         sop_iter.up(var);
@@ -334,13 +349,13 @@ namespace ring {
                 m_cur_s = -1UL;
             } else if (is_variable_predicate(var)) {
                 if (m_cur_s != -1UL && m_cur_o != -1UL){
-                    if(m_last_iter == "SPO"){
+                    if(m_last_iter == spo_index){
                         spo_iter.up(var);
                     } else{
                         sop_iter.up(var);
                     }
                 } else if (m_cur_o != -1UL || m_cur_s != -1UL) {
-                    if(m_last_iter == "SPO"){
+                    if(m_last_iter == spo_index){
                         spo_iter.up(var);
                     } else{
                         sop_iter.up(var);
@@ -352,14 +367,14 @@ namespace ring {
                 m_cur_p = -1UL;
             } else if (is_variable_object(var)) {
                 if (m_cur_s != -1UL && m_cur_p != -1UL){
-                    if(m_last_iter == "SPO"){
+                    if(m_last_iter == spo_index){
                         spo_iter.up(var);
                     } else{
                         sop_iter.up(var);
                     }
                 }
                 if (m_cur_p != -1UL || m_cur_s != -1UL) {
-                    if(m_last_iter == "SPO"){
+                    if(m_last_iter == spo_index){
                         spo_iter.up(var);
                     } else{
                         sop_iter.up(var);
@@ -374,7 +389,7 @@ namespace ring {
 
         bool in_last_level(){
             bool r = false;
-            if(m_last_iter == "SPO"){
+            if(m_last_iter == spo_index){
                 r = spo_iter.in_last_level();
             }else{
                 r = sop_iter.in_last_level();
@@ -384,27 +399,41 @@ namespace ring {
 
         //Solo funciona en último nivel, en otro caso habría que reajustar
         std::vector<uint64_t> seek_all(var_type var){
-            if(m_last_iter == "SOP"){
+            if(m_last_iter == sop_index){
                 return sop_iter.seek_all(var);
             }else{
                 return spo_iter.seek_all(var);
             }
         }
+        void seek_all(var_type var, std::vector<uint64_t> &values){
+            if(m_last_iter == sop_index){
+                sop_iter.seek_all(var, values);
+            }else{
+                spo_iter.seek_all(var, values);
+            }
+        }
+        uint64_t count_all(var_type var) const{
+            if(m_last_iter == sop_index){
+                return sop_iter.count_all(var);
+            }else{
+                return spo_iter.count_all(var);
+            }
+        }
         bwt_interval get_current_interval(const var_type& var) const{
             if (is_variable_subject(var)){
-                if(m_last_iter == "SOP"){
+                if(m_last_iter == sop_index){
                     return sop_iter.get_i_s();
                 }else{
                     return spo_iter.get_i_s();
                 }
             }else if (is_variable_predicate(var)){
-                if(m_last_iter == "SOP"){
+                if(m_last_iter == sop_index){
                     return sop_iter.get_i_p();
                 }else{
                     return spo_iter.get_i_p();
                 }
             }else if (is_variable_object(var)){
-                if(m_last_iter == "SOP"){
+                if(m_last_iter == sop_index){
                     return sop_iter.get_i_o();
                 }else{
                     return spo_iter.get_i_o();
@@ -413,9 +442,9 @@ namespace ring {
         }
 
         const bwt_interval& get_i_s() const{
-            if(m_last_iter == "SPO"){
+            if(m_last_iter == spo_index){
                 return spo_iter.get_i_s();
-            } else if(m_last_iter == "SOP"){
+            } else if(m_last_iter == sop_index){
                 return sop_iter.get_i_s();
             } else{
                 //When triple is composed of only vars.
@@ -424,9 +453,9 @@ namespace ring {
         }
 
         const bwt_interval& get_i_p() const{
-            if(m_last_iter == "SPO"){
+            if(m_last_iter == spo_index){
                 return spo_iter.get_i_p();
-            } else if(m_last_iter == "SOP"){
+            } else if(m_last_iter == sop_index){
                 return sop_iter.get_i_p();
             } else{
                 //When triple is composed of only vars.
@@ -435,9 +464,9 @@ namespace ring {
         }
 
         const bwt_interval& get_i_o() const{
-            if(m_last_iter == "SPO"){
+            if(m_last_iter == spo_index){
                 return spo_iter.get_i_o();
-            } else if(m_last_iter == "SOP"){
+            } else if(m_last_iter == sop_index){
                 return sop_iter.get_i_o();
             } else{
                 //When triple is composed of only vars.
@@ -446,34 +475,57 @@ namespace ring {
         }
         const wm_type& get_current_wm(const var_type& var) const{
             if (is_variable_subject(var)){
-                if(m_last_iter == "SOP"){
+                if(m_last_iter == sop_index){
                     return m_ptr_reverse_ring->m_bwt_s.get_L();
                 }else{
                     return m_ptr_ring->m_bwt_s.get_L();
                 }
             }else if (is_variable_predicate(var)){
-                 if(m_last_iter == "SOP"){
+                 if(m_last_iter == sop_index){
                     return m_ptr_reverse_ring->m_bwt_p.get_L();
                 }else{
                     return m_ptr_ring->m_bwt_p.get_L();
                 }
             }else if (is_variable_object(var)){
-                 if(m_last_iter == "SOP"){
+                 if(m_last_iter == sop_index){
                     return m_ptr_reverse_ring->m_bwt_o.get_L();
                 }else{
                     return m_ptr_ring->m_bwt_o.get_L();
                 }
             }
         }
+        //! Range of the current interval of var in the wavelet matrix returned by get_current_wm.
+        sdsl::range_type get_current_range(const var_type& var) const{
+            const bwt_interval cur_interval = get_current_interval(var);
+            if (is_variable_subject(var)){
+                if(m_last_iter == sop_index){
+                    return m_ptr_reverse_ring->m_bwt_s.heads_range(cur_interval.left(), cur_interval.right());
+                }else{
+                    return m_ptr_ring->m_bwt_s.heads_range(cur_interval.left(), cur_interval.right());
+                }
+            }else if (is_variable_predicate(var)){
+                 if(m_last_iter == sop_index){
+                    return m_ptr_reverse_ring->m_bwt_p.heads_range(cur_interval.left(), cur_interval.right());
+                }else{
+                    return m_ptr_ring->m_bwt_p.heads_range(cur_interval.left(), cur_interval.right());
+                }
+            }else{
+                 if(m_last_iter == sop_index){
+                    return m_ptr_reverse_ring->m_bwt_o.heads_range(cur_interval.left(), cur_interval.right());
+                }else{
+                    return m_ptr_ring->m_bwt_o.heads_range(cur_interval.left(), cur_interval.right());
+                }
+            }
+        }
         value_type leap(var_type var) {
-            if(m_last_iter == "SOP"){
+            if(m_last_iter == sop_index){
                 return sop_iter.leap(var);
             }else{
                 return spo_iter.leap(var);
             }
         }
         value_type leap(var_type var, size_type c) {
-            if(m_last_iter == "SOP"){
+            if(m_last_iter == sop_index){
                 return sop_iter.leap(var,c);
             }else{
                 return spo_iter.leap(var,c);
@@ -37,7 +37,7 @@ namespace ring {
 
     private:
         const triple_pattern *m_ptr_triple_pattern;
-        ring_type *m_ptr_ring; //TODO: should be const
+        const ring_type *m_ptr_ring;
         bwt_interval m_i_s;
         bwt_interval m_i_o;
         bwt_interval m_i_p;
@@ -58,15 +58,15 @@ namespace ring {
             m_is_empty = o.m_is_empty;
         }
     public:
-        inline bool is_variable_subject(var_type var) {
+        inline bool is_variable_subject(var_type var) const {
             return m_ptr_triple_pattern->term_s.is_variable && var == m_ptr_triple_pattern->term_s.value;
         }
 
-        inline bool is_variable_predicate(var_type var) {
+        inline bool is_variable_predicate(var_type var) const {
             return m_ptr_triple_pattern->term_p.is_variable && var == m_ptr_triple_pattern->term_p.value;
         }
 
-        inline bool is_variable_object(var_type var) {
+        inline bool is_variable_object(var_type var) const {
             return m_ptr_triple_pattern->term_o.is_variable && var == m_ptr_triple_pattern->term_o.value;
         }
 
@@ -77,7 +77,7 @@ namespace ring {
 
         ltj_reverse_iterator() = default;
 
-        ltj_reverse_iterator(const triple_pattern *triple, ring_type *ring) {
+        ltj_reverse_iterator(const triple_pattern *triple, const ring_type *ring) {
             m_ptr_triple_pattern = triple;
             m_ptr_ring = ring;
             m_cur_s = -1UL;
@@ -632,6 +632,30 @@ namespace ring {
             }
             return std::vector<uint64_t>();
         }
+
+        //! seek_all writing the values to 'values', which keeps its capacity between calls.
+        void seek_all(var_type var, std::vector<uint64_t> &values){
+            if (is_variable_subject(var)){
+                m_ptr_ring->all_S_in_range(m_i_s, values);
+            }else if (is_variable_predicate(var)){
+                m_ptr_ring->all_P_in_range(m_i_p, values);
+            }else if (is_variable_object(var)){
+                m_ptr_ring->all_O_in_range(m_i_o, values);
+            }else{
+                values.clear();
+            }
+        }
+        //Number of values of var in the last level (its interval, as the triples are distinct)
+        uint64_t count_all(var_type var) const{
+            if (is_variable_subject(var)){
+                return m_i_s.size();
+            }else if (is_variable_predicate(var)){
+                return m_i_p.size();
+            }else if (is_variable_object(var)){
+                return m_i_o.size();
+            }
+            return 0;
+        }
         const bwt_interval& get_i_s() const{
             return m_i_s;
         }
@@ -0,0 +1,113 @@
+/*
+ * mmap_stream.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_MMAP_STREAM_HPP
+#define RING_MMAP_STREAM_HPP
+
+#include <istream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <sdsl/io.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ring {
+
+    //! Read-only stream buffer whose get area is a memory-mapped file.
+    /*!
+     * Reading through it copies straight from the page cache, without the intermediate buffer and the read
+     * system calls of std::ifstream. The structures loaded from it are still copied into the heap, so this
+     * neither shares their memory between processes nor loads indexes larger than the main memory.
+     */
+    class mmap_streambuf : public std::streambuf {
+    private:
+        char *m_data = nullptr;
+        size_t m_size = 0;
+
+        mmap_streambuf(const mmap_streambuf &) = delete;
+        mmap_streambuf &operator=(const mmap_streambuf &) = delete;
+
+    public:
+        explicit mmap_streambuf(const std::string &file) {
+            int fd = open(file.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (map != MAP_FAILED) {
+                    m_data = (char *) map;
+                    m_size = st.st_size;
+                    madvise(m_data, m_size, MADV_SEQUENTIAL);
+                    madvise(m_data, m_size, MADV_WILLNEED);
+                    setg(m_data, m_data, m_data + m_size);
+                }
+            }
+            close(fd);
+        }
+
+        ~mmap_streambuf() {
+            if (m_data != nullptr) munmap(m_data, m_size);
+        }
+
+        bool is_open() const { return m_data != nullptr; }
+
+    protected:
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+            off_type base = (dir == std::ios_base::beg) ? 0 : (dir == std::ios_base::cur) ? gptr() - eback() : (off_type) m_size;
+            return seekpos(base + off, which);
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+            if (!(which & std::ios_base::in) || pos < 0 || (size_t) pos > m_size) return pos_type(off_type(-1));
+            setg(eback(), eback() + (off_type) pos, egptr());
+            return pos;
+        }
+    };
+
+    //! Loads a serialized structure reading it from a memory-mapped file.
+    /*!
+    * \param t    : structure with a load(std::istream&) method.
+    * \param file : file written by sdsl::store_to_file.
+    * \returns false if the file cannot be mapped.
+    */
+    template<class t_structure>
+    bool load_from_mapped_file(t_structure &t, const std::string &file) {
+        mmap_streambuf buffer(file);
+        if (!buffer.is_open()) return false;
+        std::istream in(&buffer);
+        t.load(in);
+        return true;
+    }
+
+    //! Loads a structure written by sdsl::store_to_file, throwing std::runtime_error if the file cannot be read.
+    /*!
+    * \param t           : structure with a load(std::istream&) method.
+    * \param file        : file written by sdsl::store_to_file.
+    * \param mapped_read : reads the file through a memory mapping (see mmap_streambuf) instead of a buffered stream.
+    */
+    template<class t_structure>
+    void load_index_file(t_structure &t, const std::string &file, const bool mapped_read) {
+        const bool loaded = mapped_read ? load_from_mapped_file(t, file) : sdsl::load_from_file(t, file);
+        if (!loaded) throw std::runtime_error("Cannot load " + file);
+    }
+}
+
+#endif //RING_MMAP_STREAM_HPP
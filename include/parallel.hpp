@@ -0,0 +1,81 @@
+/*
+ * parallel.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_PARALLEL_HPP
+#define RING_PARALLEL_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ring {
+
+    namespace parallel {
+
+        typedef std::function<void()> task_type;
+
+        //! Number of hardware threads, at least 1.
+        inline uint64_t hardware_threads() {
+            uint64_t n = std::thread::hardware_concurrency();
+            return (n == 0) ? 1 : n;
+        }
+
+        //! Runs every task of the given list using at most 'threads' threads.
+        /*!
+        * Tasks are taken in order by the workers, so the longest ones should be first.
+        * With threads <= 1 the tasks are run sequentially by the calling thread.
+        * The first exception thrown by a task is rethrown once all the workers have finished.
+        * \param tasks   : tasks to run.
+        * \param threads : maximum number of threads.
+        */
+        inline void run_tasks(const std::vector<task_type> &tasks, uint64_t threads) {
+            if (threads > tasks.size()) threads = tasks.size();
+            if (threads <= 1) {
+                for (const auto &task : tasks) task();
+                return;
+            }
+            std::atomic<uint64_t> next(0);
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            auto worker = [&]() {
+                uint64_t i;
+                while ((i = next++) < tasks.size()) {
+                    try {
+                        tasks[i]();
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error) error = std::current_exception();
+                    }
+                }
+            };
+            std::vector<std::thread> workers;
+            for (uint64_t t = 1; t < threads; ++t) {
+                workers.emplace_back(worker);
+            }
+            worker();
+            for (auto &w : workers) w.join();
+            if (error) std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif //RING_PARALLEL_HPP
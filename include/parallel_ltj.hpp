@@ -0,0 +1,345 @@
+/*
+ * parallel_ltj.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_PARALLEL_LTJ_HPP
+#define RING_PARALLEL_LTJ_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "cancellation.hpp"
+#include "parallel.hpp"
+#include "result_sink.hpp"
+
+namespace ring {
+
+    //! Part of the search space of a join.
+    /*!
+    * The first variables of the GAO are bound to the values of 'prefix' and the next one
+    * takes the values of [lo, hi] (both included).
+    */
+    template<class var_t, class value_t>
+    struct ltj_task {
+        std::vector<std::pair<var_t, value_t>> prefix;
+        value_t lo = 0;
+        value_t hi = -1;
+    };
+
+    //! Pool of pending tasks shared by the workers of a parallel join.
+    /*!
+    * Workers take tasks until the pool is empty and every worker is idle. Busy workers split
+    * their own task when another one is waiting (see ltj_splitter), so the load is balanced
+    * even when a few values of the first variable hold most of the results.
+    */
+    template<class var_t, class value_t>
+    class ltj_scheduler {
+    public:
+        typedef ltj_task<var_t, value_t> task_type;
+        typedef uint64_t size_type;
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::deque<task_type> m_tasks;
+        const size_type m_workers;
+        const size_type m_limit;
+        size_type m_idle = 0;
+        bool m_done = false;
+        std::atomic<size_type> m_pending{0};
+        std::atomic<size_type> m_waiting{0};
+        std::atomic<size_type> m_results{0};
+        std::atomic<bool> m_stop{false};
+
+    public:
+        //! Constructor
+        /*!
+        * \param workers : number of workers taking tasks.
+        * \param limit   : limit of results of the join (0 = no limit).
+        */
+        ltj_scheduler(const size_type workers, const size_type limit) : m_workers(workers), m_limit(limit) {}
+
+        void push(task_type &&task) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.emplace_back(std::move(task));
+                ++m_pending;
+            }
+            m_condition.notify_one();
+        }
+
+        //! Takes the next task, waiting for one if the join is not over.
+        /*!
+        * \returns false once every worker is idle and there are no tasks left, or the join was stopped.
+        */
+        bool pop(task_type &task) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            ++m_idle;
+            ++m_waiting;
+            while (m_tasks.empty() && !m_done && !m_stop) {
+                if (m_idle == m_workers) {
+                    m_done = true;
+                    m_condition.notify_all();
+                    break;
+                }
+                m_condition.wait(lock);
+            }
+            if (m_tasks.empty() || m_stop) return false;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            --m_pending;
+            --m_idle;
+            --m_waiting;
+            return true;
+        }
+
+        //! True if a worker is waiting and there is no task for it.
+        inline bool hungry() const {
+            return m_waiting.load(std::memory_order_relaxed) > 0 && m_pending.load(std::memory_order_relaxed) == 0;
+        }
+
+        //! Reserves one of the results of the limit. Stops the join when the limit is reached.
+        inline bool add_result() {
+            if (m_limit == 0) return true;
+            if (m_results.fetch_add(1) < m_limit) return true;
+            stop();
+            return false;
+        }
+
+        //! Reserves n results of the limit if all of them fit, without stopping the join otherwise.
+        inline bool add_results(const size_type n) {
+            if (m_limit == 0) return true;
+            size_type results = m_results.load();
+            do {
+                if (results + n > m_limit) return false;
+            } while (!m_results.compare_exchange_weak(results, results + n));
+            return true;
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_condition.notify_all();
+        }
+
+        inline bool stopped() const {
+            return m_stop.load(std::memory_order_relaxed);
+        }
+    };
+
+    //! State of a worker of a parallel join, used by the search of the algorithms.
+    /*!
+    * Keeps the last value that the worker will visit at every level of the GAO that it is
+    * iterating. When the scheduler is hungry, the values after the current one at the shallowest
+    * of those levels are given away as a new task. Without scheduler (sequential join) it does nothing.
+    */
+    template<class var_t, class value_t>
+    class ltj_splitter {
+    public:
+        typedef ltj_task<var_t, value_t> task_type;
+        typedef ltj_scheduler<var_t, value_t> scheduler_type;
+        typedef uint64_t size_type;
+
+    private:
+        scheduler_type *m_scheduler = nullptr;
+        size_type m_task_level = 0;
+        value_t m_task_lo = 0;
+        value_t m_task_hi = -1;
+        std::vector<value_t> m_last; //last value of each level
+        std::vector<bool> m_open;    //the values of the level are being iterated
+
+    public:
+        void set_scheduler(scheduler_type *scheduler, const size_type number_of_variables) {
+            m_scheduler = scheduler;
+            m_last.assign(number_of_variables, -1);
+            m_open.assign(number_of_variables, false);
+        }
+
+        void set_task(const task_type &task) {
+            m_task_level = task.prefix.size();
+            m_task_lo = task.lo;
+            m_task_hi = task.hi;
+        }
+
+        inline bool stopped() const {
+            return m_scheduler != nullptr && m_scheduler->stopped();
+        }
+
+        inline bool add_result() {
+            return m_scheduler == nullptr || m_scheduler->add_result();
+        }
+
+        inline bool add_results(const size_type n) {
+            return m_scheduler == nullptr || m_scheduler->add_results(n);
+        }
+
+        //! First value of level j.
+        inline value_t first(const size_type j) const {
+            return (m_scheduler != nullptr && j == m_task_level) ? m_task_lo : 0;
+        }
+
+        //! Last value of level j.
+        inline value_t last(const size_type j) const {
+            return (m_scheduler != nullptr) ? m_last[j] : value_t(-1);
+        }
+
+        //! Level j starts iterating its values, so it can be split.
+        inline void open(const size_type j) {
+            if (m_scheduler == nullptr) return;
+            m_open[j] = true;
+            m_last[j] = (j == m_task_level) ? m_task_hi : value_t(-1);
+        }
+
+        inline void close(const size_type j) {
+            if (m_scheduler == nullptr) return;
+            m_open[j] = false;
+        }
+
+        //! Gives away the remaining values of the shallowest open level below j, if a worker is waiting.
+        /*!
+        * \param tuple : current values of the levels [0, j).
+        * \param j     : current level.
+        */
+        template<class tuple_t>
+        void share(const tuple_t &tuple, const size_type j) {
+            if (m_scheduler == nullptr || !m_scheduler->hungry()) return;
+            for (size_type l = m_task_level; l < j; ++l) {
+                if (m_open[l] && tuple[l].second < m_last[l]) {
+                    task_type task;
+                    task.prefix.assign(tuple.begin(), tuple.begin() + l);
+                    task.lo = tuple[l].second + 1;
+                    task.hi = m_last[l];
+                    m_last[l] = tuple[l].second;
+                    m_scheduler->push(std::move(task));
+                    return;
+                }
+            }
+        }
+    };
+
+    //! Sink of a worker of a parallel join.
+    /*!
+    * Keeps the rows in a buffer and passes them a batch at a time to the sink of the join,
+    * which is shared by all the workers.
+    */
+    class batch_sink : public result_sink {
+    private:
+        result_sink &m_sink;
+        std::mutex &m_mutex;
+        const size_type m_batch;
+        std::vector<value_type> m_rows;
+        size_type m_pending = 0;
+        bool m_ok = true;
+
+    public:
+        batch_sink(result_sink &sink, std::mutex &mutex, const size_type batch = 1024)
+                : m_sink(sink), m_mutex(mutex), m_batch(batch) {}
+
+        void begin(const size_type width) override {
+            result_sink::begin(width);
+            m_rows.reserve(width * m_batch);
+        }
+
+        bool push(const value_type *row) override {
+            if (!m_ok) return false;
+            m_rows.insert(m_rows.end(), row, row + m_width);
+            return (++m_pending < m_batch) || flush();
+        }
+
+        bool push_product(const value_type *row, const std::vector<size_type> &vars,
+                          const std::vector<std::vector<value_type>> &lists) override {
+            if (!flush()) return false;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ok = m_sink.push_product(row, vars, lists);
+            return m_ok;
+        }
+
+        void end() override {
+            flush();
+        }
+
+        //! Passes the buffered rows to the shared sink. Returns false if the shared sink stopped the join.
+        bool flush() {
+            if (m_pending > 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (size_type i = 0; i < m_pending && m_ok; ++i) {
+                    m_ok = m_sink.push(m_rows.data() + i * m_width);
+                }
+                m_rows.clear();
+                m_pending = 0;
+            }
+            return m_ok;
+        }
+    };
+
+    //! Evaluates the join of 'algorithm' with several threads.
+    /*!
+    * Every worker runs the tasks it takes on its own copy of the algorithm (and of its iterators),
+    * and the index is only read. The whole join is the first task, which is split as soon as
+    * the other workers are waiting.
+    * The rows reach the sink in batches, never concurrently, and not in the order of the sequential join.
+    * \param algorithm       : algorithm whose join is evaluated. It must not have started the search.
+    * \param sink            : receives the results. begin() has already been called.
+    * \param limit_results   : limit of results (0 = no limit).
+    * \param token           : cancellation of the join, shared by the workers (optional).
+    * \param threads         : number of workers.
+    * \returns the number of results.
+    */
+    template<class algorithm_type>
+    uint64_t parallel_join(const algorithm_type &algorithm, result_sink &sink,
+                       const uint64_t limit_results, cancellation_token *token, const uint64_t threads) {
+        typedef typename algorithm_type::var_type var_type;
+        typedef typename algorithm_type::value_type value_type;
+        typedef ltj_scheduler<var_type, value_type> scheduler_type;
+        typedef typename scheduler_type::task_type task_type;
+
+        scheduler_type scheduler(threads, limit_results);
+        scheduler.push(task_type());
+        std::mutex sink_mutex;
+        std::atomic<uint64_t> results(0);
+        std::vector<parallel::task_type> workers;
+        for (uint64_t t = 0; t < threads; ++t) {
+            workers.push_back([&]() {
+                batch_sink worker_sink(sink, sink_mutex);
+                worker_sink.begin(sink.width());
+                try {
+                    task_type task;
+                    while (scheduler.pop(task)) {
+                        algorithm_type worker(algorithm);
+                        bool ok = worker.run_task(task, &scheduler, worker_sink, token);
+                        results += worker.number_of_results();
+                        if (!ok) scheduler.stop();
+                    }
+                    worker_sink.end();
+                } catch (...) {
+                    scheduler.stop();
+                    throw;
+                }
+            });
+        }
+        parallel::run_tasks(workers, threads);
+        return results;
+    }
+}
+
+#endif //RING_PARALLEL_LTJ_HPP
@@ -0,0 +1,333 @@
+/*
+ * query_engine.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_QUERY_ENGINE_HPP
+#define RING_QUERY_ENGINE_HPP
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ring.hpp>
+#include <reverse_ring.hpp>
+#include <ltj_algorithm.hpp>
+#include <ltj_algorithm_spo_sop.hpp>
+#include <ltj_algorithm_spo_sop_leap.hpp>
+#include <query_parser.hpp>
+#include <result_sink.hpp>
+#include <cancellation.hpp>
+#include <dense_ids.hpp>
+#include <utils.hpp>
+#include "parallel.hpp"
+
+namespace ring {
+
+    //! Results of a query taken a page at a time (see query_engine::open).
+    class query_cursor {
+    public:
+        typedef uint64_t size_type;
+
+        virtual ~query_cursor() = default;
+
+        //! Reports the next 'n' results (0 = all the remaining ones) and returns how many were reported.
+        /*!
+        * A cancelled page can be resumed by the next call.
+        */
+        virtual size_type next_batch(result_sink &sink, const size_type n, cancellation_token *token = nullptr) = 0;
+
+        //! True once the query has no more results.
+        virtual bool done() const = 0;
+
+        //! GAO used by the algorithm.
+        virtual std::string gao() const = 0;
+    };
+
+    //! Cursor that keeps a query and the algorithm evaluating it, paused between pages.
+    template<class algorithm_t>
+    class ltj_cursor : public query_cursor {
+    private:
+        bgp_query m_query; //The algorithm points to its patterns, so it is declared first
+        algorithm_t m_ltj;
+
+    public:
+        template<class... rings_t>
+        ltj_cursor(const bgp_query &query, const rings_t*... rings) : m_query(query), m_ltj(&m_query.patterns, rings...) {
+            if (!m_query.projection.empty()) m_ltj.set_projection(m_query.projection);
+            m_ltj.start();
+        }
+
+        size_type next_batch(result_sink &sink, const size_type n, cancellation_token *token = nullptr) override {
+            return m_ltj.next_batch(sink, n, token);
+        }
+
+        bool done() const override {
+            return m_ltj.done();
+        }
+
+        std::string gao() const override {
+            auto ht = m_query.variable_names();
+            return m_ltj.get_gao(ht);
+        }
+    };
+
+    //! Cursor over the results of a query on dense IDs, which reports them with the IDs of the graph.
+    class dense_ids_cursor : public query_cursor {
+    private:
+        std::unique_ptr<query_cursor> m_cursor; // null if the query has no results
+        const dense_ids &m_ids;
+        bgp_query m_query;
+
+    public:
+        dense_ids_cursor(std::unique_ptr<query_cursor> cursor, const dense_ids &ids, const bgp_query &query)
+                : m_cursor(std::move(cursor)), m_ids(ids), m_query(query) {}
+
+        size_type next_batch(result_sink &sink, const size_type n, cancellation_token *token = nullptr) override {
+            if (!m_cursor) {
+                sink.begin(m_query.number_of_variables());
+                sink.end();
+                return 0;
+            }
+            dense_ids_sink dense_sink(m_ids, m_query, sink);
+            return m_cursor->next_batch(dense_sink, n, token);
+        }
+
+        bool done() const override {
+            return !m_cursor || m_cursor->done();
+        }
+
+        std::string gao() const override {
+            return m_cursor ? m_cursor->gao() : "";
+        }
+    };
+
+    //! Loaded index (rings and CRC arrays) that answers queries with the algorithm chosen by util::configuration.
+    template<class ring_t, class reverse_ring_t, class wm_t = sdsl::bit_vector>
+    class query_engine {
+    public:
+        typedef ring_t ring_type;
+        typedef reverse_ring_t reverse_ring_type;
+        typedef uint64_t size_type;
+        typedef typename ltj_algorithm<ring_type>::tuple_type tuple_type;
+
+    private:
+        ring_type m_graph;
+        reverse_ring_type m_reverse_graph;
+        dense_ids m_ids;
+        bool m_dense_ids = false; // the index was built on dense IDs (file .ids)
+
+        query_engine(const query_engine &) = delete;
+        query_engine &operator=(const query_engine &) = delete;
+
+        //! Evaluates a query whose constants are IDs of the rings (see join).
+        std::string run_join(const bgp_query &query, result_sink &sink,
+                             const size_type number_of_results, const size_type timeout,
+                             const size_type threads, cancellation_token *token) const {
+            auto ht = query.variable_names();
+            if (util::configuration.uses_reverse_index()) {
+                if (util::configuration.uses_leap()) {
+                    ltj_algorithm_spo_sop_leap<ring_type, reverse_ring_type, wm_t> ltj(&query.patterns, &m_graph, &m_reverse_graph);
+                    if (!query.projection.empty()) ltj.set_projection(query.projection);
+                    ltj.join(sink, number_of_results, timeout, threads, token);
+                    return ltj.get_gao(ht);
+                } else {
+                    ltj_algorithm_spo_sop<ring_type, reverse_ring_type, wm_t> ltj(&query.patterns, &m_graph, &m_reverse_graph);
+                    if (!query.projection.empty()) ltj.set_projection(query.projection);
+                    ltj.join(sink, number_of_results, timeout, threads, token);
+                    return ltj.get_gao(ht);
+                }
+            } else {
+                ltj_algorithm<ring_type> ltj(&query.patterns, &m_graph);
+                if (!query.projection.empty()) ltj.set_projection(query.projection);
+                ltj.join(sink, number_of_results, timeout, threads, token);
+                return ltj.get_gao(ht);
+            }
+        }
+
+        //! Counts the results of a query whose constants are IDs of the rings (see count).
+        std::string run_count(const bgp_query &query, size_type &count, const size_type timeout,
+                              const size_type threads, cancellation_token *token) const {
+            auto ht = query.variable_names();
+            if (util::configuration.uses_reverse_index()) {
+                if (util::configuration.uses_leap()) {
+                    ltj_algorithm_spo_sop_leap<ring_type, reverse_ring_type, wm_t> ltj(&query.patterns, &m_graph, &m_reverse_graph);
+                    if (!query.projection.empty()) ltj.set_projection(query.projection);
+                    count = ltj.count(timeout, threads, token);
+                    return ltj.get_gao(ht);
+                } else {
+                    ltj_algorithm_spo_sop<ring_type, reverse_ring_type, wm_t> ltj(&query.patterns, &m_graph, &m_reverse_graph);
+                    if (!query.projection.empty()) ltj.set_projection(query.projection);
+                    count = ltj.count(timeout, threads, token);
+                    return ltj.get_gao(ht);
+                }
+            } else {
+                ltj_algorithm<ring_type> ltj(&query.patterns, &m_graph);
+                if (!query.projection.empty()) ltj.set_projection(query.projection);
+                count = ltj.count(timeout, threads, token);
+                return ltj.get_gao(ht);
+            }
+        }
+
+        //! Opens a cursor over a query whose constants are IDs of the rings (see open).
+        std::unique_ptr<query_cursor> run_open(const bgp_query &query) const {
+            if (util::configuration.uses_reverse_index()) {
+                if (util::configuration.uses_leap()) {
+                    return std::unique_ptr<query_cursor>(new ltj_cursor<ltj_algorithm_spo_sop_leap<ring_type, reverse_ring_type, wm_t>>(
+                            query, &m_graph, &m_reverse_graph));
+                } else {
+                    return std::unique_ptr<query_cursor>(new ltj_cursor<ltj_algorithm_spo_sop<ring_type, reverse_ring_type, wm_t>>(
+                            query, &m_graph, &m_reverse_graph));
+                }
+            } else {
+                return std::unique_ptr<query_cursor>(new ltj_cursor<ltj_algorithm<ring_type>>(query, &m_graph));
+            }
+        }
+
+    public:
+        query_engine() = default;
+
+        //! Loads the index files required by the current configuration.
+        /*!
+        * The index files are independent of each other, so they are loaded concurrently.
+        * \param file : index file, without the .spo/.sop/.crc/.ids extension.
+        * \throws std::runtime_error if an index file cannot be loaded.
+        */
+        void load(const std::string &file) {
+            const bool mapped_read = util::configuration.uses_mapped_read();
+            std::vector<parallel::task_type> load_tasks;
+            if (util::configuration.is_verbose()) {
+                std::cout << " Loading the index SPO..." << std::endl;
+            }
+            load_tasks.push_back([&]() {
+                load_index_file(m_graph, file + ".spo", mapped_read);
+            });
+            if (util::configuration.uses_reverse_index()) {
+                if (util::configuration.is_verbose()) {
+                    std::cout << " Loading the index SOP..." << std::endl;
+                }
+                load_tasks.push_back([&]() {
+                    load_index_file(m_reverse_graph, file + ".sop", mapped_read);
+                });
+            }
+            if (util::configuration.uses_muthu()) {
+                if (util::configuration.is_verbose()) {
+                    std::cout << " Loading the wavelet matrices that support Muthukrishnan's Colored range counting algorithm." << std::endl;
+                }
+                // Only touches the crc arrays of the graph, which are not read by the SPO task.
+                load_tasks.push_back([&]() {
+                    m_graph.load_crc_arrays(file, mapped_read);
+                });
+            }
+            m_dense_ids = std::ifstream(file + ".ids").good();
+            if (m_dense_ids) {
+                if (util::configuration.is_verbose()) {
+                    std::cout << " Loading the dense IDs..." << std::endl;
+                }
+                load_tasks.push_back([&]() {
+                    load_index_file(m_ids, file + ".ids", false);
+                });
+            }
+            parallel::run_tasks(load_tasks, load_tasks.size());
+            if (util::configuration.is_verbose()) {
+                std::cout << " Index SPO loaded " << sdsl::size_in_bytes(m_graph) << " bytes" << std::endl;
+                if (util::configuration.uses_reverse_index()) {
+                    std::cout << " Index SOP loaded " << sdsl::size_in_bytes(m_reverse_graph) << " bytes" << std::endl;
+                }
+            }
+        }
+
+        //! Throws unsupported_query if the query cannot be evaluated on this index, as join, count and open would.
+        /*!
+        * A variable that is both a predicate and a subject or object is not supported by an index with dense IDs.
+        */
+        void check(const bgp_query &query) const {
+            if (m_dense_ids) dense_ids::predicate_variables(query);
+        }
+
+        //! Evaluates a query.
+        /*!
+        * The index is only read, so several queries can be evaluated concurrently, each one by its own algorithm.
+        * \param query             : parsed query.
+        * \param sink              : receives the results (values by variable id) as they are produced.
+        *                           With a projection, the values of the other variables are 0.
+        * \param number_of_results : limit of results (0 = no limit).
+        * \param timeout           : timeout in milliseconds (0 = no timeout).
+        * \param threads           : number of threads evaluating the query (see parallel_join).
+        * \param token             : cancels the query from another thread (optional).
+        * \returns the GAO used by the algorithm.
+        */
+        std::string join(const bgp_query &query, result_sink &sink,
+                         const size_type number_of_results, const size_type timeout,
+                         const size_type threads = 1, cancellation_token *token = nullptr) const {
+            if (!m_dense_ids) return run_join(query, sink, number_of_results, timeout, threads, token);
+            bgp_query dense(query);
+            if (!m_ids.to_dense(dense)) {
+                //A constant that is not in the graph, the join has no results.
+                sink.begin(query.number_of_variables());
+                sink.end();
+                return "";
+            }
+            dense_ids_sink dense_sink(m_ids, dense, sink);
+            return run_join(dense, dense_sink, number_of_results, timeout, threads, token);
+        }
+
+        //! Counts the results of a query without enumerating the values of the lonely variables (see ltj_algorithm::count).
+        /*!
+        * \param query   : parsed query.
+        * \param count   : number of results.
+        * \param timeout : timeout in milliseconds (0 = no timeout).
+        * \param threads : number of threads evaluating the query (see parallel_join).
+        * \param token   : cancels the query from another thread (optional).
+        * \returns the GAO used by the algorithm.
+        */
+        std::string count(const bgp_query &query, size_type &count, const size_type timeout,
+                          const size_type threads = 1, cancellation_token *token = nullptr) const {
+            if (!m_dense_ids) return run_count(query, count, timeout, threads, token);
+            bgp_query dense(query);
+            if (!m_ids.to_dense(dense)) {
+                count = 0;
+                return "";
+            }
+            return run_count(dense, count, timeout, threads, token);
+        }
+
+        //! Opens a cursor over the results of a query, which are reported a page at a time.
+        /*!
+        * The search pauses between pages, so a page does not repeat the work of the previous ones.
+        * The cursor refers to the index, so it cannot outlive the engine.
+        * \param query : parsed query, which is copied by the cursor.
+        */
+        std::unique_ptr<query_cursor> open(const bgp_query &query) const {
+            if (!m_dense_ids) return run_open(query);
+            bgp_query dense(query);
+            std::unique_ptr<query_cursor> cursor;
+            if (m_ids.to_dense(dense)) cursor = run_open(dense);
+            return std::unique_ptr<query_cursor>(new dense_ids_cursor(std::move(cursor), m_ids, dense));
+        }
+
+        //! Evaluates a query, keeping every result as a tuple of pairs variable - value.
+        std::string join(const bgp_query &query, std::vector<tuple_type> &res,
+                         const size_type number_of_results, const size_type timeout,
+                         const size_type threads = 1) const {
+            tuple_sink<tuple_type> sink(res);
+            return join(query, sink, number_of_results, timeout, threads);
+        }
+    };
+}
+
+#endif //RING_QUERY_ENGINE_HPP
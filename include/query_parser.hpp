@@ -0,0 +1,180 @@
+/*
+ * query_parser.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_QUERY_PARSER_HPP
+#define RING_QUERY_PARSER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <triple_pattern.hpp>
+
+namespace ring {
+
+    //! Basic graph pattern: its triple patterns, the names of its variables and the projected ones.
+    struct bgp_query {
+        std::vector<triple_pattern> patterns;
+        std::unordered_map<std::string, uint8_t> hash_table_vars; // name -> variable id
+        std::vector<uint8_t> projection; // projected variable ids (SELECT DISTINCT), empty = every variable
+
+        uint64_t number_of_variables() const { return hash_table_vars.size(); }
+
+        //! Variable id -> name, as expected by get_gao.
+        std::unordered_map<uint8_t, std::string> variable_names() const {
+            std::unordered_map<uint8_t, std::string> ht;
+            for (const auto &p : hash_table_vars) {
+                ht.insert({p.second, p.first});
+            }
+            return ht;
+        }
+    };
+
+    //! Parser of queries written as "?x1 353 ?x2 . ?x2 7 12 . ...".
+    /*!
+    * The patterns can be preceded by a projection, "SELECT [DISTINCT] ?x1 ?x2 WHERE { ... }", whose
+    * results are always distinct. "SELECT *" keeps every variable and the braces are optional.
+    */
+    namespace query_parser {
+
+        inline std::string ltrim(const std::string &s) {
+            size_t start = s.find_first_not_of(' ');
+            return (start == std::string::npos) ? "" : s.substr(start);
+        }
+
+        inline std::string rtrim(const std::string &s) {
+            size_t end = s.find_last_not_of(' ');
+            return (end == std::string::npos) ? "" : s.substr(0, end + 1);
+        }
+
+        inline std::string trim(const std::string &s) {
+            return rtrim(ltrim(s));
+        }
+
+        inline std::vector<std::string> tokenizer(const std::string &input, const char &delimiter) {
+            std::stringstream stream(input);
+            std::string token;
+            std::vector<std::string> res;
+            while (getline(stream, token, delimiter)) {
+                res.emplace_back(trim(token));
+            }
+            return res;
+        }
+
+        inline bool is_variable(const std::string &s) {
+            return (s.at(0) == '?');
+        }
+
+        inline uint8_t get_variable(const std::string &s, std::unordered_map<std::string, uint8_t> &hash_table_vars) {
+            auto var = s.substr(1);
+            auto it = hash_table_vars.find(var);
+            if (it == hash_table_vars.end()) {
+                uint8_t id = hash_table_vars.size();
+                hash_table_vars.insert({var, id});
+                return id;
+            } else {
+                return it->second;
+            }
+        }
+
+        inline uint64_t get_constant(const std::string &s) {
+            return std::stoull(s);
+        }
+
+        inline triple_pattern get_triple(const std::string &s, std::unordered_map<std::string, uint8_t> &hash_table_vars) {
+            std::vector<std::string> terms;
+            for (const auto &term : tokenizer(s, ' ')) {
+                if (!term.empty()) terms.push_back(term);
+            }
+            if (terms.size() != 3) {
+                throw std::invalid_argument("Triple pattern '" + trim(s) + "' does not have three terms");
+            }
+
+            triple_pattern triple;
+            if (is_variable(terms[0])) {
+                triple.var_s(get_variable(terms[0], hash_table_vars));
+            } else {
+                triple.const_s(get_constant(terms[0]));
+            }
+            if (is_variable(terms[1])) {
+                triple.var_p(get_variable(terms[1], hash_table_vars));
+            } else {
+                triple.const_p(get_constant(terms[1]));
+            }
+            if (is_variable(terms[2])) {
+                triple.var_o(get_variable(terms[2], hash_table_vars));
+            } else {
+                triple.const_o(get_constant(terms[2]));
+            }
+            return triple;
+        }
+
+        //! Removes the SELECT clause of a query, keeping the names of the projected variables, and the braces of WHERE.
+        inline std::string get_projection(const std::string &query_string, std::vector<std::string> &names) {
+            std::string s = trim(query_string);
+            if (s.compare(0, 7, "SELECT ") != 0) return s;
+            auto where = s.find(" WHERE");
+            if (where == std::string::npos) {
+                throw std::invalid_argument("SELECT without WHERE");
+            }
+            for (const auto &term : tokenizer(s.substr(7, where - 7), ' ')) {
+                if (term.empty() || term == "DISTINCT" || term == "*") continue;
+                if (!is_variable(term)) {
+                    throw std::invalid_argument("'" + term + "' is not a variable");
+                }
+                names.push_back(term.substr(1));
+            }
+            s = trim(s.substr(where + 6));
+            if (!s.empty() && s.front() == '{') {
+                if (s.back() != '}') {
+                    throw std::invalid_argument("Missing '}'");
+                }
+                s = s.substr(1, s.size() - 2);
+            }
+            return s;
+        }
+
+        //! Parses a query, throwing std::invalid_argument if it is malformed.
+        inline bgp_query parse(const std::string &query_string) {
+            bgp_query query;
+            std::vector<std::string> names;
+            for (const std::string &token : tokenizer(get_projection(query_string, names), '.')) {
+                if (token.empty()) continue;
+                query.patterns.push_back(get_triple(token, query.hash_table_vars));
+            }
+            if (query.patterns.empty()) {
+                throw std::invalid_argument("Empty query");
+            }
+            for (const auto &name : names) {
+                auto it = query.hash_table_vars.find(name);
+                if (it == query.hash_table_vars.end()) {
+                    throw std::invalid_argument("Variable ?" + name + " does not appear in the query");
+                }
+                if (std::find(query.projection.begin(), query.projection.end(), it->second) == query.projection.end()) {
+                    query.projection.push_back(it->second);
+                }
+            }
+            return query;
+        }
+    }
+}
+
+#endif //RING_QUERY_PARSER_HPP
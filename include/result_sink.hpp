@@ -0,0 +1,277 @@
+/*
+ * result_sink.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_RESULT_SINK_HPP
+#define RING_RESULT_SINK_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace ring {
+
+    //! Receives the results of a join as they are produced.
+    /*!
+    * Every result is a row with the value of each variable, indexed by the id of the variable
+    * (the order of appearance in the query). The row is only valid during the call to push.
+    */
+    class result_sink {
+    public:
+        typedef uint64_t value_type;
+        typedef uint64_t size_type;
+
+    protected:
+        size_type m_width = 0;
+
+    public:
+        virtual ~result_sink() = default;
+
+        //! Called before the first row with the number of values of the rows.
+        virtual void begin(const size_type width) {
+            m_width = width;
+        }
+
+        //! Receives a row. Returning false stops the join.
+        virtual bool push(const value_type *row) = 0;
+
+        //! Receives the rows that extend 'row' with every combination of the values of 'lists'.
+        /*!
+        * lists[i] holds the values of the variable vars[i], whose value in 'row' is undefined.
+        * By default the product is flattened into rows passed to push. Returning false stops the join.
+        */
+        virtual bool push_product(const value_type *row, const std::vector<size_type> &vars,
+                                  const std::vector<std::vector<value_type>> &lists) {
+            for (const auto &list : lists) {
+                if (list.empty()) return true;
+            }
+            std::vector<value_type> flat(row, row + m_width);
+            std::vector<size_type> pos(lists.size(), 0);
+            for (size_type i = 0; i < lists.size(); ++i) {
+                flat[vars[i]] = lists[i][0];
+            }
+            while (true) {
+                if (!push(flat.data())) return false;
+                //Next combination, as an odometer whose last list changes first
+                size_type i = lists.size();
+                while (i > 0 && ++pos[i - 1] == lists[i - 1].size()) {
+                    pos[i - 1] = 0;
+                    flat[vars[i - 1]] = lists[i - 1][0];
+                    --i;
+                }
+                if (i == 0) return true;
+                flat[vars[i - 1]] = lists[i - 1][pos[i - 1]];
+            }
+        }
+
+        //! Called once the join is over.
+        virtual void end() {}
+
+        size_type width() const {
+            return m_width;
+        }
+    };
+
+    //! Counts the results.
+    class count_sink : public result_sink {
+    private:
+        size_type m_count = 0;
+
+    public:
+        bool push(const value_type *) override {
+            ++m_count;
+            return true;
+        }
+
+        bool push_product(const value_type *, const std::vector<size_type> &,
+                          const std::vector<std::vector<value_type>> &lists) override {
+            size_type n = 1;
+            for (const auto &list : lists) {
+                n *= list.size();
+            }
+            m_count += n;
+            return true;
+        }
+
+        size_type count() const {
+            return m_count;
+        }
+    };
+
+    //! Appends every result to a vector of tuples (pairs variable - value, by variable id).
+    template<class tuple_t>
+    class tuple_sink : public result_sink {
+    private:
+        std::vector<tuple_t> &m_res;
+
+    public:
+        explicit tuple_sink(std::vector<tuple_t> &res) : m_res(res) {}
+
+        bool push(const value_type *row) override {
+            tuple_t tuple;
+            tuple.reserve(m_width);
+            for (size_type v = 0; v < m_width; ++v) {
+                tuple.emplace_back(v, row[v]);
+            }
+            m_res.emplace_back(std::move(tuple));
+            return true;
+        }
+    };
+
+    //! Keeps the results factorized: every product of lists is stored once, without expanding it.
+    class factorized_sink : public result_sink {
+    public:
+        //! Rows that extend 'row' with every combination of the values of 'lists' (one row if there are no lists).
+        struct product_type {
+            std::vector<value_type> row;
+            std::vector<size_type> vars;
+            std::vector<std::vector<value_type>> lists;
+
+            size_type size() const {
+                size_type n = 1;
+                for (const auto &list : lists) {
+                    n *= list.size();
+                }
+                return n;
+            }
+        };
+
+    private:
+        std::vector<product_type> m_products;
+        size_type m_size = 0;
+
+    public:
+        bool push(const value_type *row) override {
+            product_type product;
+            product.row.assign(row, row + m_width);
+            m_products.emplace_back(std::move(product));
+            ++m_size;
+            return true;
+        }
+
+        bool push_product(const value_type *row, const std::vector<size_type> &vars,
+                          const std::vector<std::vector<value_type>> &lists) override {
+            product_type product;
+            product.row.assign(row, row + m_width);
+            product.vars = vars;
+            product.lists = lists;
+            m_size += product.size();
+            m_products.emplace_back(std::move(product));
+            return true;
+        }
+
+        //! Number of results.
+        size_type size() const {
+            return m_size;
+        }
+
+        const std::vector<product_type> &products() const {
+            return m_products;
+        }
+
+        //! Passes the results to 'sink', which flattens the products unless it keeps them factorized.
+        bool flatten(result_sink &sink) const {
+            sink.begin(m_width);
+            bool ok = true;
+            for (size_type i = 0; i < m_products.size() && ok; ++i) {
+                const product_type &product = m_products[i];
+                ok = product.lists.empty() ? sink.push(product.row.data())
+                                           : sink.push_product(product.row.data(), product.vars, product.lists);
+            }
+            sink.end();
+            return ok;
+        }
+    };
+
+    //! Writes every result as a line of values separated by 'separator' (CSV by default).
+    class csv_sink : public result_sink {
+    private:
+        FILE *m_out;
+        char m_separator;
+
+    public:
+        explicit csv_sink(FILE *out, const char separator = ',') : m_out(out), m_separator(separator) {}
+
+        bool push(const value_type *row) override {
+            for (size_type v = 0; v < m_width; ++v) {
+                if (v > 0) fputc(m_separator, m_out);
+                fprintf(m_out, "%llu", (unsigned long long) row[v]);
+            }
+            return fputc('\n', m_out) != EOF;
+        }
+    };
+
+    //! Writes every result as 'width' 64-bit values in the byte order of the machine.
+    class binary_sink : public result_sink {
+    private:
+        FILE *m_out;
+
+    public:
+        explicit binary_sink(FILE *out) : m_out(out) {}
+
+        bool push(const value_type *row) override {
+            return fwrite(row, sizeof(value_type), m_width, m_out) == m_width;
+        }
+    };
+
+    //! Stores the results column by column in a buffer allocated once.
+    /*!
+    * The join stops when the buffer is full.
+    */
+    class columnar_sink : public result_sink {
+    private:
+        size_type m_capacity;
+        size_type m_size = 0;
+        std::vector<value_type> m_data;
+
+    public:
+        //! Constructor
+        /*!
+        * \param capacity : maximum number of rows.
+        */
+        explicit columnar_sink(const size_type capacity) : m_capacity(capacity) {}
+
+        void begin(const size_type width) override {
+            result_sink::begin(width);
+            m_size = 0;
+            m_data.resize(width * m_capacity);
+        }
+
+        bool push(const value_type *row) override {
+            if (m_size == m_capacity) return false;
+            for (size_type v = 0; v < m_width; ++v) {
+                m_data[v * m_capacity + m_size] = row[v];
+            }
+            return ++m_size < m_capacity;
+        }
+
+        size_type size() const {
+            return m_size;
+        }
+
+        //! Values of the variable v, one per row.
+        const value_type *column(const size_type v) const {
+            return m_data.data() + v * m_capacity;
+        }
+
+        value_type at(const size_type row, const size_type v) const {
+            return m_data[v * m_capacity + row];
+        }
+    };
+}
+
+#endif //RING_RESULT_SINK_HPP
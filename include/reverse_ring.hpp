@@ -22,7 +22,12 @@
 
 #include <cstdint>
 #include "bwt.hpp"
+#include "rl_bwt.hpp"
 #include "bwt_interval.hpp"
+#include "triple_sort.hpp"
+#include "parallel.hpp"
+#include "triple_stats.hpp"
+#include "external_build.hpp"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -67,177 +72,115 @@ namespace ring {
         reverse_ring() = default;
 
         // Assumes the triples have been stored in a vector<spo_triple>
-        reverse_ring(vector<spo_triple_type> &D) {
-            typedef typename vector<spo_triple_type>::iterator triple_iterator;
+        // The wavelet matrices of the three BWTs are built using up to 'threads' threads.
+        reverse_ring(vector<spo_triple_type> &D, const uint64_t threads = 1) {
             size_type i;
-            triple_iterator it, triple_begin = D.begin(), triple_end = D.end();
-            size_type n = m_n_triples = triple_end - triple_begin;
-            sdsl::int_vector<32> bwt_aux(3 * n);
-
-            //cout << "  > Determining alphabets of S; O; P..."; fflush(stdout);
-            {
-                set<uint64_t> alphabet_S, alphabet_P, alphabet_O;
-                for (it = triple_begin, i = 0; i < n; i++, it++) {
-                    alphabet_S.insert(std::get<0>(*it));
-                    alphabet_O.insert(std::get<1>(*it));
-                    alphabet_P.insert(std::get<2>(*it));
-                }
-
-                //cout << "Done" << endl; fflush(stdout);
-                m_sigma_s = alphabet_S.size();
-                m_sigma_o = alphabet_O.size();
-                m_sigma_p = alphabet_P.size();
-                m_max_s = *alphabet_S.rbegin();
-                m_max_o = *alphabet_O.rbegin();
-                m_max_p = *alphabet_P.rbegin();
-                alphabet_S.clear();
-                alphabet_O.clear();
-                alphabet_P.clear();
-                //std::cout << " Maximum sizes. S = " << m_max_s << ", O = " << m_max_o << ", P = " << m_max_p << std::endl;
-            }
-            /*std::cout << "sigma S = " << m_sigma_s << std::endl;
-            std::cout << "sigma O = " << m_sigma_o << std::endl;
-            std::cout << "sigma P = " << m_sigma_p << std::endl;
-            std::cout << "  > Determining number of elements per symbol..."; fflush(stdout);*/
+            size_type n = m_n_triples = D.size();
+
+            //cout << "  > Determining alphabets and number of elements per symbol..."; fflush(stdout);
+            symbol_counts count_S = count_symbols<0>(D, threads);
+            symbol_counts count_O = count_symbols<1>(D, threads);
+            symbol_counts count_P = count_symbols<2>(D, threads);
+            m_sigma_s = count_S.sigma();
+            m_sigma_o = count_O.sigma();
+            m_sigma_p = count_P.sigma();
+            m_max_s = count_S.max();
+            m_max_o = count_O.max();
+            m_max_p = count_P.max();
             uint64_t alphabet_SO = (m_max_s < m_max_o) ? m_max_o : m_max_s;
-
-            std::map<uint64_t, uint64_t> M_O, M_S, M_P;
-
-            for (i = 1; i <= alphabet_SO; i++) {
-                M_O[i] = 0;
-                M_S[i] = 0;
-            }
-
-            for (i = 1; i <= m_max_p; i++)
-                M_P[i] = 0;
-
-            for (it = triple_begin, i = 0; i < n; i++, it++) {
-                M_S[std::get<0>(*it)] = M_S[std::get<0>(*it)] + 1;
-                M_O[std::get<1>(*it)] = M_O[std::get<1>(*it)] + 1;
-                M_P[std::get<2>(*it)] = M_P[std::get<2>(*it)] + 1;
-            }
-            //std::cout << "Done" << std::endl; fflush(stdout);
-            //std::cout << "  > Sorting out triples..."; fflush(stdout);
-            // Sorts the triples lexycographically
-            sort(triple_begin, triple_end);
-            //std::cout << "Done" << std::endl; fflush(stdout);
-            {
-                sdsl::int_vector<> t(3 * n + 2);
-                //std::cout << "  > Generating int vector of the triples..."; fflush(stdout);
-                for (i = 0, it = triple_begin; it != triple_end; it++, i++) {
-                    t[3 * i] = std::get<0>(*it);//S
-                    t[3 * i + 1] = std::get<1>(*it) + m_max_s; //O
-                    t[3 * i + 2] = std::get<2>(*it) + m_max_s + m_max_o; //P
-                }
-                t[3 * n] = m_max_s + m_max_p + m_max_o + 1;
-                t[3 * n + 1] = 0;
-                D.clear();
-                D.shrink_to_fit();
-                sdsl::util::bit_compress(t);
-
-                {
-                    sdsl::int_vector<> sa;
-                    sdsl::qsufsort::construct_sa(sa, t);
-
-                    //std::cout << "  > Suffix array built " << size_in_bytes(sa) << " bytes" <<  std::endl;
-                    //std::cout << "  > Building the global BWT" << std::endl;
-
-                    size_type j;
-                    for (j = i = 0; i < sa.size(); i++) {
-                        if (sa[i] >= 3 * n) continue;
-                        if (sa[i] == 0)
-                            bwt_aux[j] = t[t.size() - 3];
-                        else bwt_aux[j] = t[sa[i] - 1];
-                        j++;
-                    }
-                }
-            }
+            // The L columns are obtained by sorting the triples in the cyclic orders SOP, PSO and OPS.
+            // With a single thread every wavelet matrix is built as soon as its column is sorted, so only
+            // one column is kept at a time; otherwise the three columns are kept to build them concurrently.
+            const bool sequential = threads <= 1;
+            vector<spo_triple_type> aux;
+            sdsl::int_vector<> P, O, S;
+            vector<uint64_t> C_P, C_O, C_S;
             //cout << "  > Building m_bwt_p" << endl; fflush(stdout);
-            // First P
+            // First P (SOP order)
             {
-                sdsl::int_vector<> P(n + 1);
-                uint64_t j = 1, c;
-                vector<uint64_t> C_P;
+                triple_sort::sort_lexicographic(D, aux, m_max_s, m_max_o, m_max_p);
+                P = sdsl::int_vector<>(n + 1);
                 P[0] = 0;
-                for (i = 1; i < n; i++)
-                    P[j++] = bwt_aux[i] - (m_max_s + m_max_o);
-
-                // This is for making the bwt of triples circular
-                P[j] = bwt_aux[0] - (m_max_s + m_max_o);
+                for (i = 0; i < n; i++)
+                    P[i + 1] = std::get<2>(D[i]);
                 sdsl::util::bit_compress(P);
                 //pre requisites to build the C bitmap. We use Map of S since they represent the range of P.
-                uint64_t cur_pos = 1;
-
-                C_P.push_back(0); // Dummy value
-                C_P.push_back(cur_pos);
-                for (c = 2; c <= alphabet_SO; c++) {
-                    cur_pos += M_S[c - 1];
-                    C_P.push_back(cur_pos);
+                C_P = count_S.C(alphabet_SO, n);
+                if (sequential) {
+                    m_bwt_p = bwt_type(P, C_P);
+                    sdsl::util::clear(P);
                 }
-                C_P.push_back(n + 1);
-                C_P.shrink_to_fit();
+            }
 
-                M_S.clear();
+            //cout << "  > Building m_bwt_o" << endl; fflush(stdout);
+            // Then O (PSO order)
+            {
+                triple_sort::sort_by_component<2>(D, aux, m_max_p);
+                O = sdsl::int_vector<>(n + 1);
 
-                // builds the WT for BWT(P)
-                m_bwt_p = bwt_type(P, C_P);
+                O[0] = 0;
+                for (i = 0; i < n; i++)
+                    O[i + 1] = std::get<1>(D[i]);
+                sdsl::util::bit_compress(O);
+
+                C_O = count_P.C(m_max_p, n);
+                if (sequential) {
+                    m_bwt_o = bwt_type(O, C_O);
+                    sdsl::util::clear(O);
+                }
             }
 
             //cout << "  > Building m_bwt_s" << endl; fflush(stdout);
-            // Then S
+            // Then S (OPS order)
             {
-                sdsl::int_vector<> S(n + 1);
-                uint64_t j = 1, c;
-                vector<uint64_t> C_S;
+                triple_sort::sort_by_component<1>(D, aux, m_max_o);
+                S = sdsl::int_vector<>(n + 1);
 
                 S[0] = 0;
-                while (i < 2 * n) {
-                    S[j++] = bwt_aux[i++];
-                }
+                for (i = 0; i < n; i++)
+                    S[i + 1] = std::get<0>(D[i]);
                 sdsl::util::bit_compress(S);
 
-                uint64_t cur_pos = 1;
-                C_S.push_back(0);  // Dummy value
-                C_S.push_back(cur_pos);
-                for (c = 2; c <= alphabet_SO; c++) {
-                    cur_pos += M_O[c - 1];
-                    C_S.push_back(cur_pos);
+                C_S = count_O.C(alphabet_SO, n);
+                if (sequential) {
+                    m_bwt_s = bwt_type(S, C_S);
+                    sdsl::util::clear(S);
                 }
-                C_S.push_back(n + 1);
-                C_S.shrink_to_fit();
-
-                M_O.clear();
-
-                m_bwt_s = bwt_type(S, C_S);
             }
+            aux.clear();
+            aux.shrink_to_fit();
+            D.clear();
+            D.shrink_to_fit();
+
+            // The three wavelet matrices are independent of each other
+            if (!sequential) {
+                parallel::run_tasks({
+                    [&]() { m_bwt_p = bwt_type(P, C_P); },
+                    [&]() { m_bwt_o = bwt_type(O, C_O); },
+                    [&]() { m_bwt_s = bwt_type(S, C_S); }
+                }, threads);
+            }
+            cout << "-- Index constructed successfully" << endl;
+            fflush(stdout);
+        };
 
-            //cout << "  > Building m_bwt_o" << endl; fflush(stdout);
-            // Then O
-            {
-                sdsl::int_vector<> O(n + 1);
-                uint64_t j = 1, c;
-                vector<uint64_t> C_O;
-
-                O[0] = 0;
-                while (i < 3 * n) {
-                    O[j++] = bwt_aux[i++] - m_max_s;
-                }
-                sdsl::util::bit_compress(O);
-
-                uint64_t cur_pos = 1;
-                C_O.push_back(0);  // Dummy value
-                C_O.push_back(cur_pos);
-                for (c = 2; c <= m_max_p; c++) {
-                    cur_pos += M_P[c - 1];
-                    C_O.push_back(cur_pos);
-                }
-                C_O.push_back(n + 1);
-                C_O.shrink_to_fit();
+        // Builds the index from (s, o, p) triples stored on disk (see external_build.hpp).
+        // At most 'max_memory' bytes are used to sort the triples; temporary files are prefixed by 'tmp_prefix'.
+        reverse_ring(const external::triple_file &triples, const uint64_t max_memory, const std::string &tmp_prefix) {
+            m_n_triples = triples.size();
+            m_max_s = triples.max(0);
+            m_max_o = triples.max(1);
+            m_max_p = triples.max(2);
+            m_sigma_s = triples.sigma(0);
+            m_sigma_o = triples.sigma(1);
+            m_sigma_p = triples.sigma(2);
+            uint64_t alphabet_SO = (m_max_s < m_max_o) ? m_max_o : m_max_s;
 
-                M_P.clear();
+            // P in SOP order, O in PSO order and S in OPS order
+            external::build_bwt<0>(m_bwt_p, triples, alphabet_SO, max_memory, tmp_prefix, "m_bwt_p");
+            external::build_bwt<2>(m_bwt_o, triples, m_max_p, max_memory, tmp_prefix, "m_bwt_o");
+            external::build_bwt<1>(m_bwt_s, triples, alphabet_SO, max_memory, tmp_prefix, "m_bwt_s");
 
-                m_bwt_o = bwt_type(O, C_O);
-            }
             cout << "-- Index constructed successfully" << endl;
             fflush(stdout);
         };
@@ -354,14 +297,14 @@ namespace ring {
         /**********************************/
         // Functions for PSO
         //
-        bwt_interval open_PSO() {
+        bwt_interval open_PSO() const {
             //return bwt_interval(2 * m_n_triples + 1, 3 * m_n_triples);
             return bwt_interval( 1, m_n_triples);
         }
 
         // P->S  (simulates going down in the trie, for the order PSO)
         // Returns an interval within m_bwt_o
-        bwt_interval down_P_S(bwt_interval &p_int, uint64_t p_value, uint64_t s_value) {
+        bwt_interval down_P_S(bwt_interval &p_int, uint64_t p_value, uint64_t s_value) const {
             std::cout << "SOP forward down_P_S" << std::endl;
             std::pair<uint64_t, uint64_t> q = p_int.get_stored_values();
             uint64_t b = q.first;
@@ -369,13 +312,13 @@ namespace ring {
                 q = m_bwt_p.select_next(s_value, p_value, m_bwt_o.nElems(p_value));
                 b = m_bwt_p.bsearch_C(q.first) - 1;
             }
-            uint64_t nE = m_bwt_p.rank(b + 1, p_value) - m_bwt_p.rank(b, p_value);
+            uint64_t nE = m_bwt_p.rank_in_range(b, p_value);
             uint64_t start = q.second;
 
             return bwt_interval(p_int.left() + start, p_int.left() + start + nE - 1);
         }
     
-        uint64_t min_O_in_S(bwt_interval &s_int, uint64_t s_value) {
+        uint64_t min_O_in_S(bwt_interval &s_int, uint64_t s_value) const {
             std::cout << "SOP forward min_O_in_S" << std::endl;
             std::pair<uint64_t, uint64_t> q;
             q = m_bwt_s.select_next(1, s_value, m_bwt_p.nElems(s_value));
@@ -384,7 +327,7 @@ namespace ring {
             return b;
         }
    
-        uint64_t next_O_in_S(bwt_interval &I, uint64_t s_value, uint64_t o_value) {
+        uint64_t next_O_in_S(bwt_interval &I, uint64_t s_value, uint64_t o_value) const {
             std::cout << "SOP forward next_O_in_S" << std::endl;
             if (o_value > m_max_o) return 0;
 
@@ -399,15 +342,24 @@ namespace ring {
         }
 
         std::vector<uint64_t>
-        all_O_in_range(bwt_interval &I) {
+        all_O_in_range(bwt_interval &I) const {
             return m_bwt_o.values_in_range(I.left(), I.right());
         }
+
+        void all_O_in_range(bwt_interval &I, std::vector<uint64_t> &values) const {
+            m_bwt_o.values_in_range(I.left(), I.right(), values);
+        }
+
+        template<class t_f>
+        void all_O_in_range(bwt_interval &I, t_f f) const {
+            m_bwt_o.values_in_range(I.left(), I.right(), f);
+        }
         
-        uint64_t min_O_in_PS(bwt_interval &I) {
+        uint64_t min_O_in_PS(bwt_interval &I) const {
             return I.begin(m_bwt_o);
         }
 
-        uint64_t next_O_in_PS(bwt_interval &I, uint64_t O) {
+        uint64_t next_O_in_PS(bwt_interval &I, uint64_t O) const {
             if (O > m_max_o) return 0;
 
             uint64_t nextv = I.next_value(O, m_bwt_o);
@@ -420,12 +372,12 @@ namespace ring {
         /**********************************/
         // Functions for OPS
         //
-        bwt_interval open_OPS() {
+        bwt_interval open_OPS() const {
             return bwt_interval(1, m_n_triples);
         }
         // O->P  (simulates going down in the trie)
         // Returns an interval within m_bwt_s
-        bwt_interval down_O_P(bwt_interval &o_int, uint64_t o_value, uint64_t p_value) {
+        bwt_interval down_O_P(bwt_interval &o_int, uint64_t o_value, uint64_t p_value) const {
             std::cout << "SOP forward down_O_P" << std::endl;
             std::pair<uint64_t, uint64_t> q = o_int.get_stored_values();
             uint64_t b = q.first;
@@ -433,18 +385,18 @@ namespace ring {
                 q = m_bwt_o.select_next(p_value, o_value, m_bwt_s.nElems(o_value));
                 b = m_bwt_o.bsearch_C(q.first) - 1;
             }
-            uint64_t nE = m_bwt_o.rank(b + 1, o_value) - m_bwt_o.rank(b, o_value);
+            uint64_t nE = m_bwt_o.rank_in_range(b, o_value);
             uint64_t start = q.second;
             
             return bwt_interval(o_int.left() + start, o_int.left() + start + nE - 1);
         }
 
 
-        uint64_t min_S_in_OP(bwt_interval &I) {
+        uint64_t min_S_in_OP(bwt_interval &I) const {
             return I.begin(m_bwt_s);
         }
 
-        uint64_t next_S_in_OP(bwt_interval &I, uint64_t s_value) {
+        uint64_t next_S_in_OP(bwt_interval &I, uint64_t s_value) const {
             if (s_value > m_max_s) return 0;
 
             uint64_t nextv = I.next_value(s_value, m_bwt_s);
@@ -455,7 +407,7 @@ namespace ring {
         }
 
 
-        uint64_t min_S_in_P(bwt_interval &p_int, uint64_t p_value) {
+        uint64_t min_S_in_P(bwt_interval &p_int, uint64_t p_value) const {
             std::cout << "SOP forward min_S_in_P" << std::endl;
             std::pair<uint64_t, uint64_t> q;
             q = m_bwt_p.select_next(1, p_value, m_bwt_o.nElems(p_value));
@@ -464,7 +416,7 @@ namespace ring {
             return b;
         }
         
-        uint64_t next_S_in_P(bwt_interval &I, uint64_t p_value, uint64_t s_value) {
+        uint64_t next_S_in_P(bwt_interval &I, uint64_t p_value, uint64_t s_value) const {
             std::cout << "SOP forward next_S_in_P" << std::endl;
             if (s_value > m_max_s) return 0;
 
@@ -480,19 +432,28 @@ namespace ring {
         }
 
         std::vector<uint64_t>
-        all_S_in_range(bwt_interval &I) {
+        all_S_in_range(bwt_interval &I) const {
             return m_bwt_s.values_in_range(I.left(), I.right());
         }
 
+        void all_S_in_range(bwt_interval &I, std::vector<uint64_t> &values) const {
+            m_bwt_s.values_in_range(I.left(), I.right(), values);
+        }
+
+        template<class t_f>
+        void all_S_in_range(bwt_interval &I, t_f f) const {
+            m_bwt_s.values_in_range(I.left(), I.right(), f);
+        }
+
         /**********************************/
         // Functions for SOP
         //
-        bwt_interval open_SOP() {
+        bwt_interval open_SOP() const {
             return bwt_interval(1,  m_n_triples);
         }
         // S->O  (simulates going down in the trie)
         // Returns an interval within m_bwt_p
-        bwt_interval down_S_O(bwt_interval &s_int, uint64_t s_value, uint64_t o_value) {
+        bwt_interval down_S_O(bwt_interval &s_int, uint64_t s_value, uint64_t o_value) const {
             std::cout << "SOP forward down_S_O" << std::endl;
             std::pair<uint64_t, uint64_t> q = s_int.get_stored_values();
             uint64_t b = q.first;
@@ -500,17 +461,17 @@ namespace ring {
                 q = m_bwt_s.select_next(o_value, s_value, m_bwt_p.nElems(s_value));
                 b = m_bwt_s.bsearch_C(q.first) - 1;
             }
-            uint64_t nE = m_bwt_p.rank(b + 1, s_value) - m_bwt_p.rank(b, s_value);
+            uint64_t nE = m_bwt_p.rank_in_range(b, s_value);
             uint64_t start = q.second;
 
             return bwt_interval(s_int.left() + start, s_int.left() + start + nE - 1);
         }
         
-        uint64_t min_P_in_SO(bwt_interval &I) {
+        uint64_t min_P_in_SO(bwt_interval &I) const {
             return I.begin(m_bwt_p);
         }
 
-        uint64_t next_P_in_SO(bwt_interval &I, uint64_t p_value) {
+        uint64_t next_P_in_SO(bwt_interval &I, uint64_t p_value) const {
             if (p_value > m_max_p) return 0;
 
             uint64_t nextv = I.next_value(p_value, m_bwt_p);
@@ -520,7 +481,7 @@ namespace ring {
                 return nextv;
         }
 
-        uint64_t min_P_in_O(bwt_interval &o_int, uint64_t o_value) {
+        uint64_t min_P_in_O(bwt_interval &o_int, uint64_t o_value) const {
             std::cout << "SOP forward min_P_in_O" << std::endl;
             std::pair<uint64_t, uint64_t> q;
             q = m_bwt_o.select_next(1, o_value, m_bwt_s.nElems(o_value));
@@ -529,7 +490,7 @@ namespace ring {
             return b;
         }
 
-        uint64_t next_P_in_O(bwt_interval &I, uint64_t o_value, uint64_t p_value) {
+        uint64_t next_P_in_O(bwt_interval &I, uint64_t o_value, uint64_t p_value) const {
             std::cout << "SOP forward next_P_in_O" << std::endl;
             if (p_value > m_max_p) return 0;
 
@@ -544,27 +505,36 @@ namespace ring {
         }
 
         std::vector<uint64_t>
-        all_P_in_range(bwt_interval &I) {
+        all_P_in_range(bwt_interval &I) const {
             return m_bwt_p.values_in_range(I.left(), I.right());
         }
+
+        void all_P_in_range(bwt_interval &I, std::vector<uint64_t> &values) const {
+            m_bwt_p.values_in_range(I.left(), I.right(), values);
+        }
+
+        template<class t_f>
+        void all_P_in_range(bwt_interval &I, t_f f) const {
+            m_bwt_p.values_in_range(I.left(), I.right(), f);
+        }
         /**********************************/
         // Functions for SPO
         //
-        bwt_interval open_SPO() {
+        bwt_interval open_SPO() const {
             return bwt_interval(1, m_n_triples);
         }
         
-        uint64_t min_S(bwt_interval &I) {
+        uint64_t min_S(bwt_interval &I) const {
             return I.begin(m_bwt_s);
         }
 
-        uint64_t next_S(bwt_interval &I, uint64_t s_value) {
+        uint64_t next_S(bwt_interval &I, uint64_t s_value) const {
             if (s_value > m_max_s) return 0;
 
             return I.next_value(s_value, m_bwt_s);
         }
 
-        bwt_interval down_S(uint64_t s_value) {
+        bwt_interval down_S(uint64_t s_value) const {
             pair<uint64_t, uint64_t> i = init_S(s_value);
             return bwt_interval(i.first, i.second);
         }
@@ -572,17 +542,17 @@ namespace ring {
 
         // S->P  (simulates going down in the trie, for the order SPO)
         // Returns an interval within m_bwt_p
-        bwt_interval down_S_P(bwt_interval &s_int, uint64_t p) {
+        bwt_interval down_S_P(bwt_interval &s_int, uint64_t p) const {
             auto I = m_bwt_p.backward_step(s_int.left(), s_int.right(), p);
             uint64_t c = m_bwt_o.get_C(p);
             return bwt_interval(I.first + c, I.second + c);
         }
         
-        uint64_t min_P_in_S(bwt_interval &I) {
+        uint64_t min_P_in_S(bwt_interval &I) const {
             return I.begin(m_bwt_p);
         }
     
-        uint64_t next_P_in_S(bwt_interval &I, uint64_t P) {
+        uint64_t next_P_in_S(bwt_interval &I, uint64_t P) const {
             if (P > m_max_p) return 0;
 
             uint64_t nextv = I.next_value(P, m_bwt_p);
@@ -592,11 +562,11 @@ namespace ring {
                 return nextv;
         }
 
-        uint64_t min_O_in_SP(bwt_interval &I) {
+        uint64_t min_O_in_SP(bwt_interval &I) const {
             return I.begin(m_bwt_o);
         }
 
-        uint64_t next_O_in_SP(bwt_interval &I, uint64_t O) {
+        uint64_t next_O_in_SP(bwt_interval &I, uint64_t O) const {
             if (O > m_max_o) return 0;
 
             uint64_t next_v = I.next_value(O, m_bwt_o);
@@ -610,17 +580,17 @@ namespace ring {
         /**********************************/
         // Functions for POS
         //
-        bwt_interval open_POS() {
+        bwt_interval open_POS() const {
             return bwt_interval( 1, m_n_triples);
         }
 
-        uint64_t min_P(bwt_interval &I) {
+        uint64_t min_P(bwt_interval &I) const {
             //bwt_interval I_aux(I.left() - 2 * m_n_triples, I.right() - 2 * m_n_triples);
             //return I_aux.begin(m_bwt_p);
             return I.begin(m_bwt_p);
         }
 
-        uint64_t next_P(bwt_interval &I, uint64_t p_value) {
+        uint64_t next_P(bwt_interval &I, uint64_t p_value) const {
             if (p_value > m_max_p) return 0;
 
             //bwt_interval I_aux(I.left() - 2 * m_n_triples, I.right() - 2 * m_n_triples);
@@ -632,22 +602,22 @@ namespace ring {
                 return nextv;
         }
 
-        bwt_interval down_P(uint64_t p_value) {
+        bwt_interval down_P(uint64_t p_value) const {
             pair<uint64_t, uint64_t> i = init_P(p_value);
             return bwt_interval(i.first, i.second);
         }
         
-        bwt_interval down_P_O(bwt_interval &p_int, uint64_t o) {
+        bwt_interval down_P_O(bwt_interval &p_int, uint64_t o) const {
             auto I = m_bwt_o.backward_step(p_int.left(), p_int.right(), o);
             uint64_t c = m_bwt_s.get_C(o);
             return bwt_interval(I.first + c, I.second + c);
         }
 
-        uint64_t min_O_in_P(bwt_interval &I) {
+        uint64_t min_O_in_P(bwt_interval &I) const {
             return I.begin(m_bwt_o);
         }
         
-        uint64_t next_O_in_P(bwt_interval &I, uint64_t O) {
+        uint64_t next_O_in_P(bwt_interval &I, uint64_t O) const {
             if (O > m_max_o) return 0;
 
             uint64_t nextv = I.next_value(O, m_bwt_o);
@@ -657,13 +627,13 @@ namespace ring {
                 return nextv;
         }
 
-        uint64_t min_S_in_PO(bwt_interval &I) {
+        uint64_t min_S_in_PO(bwt_interval &I) const {
            // bwt_interval I_aux = bwt_interval(I.left() - m_n_triples, I.right() - m_n_triples);
             //return I_aux.begin(m_bwt_s);
             return I.begin(m_bwt_s);
         }
 
-        uint64_t next_S_in_PO(bwt_interval &I, uint64_t s_value) {
+        uint64_t next_S_in_PO(bwt_interval &I, uint64_t s_value) const {
             if (s_value > m_max_s) return 0;
 
             //bwt_interval I_aux = bwt_interval(I.left() - m_n_triples, I.right() - m_n_triples);
@@ -674,15 +644,15 @@ namespace ring {
         /**********************************/
         // Functions for OSP
         //
-        bwt_interval open_OSP() {
+        bwt_interval open_OSP() const {
             return bwt_interval(1, m_n_triples);
         }
 
-        uint64_t min_O(bwt_interval &I) {
+        uint64_t min_O(bwt_interval &I) const {
             return I.begin(m_bwt_o);
         }
 
-        uint64_t next_O(bwt_interval &I, uint64_t o_value) {
+        uint64_t next_O(bwt_interval &I, uint64_t o_value) const {
             if (o_value > m_max_o) return 0;
 
             uint64_t nextv = I.next_value(o_value, m_bwt_o);
@@ -690,24 +660,24 @@ namespace ring {
             else return nextv;
         }
 
-        bwt_interval down_O(uint64_t o_value) {
+        bwt_interval down_O(uint64_t o_value) const {
             pair<uint64_t, uint64_t> i = init_O(o_value);
             return bwt_interval(i.first, i.second);
         }
 
         // O->S  (simulates going down in the trie, for the order OSP)
         // Returns an interval within m_bwt_s
-        bwt_interval down_O_S(bwt_interval &o_int, uint64_t s){
+        bwt_interval down_O_S(bwt_interval &o_int, uint64_t s) const {
             auto I = m_bwt_s.backward_step(o_int.left(), o_int.right(), s);
             uint64_t c = m_bwt_p.get_C(s);
             return bwt_interval(I.first + c, I.second + c);
         }
 
-        uint64_t min_S_in_O(bwt_interval &I) {
+        uint64_t min_S_in_O(bwt_interval &I) const {
             return I.begin(m_bwt_s);
         }
 
-        uint64_t next_S_in_O(bwt_interval &I, uint64_t S) {
+        uint64_t next_S_in_O(bwt_interval &I, uint64_t S) const {
             if (S > m_max_s) return 0;
 
             uint64_t nextv = I.next_value(S, m_bwt_s);
@@ -717,11 +687,11 @@ namespace ring {
                 return nextv;
         }
 
-        uint64_t min_P_in_OS(bwt_interval &I) {
+        uint64_t min_P_in_OS(bwt_interval &I) const {
             return I.begin(m_bwt_p);
         }
 
-        uint64_t next_P_in_OS(bwt_interval &I, uint64_t p_value) {
+        uint64_t next_P_in_OS(bwt_interval &I, uint64_t p_value) const {
             if (p_value > m_max_p) return 0;
 
             uint64_t nextv = I.next_value(p_value, m_bwt_p);
@@ -731,15 +701,15 @@ namespace ring {
                 return nextv;
         }
 
-        bwt_type get_m_bwt_s() const{
+        const bwt_type &get_m_bwt_s() const{
             return m_bwt_s;
         }
 
-        bwt_type get_m_bwt_o() const{
+        const bwt_type &get_m_bwt_o() const{
             return m_bwt_o;
         }
 
-        bwt_type get_m_bwt_p() const{
+        const bwt_type &get_m_bwt_p() const{
             return m_bwt_p;
         }
 
@@ -747,7 +717,7 @@ namespace ring {
             return m_n_triples;
         }
         //Used for testing purposes exclusively.
-        std::vector<uint64_t> get_P_given_S(uint64_t symbol_id){
+        std::vector<uint64_t> get_P_given_S(uint64_t symbol_id) const{
             std::vector<u_int64_t> results;
             pair<uint64_t, uint64_t> i = {m_bwt_p.get_C(symbol_id), m_bwt_p.get_C(symbol_id + 1) - 1};//Returns C_p[symbol_id], C_p[symbol_id] + 1
             auto interval = bwt_interval(i.first, i.second);
@@ -755,7 +725,7 @@ namespace ring {
             return results;
         }
         //Used for testing purposes exclusively.
-        std::vector<uint64_t> get_O_given_P(uint64_t symbol_id){
+        std::vector<uint64_t> get_O_given_P(uint64_t symbol_id) const{
             std::vector<u_int64_t> results;
             pair<uint64_t, uint64_t> i = {m_bwt_o.get_C(symbol_id), m_bwt_o.get_C(symbol_id + 1) - 1};//Returns C_o[symbol_id], C_o[symbol_id] + 1
             auto interval = bwt_interval(i.first, i.second);
@@ -763,7 +733,7 @@ namespace ring {
             return results;
         }
         //Used for testing purposes exclusively.
-        std::vector<uint64_t> get_S_given_O(uint64_t symbol_id){
+        std::vector<uint64_t> get_S_given_O(uint64_t symbol_id) const{
             std::vector<u_int64_t> results;
             pair<uint64_t, uint64_t> i = {m_bwt_s.get_C(symbol_id), m_bwt_s.get_C(symbol_id + 1) - 1};//Returns C_o[symbol_id], C_o[symbol_id] + 1
             auto interval = bwt_interval(i.first, i.second);
@@ -773,6 +743,7 @@ namespace ring {
     };
 
     typedef reverse_ring<bwt<sdsl::rrr_vector<15>>> c_reverse_ring;
+    typedef reverse_ring<rl_bwt<>> rl_reverse_ring;
 }
 
 #endif
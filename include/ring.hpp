@@ -22,8 +22,14 @@
 
 #include <cstdint>
 #include "bwt.hpp"
+#include "rl_bwt.hpp"
 #include "bwt_interval.hpp"
 #include "crc_arrays.hpp"
+#include "triple_sort.hpp"
+#include "parallel.hpp"
+#include "triple_stats.hpp"
+#include "external_build.hpp"
+#include "mmap_stream.hpp"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -73,175 +79,91 @@ namespace ring {
 
         // Assumes the triples have been stored in a vector<spo_triple>
         // This constructor is used to index the data.
-        ring(vector<spo_triple_type> &D) {
-            typedef typename vector<spo_triple_type>::iterator triple_iterator;
+        // The wavelet matrices of the three BWTs are built using up to 'threads' threads.
+        ring(vector<spo_triple_type> &D, const uint64_t threads = 1) {
             size_type i;
-            triple_iterator it, triple_begin = D.begin(), triple_end = D.end();
-            size_type n = m_n_triples = triple_end - triple_begin;
-            sdsl::int_vector<32> bwt_aux(3 * n);
-
-            //cout << "  > Determining alphabets of S; P; O..."; fflush(stdout);
-            {
-                set<uint64_t> alphabet_S, alphabet_P, alphabet_O;
-                for (it = triple_begin, i = 0; i < n; i++, it++) {
-                    alphabet_S.insert(std::get<0>(*it));
-                    alphabet_P.insert(std::get<1>(*it));
-                    alphabet_O.insert(std::get<2>(*it));
-                }
-
-                //cout << "Done" << endl; fflush(stdout);
-                m_sigma_s = alphabet_S.size();
-                m_sigma_p = alphabet_P.size();
-                m_sigma_o = alphabet_O.size();
-                m_max_s = *alphabet_S.rbegin();
-                m_max_p = *alphabet_P.rbegin();
-                m_max_o = *alphabet_O.rbegin();
-                alphabet_S.clear();
-                alphabet_P.clear();
-                alphabet_O.clear();
-            }
-            //cout << "sigma S = " << sigma_S << endl;
-            //cout << "sigma P = " << m_sigma_p << endl;
-            //cout << "sigma O = " << sigma_O << endl;
-            //cout << "  > Determining number of elements per symbol..."; fflush(stdout);
+            size_type n = m_n_triples = D.size();
+
+            //cout << "  > Determining alphabets and number of elements per symbol..."; fflush(stdout);
+            symbol_counts count_S = count_symbols<0>(D, threads);
+            symbol_counts count_P = count_symbols<1>(D, threads);
+            symbol_counts count_O = count_symbols<2>(D, threads);
+            m_sigma_s = count_S.sigma();
+            m_sigma_p = count_P.sigma();
+            m_sigma_o = count_O.sigma();
+            m_max_s = count_S.max();
+            m_max_p = count_P.max();
+            m_max_o = count_O.max();
             uint64_t alphabet_SO = (m_max_s < m_max_o) ? m_max_o : m_max_s;
-
-            std::map<uint64_t, uint64_t> M_O, M_S, M_P;
-
-            for (i = 1; i <= alphabet_SO; i++) {
-                M_O[i] = 0;
-                M_S[i] = 0;
-            }
-
-            for (i = 1; i <= m_max_p; i++)
-                M_P[i] = 0;
-
-            for (it = triple_begin, i = 0; i < n; i++, it++) {
-                M_O[std::get<2>(*it)] = M_O[std::get<2>(*it)] + 1;
-                M_S[std::get<0>(*it)] = M_S[std::get<0>(*it)] + 1;
-                M_P[std::get<1>(*it)] = M_P[std::get<1>(*it)] + 1;
-            }
-            //cout << "Done" << endl; fflush(stdout);
-            //cout << "  > Sorting out triples..."; fflush(stdout);
-            // Sorts the triples lexycographically
-            sort(triple_begin, triple_end);
-            //cout << "Done" << endl; fflush(stdout);
-            {
-                sdsl::int_vector<> t(3 * n + 2);
-                //cout << "  > Generating int vector of the triples..."; fflush(stdout);
-                for (i = 0, it = triple_begin; it != triple_end; it++, i++) {
-                    t[3 * i] = std::get<0>(*it);
-                    t[3 * i + 1] = std::get<1>(*it) + m_max_s;
-                    t[3 * i + 2] = std::get<2>(*it) + m_max_s + m_max_p;
-                }
-                t[3 * n] = m_max_s + m_max_p + m_max_o + 1;
-                t[3 * n + 1] = 0;
-                //D.clear();
-                //D.shrink_to_fit();
-                sdsl::util::bit_compress(t);
-
-                {
-                    sdsl::int_vector<> sa;
-                    sdsl::qsufsort::construct_sa(sa, t);
-
-                    //cout << "  > Suffix array built " << size_in_bytes(sa) << " bytes" <<  endl;
-                    //cout << "  > Building the global BWT" << endl;
-
-                    size_type j;
-                    for (j = i = 0; i < sa.size(); i++) {
-                        if (sa[i] >= 3 * n) continue;
-                        if (sa[i] == 0)
-                            bwt_aux[j] = t[t.size() - 3];
-                        else bwt_aux[j] = t[sa[i] - 1];
-                        j++;
-                    }
-                }
-            }
+            // The L columns are obtained by sorting the triples in the cyclic orders SPO, OSP and POS.
+            // With a single thread every wavelet matrix is built as soon as its column is sorted, so only
+            // one column is kept at a time; otherwise the three columns are kept to build them concurrently.
+            const bool sequential = threads <= 1;
+            vector<spo_triple_type> aux;
+            sdsl::int_vector<> O, P, S;
+            vector<uint64_t> C_O, C_P, C_S;
             //cout << "  > Building m_bwt_o" << endl; fflush(stdout);
-            // First O
+            // First O (SPO order)
             {
-                sdsl::int_vector<> O(n + 1);
-                uint64_t j = 1, c;
-                vector<uint64_t> C_O;
+                triple_sort::sort_lexicographic(D, aux, m_max_s, m_max_p, m_max_o);
+                O = sdsl::int_vector<>(n + 1);
                 O[0] = 0;
-                for (i = 1; i < n; i++)
-                    O[j++] = bwt_aux[i] - (m_max_s + m_max_p);
-
-                // This is for making the bwt of triples circular
-                O[j] = bwt_aux[0] - (m_max_s + m_max_p);
+                for (i = 0; i < n; i++)
+                    O[i + 1] = std::get<2>(D[i]);
                 sdsl::util::bit_compress(O);
 
-                uint64_t cur_pos = 1;
-
-                C_O.push_back(0); // Dummy value
-                C_O.push_back(cur_pos);
-                for (c = 2; c <= alphabet_SO; c++) {
-                    cur_pos += M_S[c - 1];
-                    C_O.push_back(cur_pos);
+                C_O = count_S.C(alphabet_SO, n);
+                if (sequential) {
+                    m_bwt_o = bwt_type(O, C_O);
+                    sdsl::util::clear(O);
                 }
-                C_O.push_back(n + 1);
-                C_O.shrink_to_fit();
-
-                M_S.clear();
-
-                // builds the WT for BWT(O)
-                m_bwt_o = bwt_type(O, C_O);
             }
 
-            //cout << "  > Building m_bwt_s" << endl; fflush(stdout);
-            // Then S
+            //cout << "  > Building m_bwt_p" << endl; fflush(stdout);
+            // Then P (OSP order)
             {
-                sdsl::int_vector<> S(n + 1);
-                uint64_t j = 1, c;
-                vector<uint64_t> C_S;
+                triple_sort::sort_by_component<2>(D, aux, m_max_o);
+                P = sdsl::int_vector<>(n + 1);
 
-                S[0] = 0;
-                while (i < 2 * n) {
-                    S[j++] = bwt_aux[i++];
-                }
-                sdsl::util::bit_compress(S);
+                P[0] = 0;
+                for (i = 0; i < n; i++)
+                    P[i + 1] = std::get<1>(D[i]);
+                sdsl::util::bit_compress(P);
 
-                uint64_t cur_pos = 1;
-                C_S.push_back(0);  // Dummy value
-                C_S.push_back(cur_pos);
-                for (c = 2; c <= m_max_p; c++) {
-                    cur_pos += M_P[c - 1];
-                    C_S.push_back(cur_pos);
+                C_P = count_O.C(alphabet_SO, n);
+                if (sequential) {
+                    m_bwt_p = bwt_type(P, C_P);
+                    sdsl::util::clear(P);
                 }
-                C_S.push_back(n + 1);
-                C_S.shrink_to_fit();
-
-                M_P.clear();
-
-                m_bwt_s = bwt_type(S, C_S);
             }
 
-            //cout << "  > Building m_bwt_p" << endl; fflush(stdout);
-            // Then P
+            //cout << "  > Building m_bwt_s" << endl; fflush(stdout);
+            // Then S (POS order)
             {
-                sdsl::int_vector<> P(n + 1);
-                uint64_t j = 1, c;
-                vector<uint64_t> C_P;
+                triple_sort::sort_by_component<1>(D, aux, m_max_p);
+                S = sdsl::int_vector<>(n + 1);
 
-                P[0] = 0;
-                while (i < 3 * n) {
-                    P[j++] = bwt_aux[i++] - m_max_s;
-                }
-                sdsl::util::bit_compress(P);
+                S[0] = 0;
+                for (i = 0; i < n; i++)
+                    S[i + 1] = std::get<0>(D[i]);
+                sdsl::util::bit_compress(S);
 
-                uint64_t cur_pos = 1;
-                C_P.push_back(0);  // Dummy value
-                C_P.push_back(cur_pos);
-                for (c = 2; c <= alphabet_SO; c++) {
-                    cur_pos += M_O[c - 1];
-                    C_P.push_back(cur_pos);
+                C_S = count_P.C(m_max_p, n);
+                if (sequential) {
+                    m_bwt_s = bwt_type(S, C_S);
+                    sdsl::util::clear(S);
                 }
-                C_P.push_back(n + 1);
-                C_P.shrink_to_fit();
-
-                M_O.clear();
-
-                m_bwt_p = bwt_type(P, C_P);
+            }
+            aux.clear();
+            aux.shrink_to_fit();
+
+            // The three wavelet matrices are independent of each other
+            if (!sequential) {
+                parallel::run_tasks({
+                    [&]() { m_bwt_o = bwt_type(O, C_O); },
+                    [&]() { m_bwt_p = bwt_type(P, C_P); },
+                    [&]() { m_bwt_s = bwt_type(S, C_S); }
+                }, threads);
             }
     
             /*std::cout << "bwt_L_o : " << m_bwt_o.get_L() << std::endl;
@@ -251,6 +173,27 @@ namespace ring {
             fflush(stdout);
         };
 
+        // Builds the index from (s, p, o) triples stored on disk (see external_build.hpp).
+        // At most 'max_memory' bytes are used to sort the triples; temporary files are prefixed by 'tmp_prefix'.
+        ring(const external::triple_file &triples, const uint64_t max_memory, const std::string &tmp_prefix) {
+            m_n_triples = triples.size();
+            m_max_s = triples.max(0);
+            m_max_p = triples.max(1);
+            m_max_o = triples.max(2);
+            m_sigma_s = triples.sigma(0);
+            m_sigma_p = triples.sigma(1);
+            m_sigma_o = triples.sigma(2);
+            uint64_t alphabet_SO = (m_max_s < m_max_o) ? m_max_o : m_max_s;
+
+            // O in SPO order, P in OSP order and S in POS order
+            external::build_bwt<0>(m_bwt_o, triples, alphabet_SO, max_memory, tmp_prefix, "m_bwt_o");
+            external::build_bwt<2>(m_bwt_p, triples, alphabet_SO, max_memory, tmp_prefix, "m_bwt_p");
+            external::build_bwt<1>(m_bwt_s, triples, m_max_p, max_memory, tmp_prefix, "m_bwt_s");
+
+            cout << "-- Index constructed successfully" << endl;
+            fflush(stdout);
+        };
+
 
         //! Copy constructor
         ring(const ring &o) {
@@ -344,8 +287,8 @@ namespace ring {
             //Currently crc arrays are stored in a different file.
             //m_crc_arrays.load(in);
         }
-        void load_crc_arrays(std::string file){
-            sdsl::load_from_file(m_crc_arrays, file+".crc");
+        void load_crc_arrays(std::string file, bool mapped_read = false){
+            load_index_file(m_crc_arrays, file+".crc", mapped_read);
         }
         // The following init funtions work with suffix array positions
         // (i.e., positions in the global interval [1, 3*m_n_triples] )
@@ -407,7 +350,7 @@ namespace ring {
         // Functions for PSO
         //
 
-        bwt_interval open_PSO() {
+        bwt_interval open_PSO() const {
             //return bwt_interval(2 * m_n_triples + 1, 3 * m_n_triples);
             return bwt_interval( 1, m_n_triples);
         }
@@ -415,17 +358,17 @@ namespace ring {
         /**********************************/
         // P->S  (simulates going down in the trie)
         // Returns an interval within m_bwt_o
-        bwt_interval down_P_S(bwt_interval &p_int, uint64_t s) {
+        bwt_interval down_P_S(bwt_interval &p_int, uint64_t s) const {
             auto I = m_bwt_s.backward_step(p_int.left(), p_int.right(), s);
             uint64_t c = m_bwt_o.get_C(s);
             return bwt_interval(I.first + c, I.second + c);
         }
 
-        uint64_t min_O_in_S(bwt_interval &I) {
+        uint64_t min_O_in_S(bwt_interval &I) const {
             return I.begin(m_bwt_o);
         }
 
-        uint64_t next_O_in_S(bwt_interval &I, uint64_t O) {
+        uint64_t next_O_in_S(bwt_interval &I, uint64_t O) const {
             if (O > m_max_o) return 0;
 
             uint64_t nextv = I.next_value(O, m_bwt_o);
@@ -435,15 +378,15 @@ namespace ring {
                 return nextv;
         }
 
-        bool there_are_O_in_S(bwt_interval &I) {
+        bool there_are_O_in_S(bwt_interval &I) const {
             return I.get_cur_value() != I.end();
         }
 
-        uint64_t min_O_in_PS(bwt_interval &I) {
+        uint64_t min_O_in_PS(bwt_interval &I) const {
             return I.begin(m_bwt_o);
         }
 
-        uint64_t next_O_in_PS(bwt_interval &I, uint64_t O) {
+        uint64_t next_O_in_PS(bwt_interval &I, uint64_t O) const {
             if (O > m_max_o) return 0;
 
             uint64_t nextv = I.next_value(O, m_bwt_o);
@@ -453,20 +396,29 @@ namespace ring {
                 return nextv;
         }
 
-        bool there_are_O_in_PS(bwt_interval &I) {
+        bool there_are_O_in_PS(bwt_interval &I) const {
             return I.get_cur_value() != I.end();
         }
 
         std::vector<uint64_t>
-        all_O_in_range(bwt_interval &I) {
+        all_O_in_range(bwt_interval &I) const {
             return m_bwt_o.values_in_range(I.left(), I.right());
         }
 
+        void all_O_in_range(bwt_interval &I, std::vector<uint64_t> &values) const {
+            m_bwt_o.values_in_range(I.left(), I.right(), values);
+        }
+
+        template<class t_f>
+        void all_O_in_range(bwt_interval &I, t_f f) const {
+            m_bwt_o.values_in_range(I.left(), I.right(), f);
+        }
+
         /**********************************/
         // Functions for OPS
         //
 
-        bwt_interval open_OPS() {
+        bwt_interval open_OPS() const {
             return bwt_interval(1, m_n_triples);
         }
 
@@ -474,17 +426,17 @@ namespace ring {
         /**********************************/
         // O->P  (simulates going down in the trie)
         // Returns an interval within m_bwt_s
-        bwt_interval down_O_P(bwt_interval &o_int, uint64_t p) {
+        bwt_interval down_O_P(bwt_interval &o_int, uint64_t p) const {
             auto I = m_bwt_p.backward_step(o_int.left(), o_int.right(), p);
             uint64_t c = m_bwt_s.get_C(p);
             return bwt_interval(I.first + c, I.second + c);
         }
 
-        uint64_t min_S_in_OP(bwt_interval &I) {
+        uint64_t min_S_in_OP(bwt_interval &I) const {
             return I.begin(m_bwt_s);
         }
 
-        uint64_t next_S_in_OP(bwt_interval &I, uint64_t s_value) {
+        uint64_t next_S_in_OP(bwt_interval &I, uint64_t s_value) const {
             if (s_value > m_max_s) return 0;
 
             uint64_t nextv = I.next_value(s_value, m_bwt_s);
@@ -494,15 +446,15 @@ namespace ring {
                 return nextv;
         }
 
-        bool there_are_S_in_OP(bwt_interval &I) {
+        bool there_are_S_in_OP(bwt_interval &I) const {
             return I.get_cur_value() != I.end();
         }
 
-        uint64_t min_S_in_P(bwt_interval &I) {
+        uint64_t min_S_in_P(bwt_interval &I) const {
             return I.begin(m_bwt_s);
         }
 
-        uint64_t next_S_in_P(bwt_interval &I, uint64_t s_value) {
+        uint64_t next_S_in_P(bwt_interval &I, uint64_t s_value) const {
             if (s_value > m_max_s) return 0;
 
             uint64_t nextv = I.next_value(s_value, m_bwt_s);
@@ -512,21 +464,30 @@ namespace ring {
                 return nextv;
         }
 
-        bool there_are_S_in_P(bwt_interval &I) {
+        bool there_are_S_in_P(bwt_interval &I) const {
             return I.get_cur_value() != I.end();
         }
 
         std::vector<uint64_t>
-        all_S_in_range(bwt_interval &I) {
+        all_S_in_range(bwt_interval &I) const {
             return m_bwt_s.values_in_range(I.left(), I.right());
         }
 
+        void all_S_in_range(bwt_interval &I, std::vector<uint64_t> &values) const {
+            m_bwt_s.values_in_range(I.left(), I.right(), values);
+        }
+
+        template<class t_f>
+        void all_S_in_range(bwt_interval &I, t_f f) const {
+            m_bwt_s.values_in_range(I.left(), I.right(), f);
+        }
+
 
         /**********************************/
         // Function for SOP
         //
 
-        bwt_interval open_SOP() {
+        bwt_interval open_SOP() const {
             return bwt_interval(1,  m_n_triples);
         }
 
@@ -535,17 +496,17 @@ namespace ring {
         /**********************************/
         // S->O  (simulates going down in the trie)
         // Returns an interval within m_bwt_p
-        bwt_interval down_S_O(bwt_interval &s_int, uint64_t o) {
+        bwt_interval down_S_O(bwt_interval &s_int, uint64_t o) const {
             pair<uint64_t, uint64_t> I = m_bwt_o.backward_step(s_int.left(), s_int.right(), o);
             uint64_t c = m_bwt_p.get_C(o);
             return bwt_interval(I.first + c, I.second + c);
         }
 
-        uint64_t min_P_in_SO(bwt_interval &I) {
+        uint64_t min_P_in_SO(bwt_interval &I) const {
             return I.begin(m_bwt_p);
         }
 
-        uint64_t next_P_in_SO(bwt_interval &I, uint64_t p_value) {
+        uint64_t next_P_in_SO(bwt_interval &I, uint64_t p_value) const {
             if (p_value > m_max_p) return 0;
 
             uint64_t nextv = I.next_value(p_value, m_bwt_p);
@@ -555,15 +516,15 @@ namespace ring {
                 return nextv;
         }
 
-        bool there_are_P_in_SO(bwt_interval &I) {
+        bool there_are_P_in_SO(bwt_interval &I) const {
             return I.get_cur_value() != I.end();
         }
 
-        uint64_t min_P_in_O(bwt_interval &I) {
+        uint64_t min_P_in_O(bwt_interval &I) const {
             return I.begin(m_bwt_p);
         }
 
-        uint64_t next_P_in_O(bwt_interval &I, uint64_t p_value) {
+        uint64_t next_P_in_O(bwt_interval &I, uint64_t p_value) const {
             if (p_value > m_max_p) return 0;
 
             uint64_t nextv = I.next_value(p_value, m_bwt_p);
@@ -573,34 +534,43 @@ namespace ring {
                 return nextv;
         }
 
-        bool there_are_P_in_O(bwt_interval &I) {
+        bool there_are_P_in_O(bwt_interval &I) const {
             return I.get_cur_value() != I.end();
         }
 
         std::vector<uint64_t>
-        all_P_in_range(bwt_interval &I) {
+        all_P_in_range(bwt_interval &I) const {
             return m_bwt_p.values_in_range(I.left(), I.right());
         }
 
+        void all_P_in_range(bwt_interval &I, std::vector<uint64_t> &values) const {
+            m_bwt_p.values_in_range(I.left(), I.right(), values);
+        }
+
+        template<class t_f>
+        void all_P_in_range(bwt_interval &I, t_f f) const {
+            m_bwt_p.values_in_range(I.left(), I.right(), f);
+        }
+
 
         /**********************************/
         // Functions for SPO
         //
-        bwt_interval open_SPO() {
+        bwt_interval open_SPO() const {
             return bwt_interval(1, m_n_triples);
         }
 
-        uint64_t min_S(bwt_interval &I) {
+        uint64_t min_S(bwt_interval &I) const {
             return I.begin(m_bwt_s);
         }
 
-        uint64_t next_S(bwt_interval &I, uint64_t s_value) {
+        uint64_t next_S(bwt_interval &I, uint64_t s_value) const {
             if (s_value > m_max_s) return 0;
 
             return I.next_value(s_value, m_bwt_s);
         }
 
-        bwt_interval down_S(uint64_t s_value) {
+        bwt_interval down_S(uint64_t s_value) const {
             pair<uint64_t, uint64_t> i = init_S(s_value);
             return bwt_interval(i.first, i.second);
         }
@@ -608,7 +578,7 @@ namespace ring {
 
         // S->P  (simulates going down in the trie, for the order SPO)
         // Returns an interval within m_bwt_p
-        bwt_interval down_S_P(bwt_interval &s_int, uint64_t s_value, uint64_t p_value) {
+        bwt_interval down_S_P(bwt_interval &s_int, uint64_t s_value, uint64_t p_value) const {
             //std::cout << "SPO forward down_S_P" << std::endl;
             //fw_count++;
             std::pair<uint64_t, uint64_t> q = s_int.get_stored_values();
@@ -617,13 +587,13 @@ namespace ring {
                 q = m_bwt_s.select_next(p_value, s_value, m_bwt_o.nElems(s_value));
                 b = m_bwt_s.bsearch_C(q.first) - 1;
             }
-            uint64_t nE = m_bwt_s.rank(b + 1, s_value) - m_bwt_s.rank(b, s_value);
+            uint64_t nE = m_bwt_s.rank_in_range(b, s_value);
             uint64_t start = q.second;
 
             return bwt_interval(s_int.left() + start, s_int.left() + start + nE - 1);
         }
 
-        uint64_t min_P_in_S(bwt_interval &I, uint64_t s_value) {
+        uint64_t min_P_in_S(bwt_interval &I, uint64_t s_value) const {
             std::pair<uint64_t, uint64_t> q;
             //std::cout << "SPO forward min_P_in_S" << std::endl;
             //fw_count++;
@@ -633,7 +603,7 @@ namespace ring {
             return b;
         }
 
-        uint64_t next_P_in_S(bwt_interval &I, uint64_t s_value, uint64_t p_value) {
+        uint64_t next_P_in_S(bwt_interval &I, uint64_t s_value, uint64_t p_value) const {
             //std::cout << "SPO forward next_P_in_S" << std::endl;
             //fw_count++;
             if (p_value > m_max_p) return 0;
@@ -650,11 +620,11 @@ namespace ring {
         }
 
 
-        uint64_t min_O_in_SP(bwt_interval &I) {
+        uint64_t min_O_in_SP(bwt_interval &I) const {
             return I.begin(m_bwt_o);
         }
 
-        uint64_t next_O_in_SP(bwt_interval &I, uint64_t O) {
+        uint64_t next_O_in_SP(bwt_interval &I, uint64_t O) const {
             if (O > m_max_o) return 0;
 
             uint64_t next_v = I.next_value(O, m_bwt_o);
@@ -664,7 +634,7 @@ namespace ring {
                 return next_v;
         }
 
-        bool there_are_O_in_SP(bwt_interval &I) {
+        bool there_are_O_in_SP(bwt_interval &I) const {
             return I.get_cur_value() != I.end();
         }
 
@@ -672,17 +642,17 @@ namespace ring {
         // Functions for POS
         //
 
-        bwt_interval open_POS() {
+        bwt_interval open_POS() const {
             return bwt_interval( 1, m_n_triples);
         }
 
-        uint64_t min_P(bwt_interval &I) {
+        uint64_t min_P(bwt_interval &I) const {
             //bwt_interval I_aux(I.left() - 2 * m_n_triples, I.right() - 2 * m_n_triples);
             //return I_aux.begin(m_bwt_p);
             return I.begin(m_bwt_p);
         }
 
-        uint64_t next_P(bwt_interval &I, uint64_t p_value) {
+        uint64_t next_P(bwt_interval &I, uint64_t p_value) const {
             if (p_value > m_max_p) return 0;
 
             //bwt_interval I_aux(I.left() - 2 * m_n_triples, I.right() - 2 * m_n_triples);
@@ -694,14 +664,14 @@ namespace ring {
                 return nextv;
         }
 
-        bwt_interval down_P(uint64_t p_value) {
+        bwt_interval down_P(uint64_t p_value) const {
             pair<uint64_t, uint64_t> i = init_P(p_value);
             return bwt_interval(i.first, i.second);
         }
 
         // P->O  (simulates going down in the trie, for the order POS)
         // Returns an interval within m_bwt_p
-        bwt_interval down_P_O(bwt_interval &p_int, uint64_t p_value, uint64_t o_value) {
+        bwt_interval down_P_O(bwt_interval &p_int, uint64_t p_value, uint64_t o_value) const {
             //std::cout << "SPO forward down_P_O" << std::endl;
             //fw_count++;
             std::pair<uint64_t, uint64_t> q = p_int.get_stored_values();
@@ -710,13 +680,13 @@ namespace ring {
                 q = m_bwt_p.select_next(o_value, p_value, m_bwt_s.nElems(p_value));
                 b = m_bwt_p.bsearch_C(q.first) - 1;
             }
-            uint64_t nE = m_bwt_p.rank(b + 1, p_value) - m_bwt_p.rank(b, p_value);
+            uint64_t nE = m_bwt_p.rank_in_range(b, p_value);
             uint64_t start = q.second;
 
             return bwt_interval(p_int.left() + start, p_int.left() + start + nE - 1);
         }
 
-        uint64_t min_O_in_P(bwt_interval &p_int, uint64_t p_value) {
+        uint64_t min_O_in_P(bwt_interval &p_int, uint64_t p_value) const {
             //std::cout << "SPO forward min_O_in_P" << std::endl;
             //fw_count++;
             std::pair<uint64_t, uint64_t> q;
@@ -726,7 +696,7 @@ namespace ring {
             return b;
         }
 
-        uint64_t next_O_in_P(bwt_interval &I, uint64_t p_value, uint64_t o_value) {
+        uint64_t next_O_in_P(bwt_interval &I, uint64_t p_value, uint64_t o_value) const {
             //std::cout << "SPO forward next_O_in_P" << std::endl;
             //fw_count++;
             if (o_value > m_max_o) return 0;
@@ -741,13 +711,13 @@ namespace ring {
             return b;
         }
 
-        uint64_t min_S_in_PO(bwt_interval &I) {
+        uint64_t min_S_in_PO(bwt_interval &I) const {
            // bwt_interval I_aux = bwt_interval(I.left() - m_n_triples, I.right() - m_n_triples);
             //return I_aux.begin(m_bwt_s);
             return I.begin(m_bwt_s);
         }
 
-        uint64_t next_S_in_PO(bwt_interval &I, uint64_t s_value) {
+        uint64_t next_S_in_PO(bwt_interval &I, uint64_t s_value) const {
             if (s_value > m_max_s) return 0;
 
             //bwt_interval I_aux = bwt_interval(I.left() - m_n_triples, I.right() - m_n_triples);
@@ -755,7 +725,7 @@ namespace ring {
             return I.next_value(s_value, m_bwt_s);
         }
 
-        bool there_are_S_in_PO(bwt_interval &I) {
+        bool there_are_S_in_PO(bwt_interval &I) const {
             return I.get_cur_value() != I.end();
         }
 
@@ -763,15 +733,15 @@ namespace ring {
         // Functions for OSP
         //
 
-        bwt_interval open_OSP() {
+        bwt_interval open_OSP() const {
             return bwt_interval(1, m_n_triples);
         }
 
-        uint64_t min_O(bwt_interval &I) {
+        uint64_t min_O(bwt_interval &I) const {
             return I.begin(m_bwt_o);
         }
 
-        uint64_t next_O(bwt_interval &I, uint64_t o_value) {
+        uint64_t next_O(bwt_interval &I, uint64_t o_value) const {
             if (o_value > m_max_o) return 0;
 
             uint64_t nextv = I.next_value(o_value, m_bwt_o);
@@ -779,14 +749,14 @@ namespace ring {
             else return nextv;
         }
 
-        bwt_interval down_O(uint64_t o_value) {
+        bwt_interval down_O(uint64_t o_value) const {
             pair<uint64_t, uint64_t> i = init_O(o_value);
             return bwt_interval(i.first, i.second);
         }
 
         // P->O  (simulates going down in the trie, for the order OSP)
         // Returns an interval within m_bwt_p
-        bwt_interval down_O_S(bwt_interval &o_int, uint64_t o_value, uint64_t s_value) {
+        bwt_interval down_O_S(bwt_interval &o_int, uint64_t o_value, uint64_t s_value) const {
             //std::cout << "SPO forward down_O_S" << std::endl;
             //fw_count++;
             std::pair<uint64_t, uint64_t> q = o_int.get_stored_values();
@@ -795,13 +765,13 @@ namespace ring {
                 q = m_bwt_o.select_next(s_value, o_value, m_bwt_p.nElems(o_value));
                 b = m_bwt_o.bsearch_C(q.first) - 1;
             }
-            uint64_t nE = m_bwt_o.rank(b + 1, o_value) - m_bwt_o.rank(b, o_value);
+            uint64_t nE = m_bwt_o.rank_in_range(b, o_value);
             uint64_t start = q.second;
 
             return bwt_interval(o_int.left() + start, o_int.left() + start + nE - 1);
         }
 
-        uint64_t min_S_in_O(bwt_interval &o_int, uint64_t o_value) {
+        uint64_t min_S_in_O(bwt_interval &o_int, uint64_t o_value) const {
             //std::cout << "SPO forward min_S_in_O" << std::endl;
             //fw_count++;
             std::pair<uint64_t, uint64_t> q;
@@ -811,7 +781,7 @@ namespace ring {
             return b;
         }
 
-        uint64_t next_S_in_O(bwt_interval &I, uint64_t o_value, uint64_t s_value) {
+        uint64_t next_S_in_O(bwt_interval &I, uint64_t o_value, uint64_t s_value) const {
             //std::cout << "SPO forward next_S_in_O" << std::endl;
             //fw_count++;
             if (s_value > m_max_s) return 0;
@@ -826,11 +796,11 @@ namespace ring {
             return b;
         }
 
-        uint64_t min_P_in_OS(bwt_interval &I) {
+        uint64_t min_P_in_OS(bwt_interval &I) const {
             return I.begin(m_bwt_p);
         }
 
-        uint64_t next_P_in_OS(bwt_interval &I, uint64_t p_value) {
+        uint64_t next_P_in_OS(bwt_interval &I, uint64_t p_value) const {
             if (p_value > m_max_p) return 0;
 
             uint64_t nextv = I.next_value(p_value, m_bwt_p);
@@ -840,22 +810,22 @@ namespace ring {
                 return nextv;
         }
 
-        bool there_are_P_in_OS(bwt_interval &I) {
+        bool there_are_P_in_OS(bwt_interval &I) const {
             return I.get_cur_value() != I.end();
         }
 
-        bwt_type get_m_bwt_s() const{
+        const bwt_type &get_m_bwt_s() const{
             return m_bwt_s;
         }
 
-        bwt_type get_m_bwt_p() const{
+        const bwt_type &get_m_bwt_p() const{
             return m_bwt_p;
         }
 
-        bwt_type get_m_bwt_o() const{
+        const bwt_type &get_m_bwt_o() const{
             return m_bwt_o;
         }
-        std::vector<uint64_t> get_P_given_S(uint64_t symbol_id){
+        std::vector<uint64_t> get_P_given_S(uint64_t symbol_id) const{
             std::vector<u_int64_t> results;
             //based on ring query debugging. at minimum one needs to call min_P_in_S (1 time) and next_P_in_S (N -1 times).
             auto num_elems = m_bwt_o.nElems(symbol_id);
@@ -879,7 +849,7 @@ namespace ring {
         /*!
         * \returns std::vector<uint64_t>
         */
-        std::vector<uint64_t> get_S_given_O(uint64_t symbol_id){
+        std::vector<uint64_t> get_S_given_O(uint64_t symbol_id) const{
             std::vector<u_int64_t> results;
             //based on ring query debugging. check getPGivenS
             auto num_elems = m_bwt_p.nElems(symbol_id);
@@ -902,7 +872,7 @@ namespace ring {
         /*!
         * \returns std::vector<uint64_t>
         */
-        std::vector<uint64_t> get_O_given_P(uint64_t symbol_id){
+        std::vector<uint64_t> get_O_given_P(uint64_t symbol_id) const{
             std::vector<u_int64_t> results;
             //based on ring query debugging. check getPGivenS
             auto num_elems = m_bwt_s.nElems(symbol_id);
@@ -955,6 +925,8 @@ namespace ring {
     };
 
     typedef ring<bwt<sdsl::rrr_vector<15>>> c_ring;
+    //! Ring whose columns are run-length compressed (experimental: smaller only if the columns have long runs).
+    typedef ring<rl_bwt<>> rl_ring;
 
 }
 
@@ -0,0 +1,471 @@
+/*
+ * rl_bwt.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_RL_BWT_HPP
+#define RING_RL_BWT_HPP
+
+#include "configuration.hpp"
+#include "wavelet_matrix.hpp"
+#include <sdsl/sd_vector.hpp>
+
+namespace ring {
+
+    //! Run-length compressed BWT, with the same interface as bwt.
+    /*!
+    * The columns L of the ring of a sorted graph have long runs of equal symbols, so L is stored as
+    * its r runs (Mäkinen and Navarro's run-length FM-index):
+    *   - m_heads: wavelet matrix of the r run heads.
+    *   - m_runs: marks the first position of every run in L (n bits, sparse).
+    *   - m_lengths: the runs sorted by their symbol (stable), as the first position of every run in
+    *     that order, followed by a final 1 at n. The runs of c start at C_L[c], the number of
+    *     symbols of L smaller than c.
+    * The space is O(r log sigma + r log(n/r)) bits instead of n log sigma. A rank costs a descent of
+    * m_heads for both positions of the run and another one for the number of runs smaller than c.
+    *
+    * The distinct values of a range of L are those of the run heads of its runs, so the value
+    * queries (min_in_range, range_next_value, values_in_range) are solved on m_heads after mapping
+    * the range with heads_range. get_L returns m_heads, so any range used on it must be mapped.
+    */
+    template <class bwt_bit_vector_t = sdsl::bit_vector>
+    class rl_bwt {
+
+    public:
+        typedef uint64_t value_type;
+        typedef uint64_t size_type;
+        typedef sdsl::bit_vector c_type;
+        typedef sdsl::rank_support_v<> c_rank_type;
+        typedef sdsl::select_support_mcl<1> c_select_1_type;
+        typedef sdsl::select_support_mcl<0> c_select_0_type;
+        typedef wavelet_matrix<bwt_bit_vector_t> bwt_type;
+        typedef sdsl::sd_vector<> runs_type;
+        typedef typename runs_type::rank_1_type runs_rank_type;
+        typedef typename runs_type::select_1_type runs_select_type;
+
+    private:
+        size_type m_n = 0;
+        bwt_type m_heads;
+        runs_type m_runs;
+        runs_rank_type m_runs_rank;
+        runs_select_type m_runs_select;
+        runs_type m_lengths;
+        runs_rank_type m_lengths_rank;
+        runs_select_type m_lengths_select;
+        c_type m_C;
+        c_rank_type m_C_rank;
+        c_select_1_type m_C_select1;
+        c_select_0_type m_C_select0;
+
+        void set_supports() {
+            m_runs_rank.set_vector(&m_runs);
+            m_runs_select.set_vector(&m_runs);
+            m_lengths_rank.set_vector(&m_lengths);
+            m_lengths_select.set_vector(&m_lengths);
+            m_C_rank.set_vector(&m_C);
+            m_C_select1.set_vector(&m_C);
+            m_C_select0.set_vector(&m_C);
+        }
+
+        void copy(const rl_bwt &o) {
+            m_n = o.m_n;
+            m_heads = o.m_heads;
+            m_runs = o.m_runs;
+            m_runs_rank = o.m_runs_rank;
+            m_runs_select = o.m_runs_select;
+            m_lengths = o.m_lengths;
+            m_lengths_rank = o.m_lengths_rank;
+            m_lengths_select = o.m_lengths_select;
+            m_C = o.m_C;
+            m_C_rank = o.m_C_rank;
+            m_C_select1 = o.m_C_select1;
+            m_C_select0 = o.m_C_select0;
+            set_supports();
+        }
+
+        //Building C and its rank and select structures
+        template<class t_C>
+        void build_C(const t_C &C) {
+            m_C = c_type(C[C.size() - 1] + 1 + C.size(), 0);
+            for (uint64_t i = 0; i < C.size(); i++) {
+                m_C[C[i] + i] = 1;
+            }
+            sdsl::util::init_support(m_C_rank, &m_C);
+            sdsl::util::init_support(m_C_select1, &m_C);
+            sdsl::util::init_support(m_C_select0, &m_C);
+        }
+
+        //! Builds the runs of L in two sequential passes, so L can be a buffer on disk.
+        /*!
+        * Besides the result, only the r run heads are held in plain form: the sparse bit vectors are
+        * filled with sd_vector_builder in increasing order, m_runs during the second pass and m_lengths
+        * by visiting the runs of every symbol with m_heads and m_runs.
+        */
+        template<class t_L>
+        void build_runs(t_L &L) {
+            m_n = L.size();
+            size_type r = 0;
+            value_type max = 0;
+            for (size_type i = 0, prev = 0; i < m_n; ++i) {
+                const value_type c = L[i];
+                if (i == 0 || c != prev) ++r;
+                if (c > max) max = c;
+                prev = c;
+            }
+            {
+                sdsl::int_vector<> heads(r, 0, max ? sdsl::bits::hi(max) + 1 : 1);
+                sdsl::sd_vector_builder runs(m_n, r);
+                for (size_type i = 0, q = 0, prev = 0; i < m_n; ++i) {
+                    const value_type c = L[i];
+                    if (i == 0 || c != prev) {
+                        runs.set(i);
+                        heads[q++] = c;
+                    }
+                    prev = c;
+                }
+                construct_im(m_heads, heads);
+                m_runs = runs_type(runs);
+            }
+            sdsl::util::init_support(m_runs_rank, &m_runs);
+            sdsl::util::init_support(m_runs_select, &m_runs);
+            // The runs sorted by symbol, each one starting where the previous one ends
+            sdsl::sd_vector_builder lengths(m_n + 1, r + 1);
+            size_type pos = 0;
+            for (value_type c = 0; c <= max; ++c) {
+                const size_type runs_c = m_heads.rank(r, c);
+                for (size_type t = 1; t <= runs_c; ++t) {
+                    lengths.set(pos);
+                    pos += run_length(m_heads.select(t, c));
+                }
+            }
+            lengths.set(m_n);
+            m_lengths = runs_type(lengths);
+            sdsl::util::init_support(m_lengths_rank, &m_lengths);
+            sdsl::util::init_support(m_lengths_select, &m_lengths);
+        }
+
+        //! Length of the run q.
+        inline size_type run_length(const size_type q) const {
+            const size_type end = (q + 1 < m_heads.size()) ? m_runs_select(q + 2) : m_n;
+            return end - m_runs_select(q + 1);
+        }
+
+        //! Index of the run that contains the position i of L.
+        inline size_type run_of(const size_type i) const {
+            return m_runs_rank(i + 1) - 1;
+        }
+
+        //! Number of occurrences of c in [0, i), where 'smaller' is the number of runs with a head smaller than c.
+        inline size_type rank(const size_type i, const value_type c, const size_type smaller) const {
+            if (i == 0) return 0;
+            const size_type q = run_of(i - 1);
+            const auto h = m_heads.rank_pair(q, q + 1, c); // c-runs before the run q, and including it
+            const size_type first = m_lengths_select(smaller + 1);
+            size_type res = m_lengths_select(smaller + h.first + 1) - first;
+            if (h.second > h.first) { // i - 1 is in a run of c
+                res += i - m_runs_select(q + 1);
+            }
+            return res;
+        }
+
+    public:
+
+
+        rl_bwt() = default;
+
+        rl_bwt(const sdsl::int_vector<> &L, const std::vector<uint64_t> &C) {
+            build_runs(L);
+            build_C(C);
+        }
+
+        //! Builds the runs from an L column stored on disk. C is read in order (see C_array).
+        template<class t_C>
+        rl_bwt(sdsl::int_vector_buffer<> &L, const t_C &C) {
+            build_runs(L);
+            build_C(C);
+        }
+
+
+        //! Copy constructor
+        rl_bwt(const rl_bwt &o) {
+            copy(o);
+        }
+
+        //! Move constructor
+        rl_bwt(rl_bwt &&o) {
+            *this = std::move(o);
+        }
+
+        //! Copy Operator=
+        rl_bwt &operator=(const rl_bwt &o) {
+            if (this != &o) {
+                copy(o);
+            }
+            return *this;
+        }
+
+        //! Move Operator=
+        rl_bwt &operator=(rl_bwt &&o) {
+            if (this != &o) {
+                m_n = o.m_n;
+                m_heads = std::move(o.m_heads);
+                m_runs = std::move(o.m_runs);
+                m_runs_rank = std::move(o.m_runs_rank);
+                m_runs_select = std::move(o.m_runs_select);
+                m_lengths = std::move(o.m_lengths);
+                m_lengths_rank = std::move(o.m_lengths_rank);
+                m_lengths_select = std::move(o.m_lengths_select);
+                m_C = std::move(o.m_C);
+                m_C_rank = std::move(o.m_C_rank);
+                m_C_select1 = std::move(o.m_C_select1);
+                m_C_select0 = std::move(o.m_C_select0);
+                set_supports();
+            }
+            return *this;
+        }
+
+        void swap(rl_bwt &o) {
+            std::swap(m_n, o.m_n);
+            std::swap(m_heads, o.m_heads);
+            std::swap(m_runs, o.m_runs);
+            sdsl::util::swap_support(m_runs_rank, o.m_runs_rank, &m_runs, &o.m_runs);
+            sdsl::util::swap_support(m_runs_select, o.m_runs_select, &m_runs, &o.m_runs);
+            std::swap(m_lengths, o.m_lengths);
+            sdsl::util::swap_support(m_lengths_rank, o.m_lengths_rank, &m_lengths, &o.m_lengths);
+            sdsl::util::swap_support(m_lengths_select, o.m_lengths_select, &m_lengths, &o.m_lengths);
+            std::swap(m_C, o.m_C);
+            sdsl::util::swap_support(m_C_rank, o.m_C_rank, &m_C, &o.m_C);
+            sdsl::util::swap_support(m_C_select1, o.m_C_select1, &m_C, &o.m_C);
+            sdsl::util::swap_support(m_C_select0, o.m_C_select0, &m_C, &o.m_C);
+        }
+
+
+        //! Serializes the data structure into the given ostream
+        size_type serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr, std::string name = "") const {
+            sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+            size_type written_bytes = 0;
+            written_bytes += sdsl::write_member(m_n, out, child, "n");
+            written_bytes += m_heads.serialize(out, child, "heads");
+            written_bytes += m_runs.serialize(out, child, "runs");
+            written_bytes += m_runs_rank.serialize(out, child, "runs_rank");
+            written_bytes += m_runs_select.serialize(out, child, "runs_select");
+            written_bytes += m_lengths.serialize(out, child, "lengths");
+            written_bytes += m_lengths_rank.serialize(out, child, "lengths_rank");
+            written_bytes += m_lengths_select.serialize(out, child, "lengths_select");
+            written_bytes += m_C.serialize(out, child, "C");
+            written_bytes += m_C_rank.serialize(out, child, "C_rank");
+            written_bytes += m_C_select1.serialize(out, child, "C_select1");
+            written_bytes += m_C_select0.serialize(out, child, "C_select0");
+            sdsl::structure_tree::add_size(child, written_bytes);
+            return written_bytes;
+        }
+
+        void load(std::istream &in) {
+            sdsl::read_member(m_n, in);
+            m_heads.load(in);
+            m_runs.load(in);
+            m_runs_rank.load(in, &m_runs);
+            m_runs_select.load(in, &m_runs);
+            m_lengths.load(in);
+            m_lengths_rank.load(in, &m_lengths);
+            m_lengths_select.load(in, &m_lengths);
+            m_C.load(in);
+            m_C_rank.load(in, &m_C);
+            m_C_select1.load(in, &m_C);
+            m_C_select0.load(in, &m_C);
+        }
+
+        //Operations
+        inline size_type get_C(const uint64_t v) const {
+            return m_C_select1(v + 1) - v;
+        }
+
+        //! Symbol of the position i of L.
+        inline value_type access(const uint64_t i) const {
+            return m_heads[run_of(i)];
+        }
+
+        inline uint64_t LF(uint64_t i) const {
+            uint64_t s = access(i);
+            return get_C(s) + ranky(i, s) - 1;
+        }
+
+        uint64_t nElems(uint64_t val) const {
+            return get_C(val + 1) - get_C(val);
+        }
+
+        std::pair<uint64_t, uint64_t>
+        backward_step(uint64_t left_end, uint64_t right_end, uint64_t value) const {
+            const size_type smaller = m_heads.count_smaller(value);
+            return {rank(left_end, value, smaller), rank(right_end + 1, value, smaller) - 1};
+        }
+
+        inline uint64_t bsearch_C(uint64_t value) const {
+            return m_C_rank(m_C_select0(value + 1));
+        }
+
+
+        inline uint64_t ranky(uint64_t pos, uint64_t val) const {
+            return rank(pos, val, m_heads.count_smaller(val));
+        }
+
+        inline uint64_t rank(uint64_t pos, uint64_t val) const {
+            return ranky(get_C(pos), val);
+        }
+
+        //! Number of occurrences of val in the range of pos in L, that is rank(pos + 1, val) - rank(pos, val).
+        inline uint64_t rank_in_range(uint64_t pos, uint64_t val) const {
+            const size_type smaller = m_heads.count_smaller(val);
+            return rank(get_C(pos + 1), val, smaller) - rank(get_C(pos), val, smaller);
+        }
+
+        //! Position of the _rank-th (from 1) occurrence of val in L.
+        inline uint64_t select(uint64_t _rank, uint64_t val) const {
+            const size_type smaller = m_heads.count_smaller(val);
+            const size_type f = m_lengths_select(smaller + 1) + _rank - 1; // position in the order of m_lengths
+            const size_type t = m_lengths_rank(f + 1) - 1 - smaller; // c-run that contains it
+            const size_type offset = f - m_lengths_select(smaller + t + 1);
+            return m_runs_select(m_heads.select(t + 1, val) + 1) + offset;
+        }
+
+        //! First occurrence of val from the range of pos on, and the number of occurrences of val before the range.
+        /*!
+        * Returns {0, 0} if there are n_elems or more occurrences of val before the range.
+        */
+        inline std::pair<uint64_t, uint64_t> select_next(uint64_t pos, uint64_t val, uint64_t n_elems) const {
+            const uint64_t r = rank(pos, val);
+            if (r >= n_elems) return {0, 0};
+            return {select(r + 1, val), r};
+        }
+
+        //! Range of m_heads with the runs that overlap [l, r] of L. It is empty if l > r.
+        inline sdsl::range_type heads_range(uint64_t l, uint64_t r) const {
+            if (l > r) return sdsl::range_type{{1, 0}};
+            return sdsl::range_type{{run_of(l), run_of(r)}};
+        }
+
+        inline uint64_t min_in_range(uint64_t l, uint64_t r) const {
+            const auto h = heads_range(l, r);
+            return m_heads.range_minimum_query(h[0], h[1]);
+        }
+
+        inline uint64_t range_next_value(uint64_t x, uint64_t l, uint64_t r) const {
+            const auto h = heads_range(l, r);
+            return m_heads.range_next_value(x, h[0], h[1]);
+        }
+
+        //! range_next_value resuming from the path of the previous call on [l, r] kept in 'cursor'.
+        inline uint64_t range_next_value(uint64_t x, uint64_t l, uint64_t r, wm_range_cursor &cursor) const {
+            const auto h = heads_range(l, r);
+            return m_heads.range_next_value(x, h[0], h[1], cursor);
+        }
+
+        std::vector<uint64_t>
+        values_in_range(uint64_t pos_min, uint64_t pos_max) const {
+            const auto h = heads_range(pos_min, pos_max);
+            return m_heads.all_values_in_range(h[0], h[1]);
+        }
+
+        //! Distinct values in [pos_min, pos_max], written to 'values' reusing its capacity.
+        inline void values_in_range(uint64_t pos_min, uint64_t pos_max, std::vector<uint64_t> &values) const {
+            const auto h = heads_range(pos_min, pos_max);
+            m_heads.all_values_in_range(h[0], h[1], values);
+        }
+
+        //! Calls f(v) for every distinct value v in [pos_min, pos_max], in increasing order.
+        template<class t_f>
+        inline void values_in_range(uint64_t pos_min, uint64_t pos_max, t_f f) const {
+            const auto h = heads_range(pos_min, pos_max);
+            m_heads.for_each_value_in_range(h[0], h[1], f);
+        }
+
+        // backward search for pattern of length 1
+        std::pair<uint64_t, uint64_t> backward_search_1_interval(uint64_t P) const {
+            return {get_C(P), get_C(P + 1) - 1};
+        }
+
+        // backward search for pattern of length 1
+        std::pair<uint64_t, uint64_t> backward_search_1_rank(uint64_t P, uint64_t S) const {
+            const size_type smaller = m_heads.count_smaller(S);
+            return {rank(get_C(P), S, smaller), rank(get_C(P + 1), S, smaller)};
+        }
+
+        // backward search for pattern PQ of length 2
+        // returns an empty interval if search is unsuccessful
+        std::pair<uint64_t, uint64_t>
+        backward_search_2_interval(uint64_t P, std::pair<uint64_t, uint64_t> &I) const {
+            return {get_C(P) + I.first, get_C(P) + I.second - 1};
+        }
+
+        std::pair<uint64_t, uint64_t>
+        backward_search_2_rank(uint64_t P, uint64_t S, std::pair<uint64_t, uint64_t> &I) const {
+            uint64_t c = get_C(P);
+            const size_type smaller = m_heads.count_smaller(S);
+            return {rank(c + I.first, S, smaller), rank(c + I.second, S, smaller)};
+        }
+
+        //! Wavelet matrix of the run heads. A range of L is mapped to it with heads_range.
+        const bwt_type& get_L() const{
+            return m_heads;
+        }
+
+        //! Sequential access to L that decodes one run at a time. L[i] must be read for increasing i.
+        /*!
+        * It is the column from which the CRC arrays are built (see crc), without decoding L in memory.
+        */
+        class column_reader {
+            const rl_bwt *m_bwt;
+            mutable size_type m_run = 0; // next run to decode
+            mutable size_type m_end = 0; // end of the last decoded run
+            mutable value_type m_c = 0;  // its symbol
+        public:
+            typedef rl_bwt::value_type value_type;
+            typedef rl_bwt::size_type size_type;
+
+            explicit column_reader(const rl_bwt &bwt) : m_bwt(&bwt) {}
+
+            size_type size() const {
+                return m_bwt->size();
+            }
+
+            value_type operator[](const size_type i) const {
+                while (i >= m_end) {
+                    m_c = m_bwt->m_heads[m_run];
+                    m_end += m_bwt->run_length(m_run);
+                    ++m_run;
+                }
+                return m_c;
+            }
+        };
+
+        column_reader column() const {
+            return column_reader(*this);
+        }
+
+        //! Length of L.
+        size_type size() const {
+            return m_n;
+        }
+
+        //! Number of runs of L.
+        size_type runs() const {
+            return m_heads.size();
+        }
+    };
+
+}
+
+#endif //RING_RL_BWT_HPP
@@ -22,6 +22,9 @@
 #ifndef RING_TRIPLE_PATTERN_HPP
 #define RING_TRIPLE_PATTERN_HPP
 
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 namespace ring {
 
@@ -79,6 +82,17 @@ namespace ring {
             return term_o.is_variable;
         }
     };
+
+    //! Number of variables of the triple patterns, whose ids are 0, 1, ... in order of appearance.
+    inline uint64_t number_of_variables(const std::vector<triple_pattern> &patterns){
+        uint64_t n = 0;
+        for(const auto &triple : patterns){
+            if(triple.s_is_variable()) n = std::max<uint64_t>(n, triple.term_s.value + 1);
+            if(triple.p_is_variable()) n = std::max<uint64_t>(n, triple.term_p.value + 1);
+            if(triple.o_is_variable()) n = std::max<uint64_t>(n, triple.term_o.value + 1);
+        }
+        return n;
+    }
 }
 
 
@@ -0,0 +1,85 @@
+/*
+ * triple_sort.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_TRIPLE_SORT_HPP
+#define RING_TRIPLE_SORT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace ring {
+
+    //! Radix sorting of 32-bit triples, used to obtain the L columns of the ring without a suffix array.
+    /*!
+     * The L columns of a ring are fully determined by sorting the triples in the three cyclic orders:
+     * given triples (a, b, c), L_c is column c in (a,b,c) order, L_b is column b in (c,a,b) order and
+     * L_a is column a in (b,c,a) order. Since every pass is stable, each order is obtained from the previous
+     * one with a single extra sort: (a,b,c) -stable by c-> (c,a,b) -stable by b-> (b,c,a).
+     */
+    namespace triple_sort {
+
+        const uint64_t radix_bits = 16;
+        const uint64_t radix_size = 1ULL << radix_bits;
+        const uint64_t radix_mask = radix_size - 1;
+
+        //! Stable LSD radix sort of D by its t_component-th term. Values are assumed to be <= max_value.
+        /*!
+        * \param D          Triples to sort, sorted on return.
+        * \param aux        Scratch buffer, resized to D.size().
+        * \param max_value  Maximum value stored in the t_component-th term (bounds the number of passes).
+        */
+        template<uint8_t t_component, class t_triple>
+        void sort_by_component(std::vector<t_triple> &D, std::vector<t_triple> &aux, const uint64_t max_value) {
+            const uint64_t n = D.size();
+            aux.resize(n);
+            std::vector<uint64_t> C(radix_size + 1);
+            for (uint64_t shift = 0; shift < 64 && (shift == 0 || (max_value >> shift) > 0); shift += radix_bits) {
+                std::fill(C.begin(), C.end(), 0);
+                for (const auto &t : D) {
+                    ++C[(((uint64_t) std::get<t_component>(t) >> shift) & radix_mask) + 1];
+                }
+                // Every key shares this digit, the pass would not move anything.
+                bool single_bucket = false;
+                for (uint64_t i = 1; i <= radix_size && !single_bucket; ++i) {
+                    single_bucket = (C[i] == n);
+                }
+                if (single_bucket) continue;
+                for (uint64_t i = 1; i <= radix_size; ++i) {
+                    C[i] += C[i - 1];
+                }
+                for (const auto &t : D) {
+                    aux[C[((uint64_t) std::get<t_component>(t) >> shift) & radix_mask]++] = t;
+                }
+                D.swap(aux);
+            }
+        }
+
+        //! Sorts the triples lexicographically, i.e. in (a, b, c) order.
+        template<class t_triple>
+        void sort_lexicographic(std::vector<t_triple> &D, std::vector<t_triple> &aux,
+                                const uint64_t max_a, const uint64_t max_b, const uint64_t max_c) {
+            sort_by_component<2>(D, aux, max_c);
+            sort_by_component<1>(D, aux, max_b);
+            sort_by_component<0>(D, aux, max_a);
+        }
+    }
+}
+
+#endif //RING_TRIPLE_SORT_HPP
@@ -0,0 +1,218 @@
+/*
+ * triple_stats.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_TRIPLE_STATS_HPP
+#define RING_TRIPLE_STATS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include "parallel.hpp"
+
+namespace ring {
+
+    //! Alphabet of one component of the triples and number of occurrences of each of its symbols.
+    class symbol_counts {
+    public:
+        std::vector<uint64_t> values; // distinct symbols, in increasing order
+        std::vector<uint64_t> freq;   // occurrences of values[i]
+
+        //! Greatest symbol, 0 if there are no triples.
+        uint64_t max() const { return values.empty() ? 0 : values.back(); }
+
+        //! Number of distinct symbols.
+        uint64_t sigma() const { return values.size(); }
+
+        //! C array of the column preceded by this component in the ring, over the symbols 1..alphabet.
+        /*!
+        * \param alphabet : greatest symbol of the C array.
+        * \param n        : number of triples.
+        * \returns {0, 1, 1 + f(1), 1 + f(1) + f(2), ..., n + 1}
+        */
+        std::vector<uint64_t> C(const uint64_t alphabet, const uint64_t n) const {
+            std::vector<uint64_t> C;
+            C.reserve(alphabet + 2);
+            uint64_t cur_pos = 1, k = 0;
+            C.push_back(0); // Dummy value
+            C.push_back(cur_pos);
+            for (uint64_t c = 2; c <= alphabet; c++) {
+                if (k < values.size() && values[k] == c - 1) {
+                    cur_pos += freq[k++];
+                }
+                C.push_back(cur_pos);
+            }
+            C.push_back(n + 1);
+            return C;
+        }
+
+        //! Adds the occurrences of 'o' to these counts.
+        void add(const symbol_counts &o) {
+            symbol_counts sum;
+            sum.values.reserve(values.size() + o.values.size());
+            sum.freq.reserve(values.size() + o.values.size());
+            uint64_t i = 0, j = 0;
+            while (i < values.size() || j < o.values.size()) {
+                if (j == o.values.size() || (i < values.size() && values[i] < o.values[j])) {
+                    sum.values.push_back(values[i]);
+                    sum.freq.push_back(freq[i++]);
+                } else if (i == values.size() || o.values[j] < values[i]) {
+                    sum.values.push_back(o.values[j]);
+                    sum.freq.push_back(o.freq[j++]);
+                } else {
+                    sum.values.push_back(values[i]);
+                    sum.freq.push_back(freq[i++] + o.freq[j++]);
+                }
+            }
+            sum.values.shrink_to_fit();
+            sum.freq.shrink_to_fit();
+            *this = std::move(sum);
+        }
+
+        //! Counts of the symbols of a sorted sequence.
+        template<class t_symbols>
+        static symbol_counts from_sorted(const t_symbols &symbols) {
+            symbol_counts result;
+            for (uint64_t i = 0; i < symbols.size(); ++i) {
+                if (i == 0 || symbols[i] != symbols[i - 1]) {
+                    result.values.push_back(symbols[i]);
+                    result.freq.push_back(0);
+                }
+                ++result.freq.back();
+            }
+            return result;
+        }
+    };
+
+    //! C array of a column (see symbol_counts::C) computed from the counts of its symbols, without storing its entries.
+    /*!
+    * An entry is obtained in constant time when the entries are read in increasing order, as the BWTs build
+    * their C bitmap, so a sparse alphabet costs O(sigma) words instead of alphabet + 2. It is not thread-safe.
+    */
+    class C_array {
+    private:
+        const symbol_counts *m_counts;
+        uint64_t m_alphabet;
+        uint64_t m_n;
+        mutable uint64_t m_c = 1;   // last symbol read
+        mutable uint64_t m_pos = 1; // its entry
+        mutable uint64_t m_k = 0;   // first value of the counts not below m_c
+
+    public:
+        C_array(const symbol_counts &counts, const uint64_t alphabet, const uint64_t n)
+                : m_counts(&counts), m_alphabet(alphabet), m_n(n) {}
+
+        uint64_t size() const { return m_alphabet + 2; }
+
+        uint64_t operator[](const uint64_t i) const {
+            if (i == 0) return 0; // Dummy value
+            if (i == size() - 1) return m_n + 1;
+            if (i < m_c) {
+                m_c = 1;
+                m_pos = 1;
+                m_k = 0;
+            }
+            const auto &values = m_counts->values;
+            for (; m_c < i; ++m_c) {
+                while (m_k < values.size() && values[m_k] < m_c) ++m_k;
+                if (m_k < values.size() && values[m_k] == m_c) m_pos += m_counts->freq[m_k++];
+            }
+            return m_pos;
+        }
+    };
+
+    //! Counts the symbols of the t_component-th term of the triples.
+    /*!
+    * When the symbols are dense (max <= 2n) the threads count slices of D in a single array of max + 1 atomic
+    * counters, and then collect the symbols of a range of it each. Otherwise the symbols are sorted, so memory
+    * stays proportional to n.
+    * \param D       : triples.
+    * \param threads : maximum number of threads.
+    */
+    template<uint8_t t_component, class t_triple>
+    symbol_counts count_symbols(const std::vector<t_triple> &D, uint64_t threads = 1) {
+        const uint64_t n = D.size();
+        symbol_counts result;
+        if (n == 0) return result;
+        threads = std::max<uint64_t>(1, std::min<uint64_t>(threads, n));
+        const uint64_t slice = (n + threads - 1) / threads;
+
+        std::vector<uint64_t> max(threads, 0);
+        std::vector<parallel::task_type> tasks;
+        for (uint64_t t = 0; t < threads; ++t) {
+            tasks.push_back([&, t]() {
+                for (uint64_t i = t * slice; i < std::min(n, (t + 1) * slice); ++i) {
+                    max[t] = std::max<uint64_t>(max[t], std::get<t_component>(D[i]));
+                }
+            });
+        }
+        parallel::run_tasks(tasks, threads);
+        const uint64_t max_value = *std::max_element(max.begin(), max.end());
+
+        if (max_value <= 2 * n) {
+            // A single array of counters shared by the threads, whose values are then collected by ranges.
+            std::unique_ptr<std::atomic<uint64_t>[]> count(new std::atomic<uint64_t>[max_value + 1]());
+            tasks.clear();
+            for (uint64_t t = 0; t < threads; ++t) {
+                tasks.push_back([&, t]() {
+                    for (uint64_t i = t * slice; i < std::min(n, (t + 1) * slice); ++i) {
+                        auto &c = count[std::get<t_component>(D[i])];
+                        if (threads > 1) {
+                            c.fetch_add(1, std::memory_order_relaxed);
+                        } else {
+                            c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                        }
+                    }
+                });
+            }
+            parallel::run_tasks(tasks, threads);
+            const uint64_t range = (max_value + threads) / threads;
+            std::vector<symbol_counts> parts(threads);
+            tasks.clear();
+            for (uint64_t t = 0; t < threads; ++t) {
+                tasks.push_back([&, t]() {
+                    for (uint64_t v = t * range; v < std::min(max_value + 1, (t + 1) * range); ++v) {
+                        const uint64_t f = count[v].load(std::memory_order_relaxed);
+                        if (f > 0) {
+                            parts[t].values.push_back(v);
+                            parts[t].freq.push_back(f);
+                        }
+                    }
+                });
+            }
+            parallel::run_tasks(tasks, threads);
+            count.reset();
+            for (const auto &part : parts) {
+                result.values.insert(result.values.end(), part.values.begin(), part.values.end());
+                result.freq.insert(result.freq.end(), part.freq.begin(), part.freq.end());
+            }
+        } else {
+            std::vector<uint32_t> symbols(n);
+            for (uint64_t i = 0; i < n; ++i) symbols[i] = std::get<t_component>(D[i]);
+            std::sort(symbols.begin(), symbols.end());
+            result = symbol_counts::from_sorted(symbols);
+        }
+        result.values.shrink_to_fit();
+        result.freq.shrink_to_fit();
+        return result;
+    }
+}
+
+#endif //RING_TRIPLE_STATS_HPP
@@ -46,6 +46,7 @@ namespace ring {
                 bool m_adaptive;
                 bool m_leap;
                 bool m_reverse_index;
+                bool m_mapped_read;
                 const size_type m_threshold;
                 execution_mode get_execution_mode(std::string &mode){
                     execution_mode ex_mode = execution_mode::sigmod21;
@@ -87,6 +88,7 @@ namespace ring {
                 m_adaptive(false),
                 m_threshold(1),
                 m_reverse_index(false),
+                m_mapped_read(false),
                 m_leap(false){
                     mode_enum_to_str = {
                                         {execution_mode::sigmod21, "sigmod21"},
@@ -139,6 +141,13 @@ namespace ring {
                 bool uses_leap() const{
                     return m_leap;
                 }
+                //! The index files are read through a memory mapping, but their structures are still copied into the heap.
+                bool uses_mapped_read() const{
+                    return m_mapped_read;
+                }
+                void set_load_mode(const std::string &load_mode){
+                    m_mapped_read = (load_mode == "mapped-read");
+                }
                 void print_configuration() {//It cannot be declared as 'const' because 'get_mode_label' function uses 'm_mode' member, which is not const as well.
                     if(m_verbose){
                         std::cout << "Configuration" << std::endl << "=============" << std::endl;
@@ -148,6 +157,7 @@ namespace ring {
                         std::cout << "Adaptive gao : " << (m_adaptive ? "true" : "false") << std::endl;
                         std::cout << "Uses Muthu : " << (m_muthu ? "true" : "false") << std::endl;
                         std::cout << "Uses Reverse Index: " << (m_reverse_index ? "true" : "false") << std::endl;
+                        std::cout << "Load mode: " << (m_mapped_read ? "mapped-read" : "file") << std::endl;
                     }
                 }
                 void configure(std::string &mode, bool print_gao, bool verbose){
@@ -176,7 +186,7 @@ namespace ring {
                     }
                 }
                 std::string get_configuration_options() const{
-                    return "[execution_mode="+get_mode_options()+" default="+get_default_mode()+"] [print_gao=0|1 default=0] [verbose=0|1 (default) ] [number_of_results=1000 (default)] [timeout=600 (default)]";
+                    return "[execution_mode="+get_mode_options()+" default="+get_default_mode()+"] [print_gao=0|1 default=0] [verbose=0|1 (default) ] [number_of_results=1000 (default)] [timeout=600 (default)] [load=file|mapped-read default=file]";
                 }
         };
         static configuration configuration;
@@ -204,7 +214,7 @@ namespace ring {
         //TODO: Decouple crc_arrays from the ring, maybe? So ptr_ring won't have the responsibility of doing get_number_distinct_values_spo_BWT_S...
         //TODO: refactor to simplify it. See the other get_num_diff_values.
         template<class ring_type = ring<>,class Iterator>
-        std::unordered_map<size_type, size_type> get_num_diff_values(ring_type* ptr_ring, const triple_pattern& triple_pattern, const Iterator &iter) {
+        std::unordered_map<size_type, size_type> get_num_diff_values(const ring_type* ptr_ring, const triple_pattern& triple_pattern, const Iterator &iter) {
             std::unordered_map<size_type, size_type> hash_map;
             size_type num_distinct_values_s = 0;
             size_type num_distinct_values_p = 0;
@@ -324,7 +334,7 @@ namespace ring {
             return hash_map;
         }
         template<class ring_type = ring<>,class Iterator>
-        size_type get_num_diff_values(var_type candidate_var, ring_type* ptr_ring, const Iterator &iter){
+        size_type get_num_diff_values(var_type candidate_var, const ring_type* ptr_ring, const Iterator &iter){
             //'candidate_var' is related to 'last_var' in current iter ( check iter.m_ptr_triple_pattern)
             //Important: a range in i_* is equivalent for both SPO and SOP rings.
             //-1ULL = Max ULL value.
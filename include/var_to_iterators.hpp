@@ -0,0 +1,103 @@
+/*
+ * var_to_iterators.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_VAR_TO_ITERATORS_HPP
+#define RING_VAR_TO_ITERATORS_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace ring {
+
+    //! Iterators of the triple patterns of each variable, indexed by variable id.
+    /*!
+    * The variables of a query have dense ids (see query_parser::get_variable), so the lists are
+    * stored one after the other in a single array, the list of the variable v being
+    * [m_offsets[v], m_offsets[v+1]). Looking up a variable is an access to m_offsets.
+    */
+    template<class iter_t>
+    class var_to_iterators {
+    public:
+        typedef uint64_t size_type;
+        typedef iter_t iter_type;
+
+        //! Iterators of a variable, which are stored by var_to_iterators.
+        class list_type {
+        private:
+            iter_type *const *m_begin = nullptr;
+            iter_type *const *m_end = nullptr;
+
+        public:
+            list_type() = default;
+
+            list_type(iter_type *const *begin, iter_type *const *end) : m_begin(begin), m_end(end) {}
+
+            inline iter_type *const *begin() const { return m_begin; }
+
+            inline iter_type *const *end() const { return m_end; }
+
+            inline size_type size() const { return m_end - m_begin; }
+
+            inline bool empty() const { return m_begin == m_end; }
+
+            inline iter_type *operator[](const size_type i) const { return m_begin[i]; }
+        };
+
+    private:
+        std::vector<iter_type *> m_iterators;
+        std::vector<uint32_t> m_offsets = {0};
+
+    public:
+        var_to_iterators() = default;
+
+        //! Adds an iterator to the list of 'var', after the ones already added.
+        /*!
+        * The lists are built once by the constructor of the algorithm, so the cost of moving the
+        * following lists does not matter.
+        */
+        void add(const size_type var, iter_type *iter) {
+            if (var + 1 >= m_offsets.size()) {
+                m_offsets.resize(var + 2, m_offsets.back());
+            }
+            m_iterators.insert(m_iterators.begin() + m_offsets[var + 1], iter);
+            for (size_type v = var + 1; v < m_offsets.size(); ++v) {
+                ++m_offsets[v];
+            }
+        }
+
+        //! Makes the pointers to the iterators of 'from' point to the same positions of 'to' (after a copy).
+        void rebase(const iter_type *from, iter_type *to) {
+            for (iter_type *&iter : m_iterators) {
+                iter = to + (iter - from);
+            }
+        }
+
+        //! Number of variable ids, which is the largest one plus one.
+        inline size_type size() const {
+            return m_offsets.size() - 1;
+        }
+
+        //! Iterators of 'var', which are empty if it is not a variable of the query.
+        inline list_type operator[](const size_type var) const {
+            if (var >= size()) return list_type();
+            return list_type(m_iterators.data() + m_offsets[var], m_iterators.data() + m_offsets[var + 1]);
+        }
+    };
+}
+
+#endif //RING_VAR_TO_ITERATORS_HPP
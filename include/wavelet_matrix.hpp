@@ -0,0 +1,336 @@
+/*
+ * wavelet_matrix.hpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_WAVELET_MATRIX_HPP
+#define RING_WAVELET_MATRIX_HPP
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <sdsl/wavelet_trees.hpp>
+
+namespace ring {
+
+    //! Path of the last answer of range_next_value on a range of a wavelet matrix.
+    /*!
+    * It keeps the range of the node of every level on the path to the last answer, so the next call
+    * on the same range starts from the deepest node that is also an ancestor of the new value,
+    * instead of the root. Successive calls with increasing values traverse the matrix in order,
+    * visiting each node of the path once. It is valid for a single range and matrix, and it resets
+    * itself if it is used with another one.
+    */
+    class wm_range_cursor {
+    public:
+        typedef uint64_t size_type;
+        typedef uint64_t value_type;
+
+        static const uint32_t max_levels = 32;
+
+    private:
+        template<class t_bitvector> friend class wavelet_matrix;
+
+        const void *m_owner = nullptr;
+        size_type m_l = 0;
+        size_type m_r = 0;
+        bool m_found = false; // m_value and the path are valid
+        value_type m_value = 0;
+        uint32_t m_levels = 0;
+        size_type m_s[max_levels + 1]; // node of the level k: [m_s[k], m_e[k])
+        size_type m_e[max_levels + 1];
+
+        void copy(const wm_range_cursor &o) {
+            m_owner = o.m_owner;
+            m_l = o.m_l;
+            m_r = o.m_r;
+            m_found = o.m_found;
+            m_value = o.m_value;
+            m_levels = o.m_levels;
+            if (m_owner != nullptr) {
+                // Only the levels in use, the rest is never read.
+                const uint32_t n = m_found ? m_levels + 1 : 1;
+                std::copy(o.m_s, o.m_s + n, m_s);
+                std::copy(o.m_e, o.m_e + n, m_e);
+            }
+        }
+
+    public:
+        wm_range_cursor() = default;
+
+        //! Copy constructor
+        wm_range_cursor(const wm_range_cursor &o) {
+            copy(o);
+        }
+
+        //! Copy Operator=
+        wm_range_cursor &operator=(const wm_range_cursor &o) {
+            if (this != &o) {
+                copy(o);
+            }
+            return *this;
+        }
+
+        //! Forgets the path, so the next call starts from the root.
+        inline void reset() {
+            m_owner = nullptr;
+        }
+    };
+
+    //! Wavelet matrix of the BWTs: sdsl::wm_int with the operations of the backward search fused.
+    /*!
+    * It adds no data to sdsl::wm_int, so both are serialized in the same way and a reference to the
+    * wavelet matrix of a BWT can be used where a sdsl::wm_int is expected.
+    */
+    template<class t_bitvector = sdsl::bit_vector>
+    class wavelet_matrix : public sdsl::wm_int<t_bitvector> {
+
+    public:
+        typedef sdsl::wm_int<t_bitvector> base_type;
+        typedef typename base_type::size_type size_type;
+        typedef typename base_type::value_type value_type;
+
+        using sdsl::wm_int<t_bitvector>::wm_int;
+        using sdsl::wm_int<t_bitvector>::range_next_value;
+        using sdsl::wm_int<t_bitvector>::all_values_in_range;
+
+        wavelet_matrix() = default;
+
+        //! Number of occurrences of c in [0, i) and in [0, j).
+        /*!
+        * Equivalent to {rank(i, c), rank(j, c)}, but the levels are descended once: the node of c in
+        * every level does not depend on the position, so its rank is computed once for both positions,
+        * which are usually close and share the memory loads of the rank support.
+        */
+        std::pair<size_type, size_type> rank_pair(size_type i, size_type j, const value_type c) const {
+            if (((1ULL) << (this->m_max_level)) <= c) { // c is greater than any symbol in the matrix
+                return {0, 0};
+            }
+            size_type b = 0; // start of the node of c in the level k
+            uint64_t mask = (1ULL) << (this->m_max_level - 1);
+            for (uint32_t k = 0; k < this->m_max_level && (i | j); ++k) {
+                const size_type rank_b = this->m_tree_rank(b);
+                const size_type ones_i = this->m_tree_rank(b + i) - rank_b; // ones in [b..b+i)
+                const size_type ones_j = (j == i) ? ones_i : this->m_tree_rank(b + j) - rank_b;
+                const size_type ones_p = rank_b - this->m_rank_level[k]; // ones in [level_b..b)
+                if (c & mask) {
+                    i = ones_i;
+                    j = ones_j;
+                    b = (k + 1) * this->m_size + this->m_zero_cnt[k] + ones_p;
+                } else {
+                    i = i - ones_i;
+                    j = j - ones_j;
+                    b = (k + 1) * this->m_size + (b - k * this->m_size) - ones_p;
+                }
+                mask >>= 1;
+            }
+            return {i, j};
+        }
+
+        //! Number of symbols smaller than c in the whole matrix.
+        size_type count_smaller(const value_type c) const {
+            if (((1ULL) << (this->m_max_level)) <= c) {
+                return this->m_size;
+            }
+            size_type smaller = 0;
+            size_type b = 0; // start of the node of c in the level k
+            size_type i = this->m_size; // size of the node of c in the level k
+            uint64_t mask = (1ULL) << (this->m_max_level - 1);
+            for (uint32_t k = 0; k < this->m_max_level && i; ++k) {
+                const size_type rank_b = this->m_tree_rank(b);
+                const size_type ones_i = this->m_tree_rank(b + i) - rank_b;
+                const size_type ones_p = rank_b - this->m_rank_level[k];
+                if (c & mask) {
+                    smaller += i - ones_i;
+                    i = ones_i;
+                    b = (k + 1) * this->m_size + this->m_zero_cnt[k] + ones_p;
+                } else {
+                    i = i - ones_i;
+                    b = (k + 1) * this->m_size + (b - k * this->m_size) - ones_p;
+                }
+                mask >>= 1;
+            }
+            return smaller;
+        }
+
+    private:
+        //! Children of the node [s, e) of the level k: [zs, ze) with bit 0 and [os, oe) with bit 1.
+        inline void children(const uint32_t k, const size_type s, const size_type e, size_type &zs, size_type &ze,
+                             size_type &os, size_type &oe) const {
+            const size_type ones_s = this->m_tree_rank(s) - this->m_rank_level[k];
+            const size_type ones_e = this->m_tree_rank(e) - this->m_rank_level[k];
+            const size_type next = (k + 1) * this->m_size;
+            zs = next + (s - k * this->m_size) - ones_s;
+            ze = next + (e - k * this->m_size) - ones_e;
+            os = next + this->m_zero_cnt[k] + ones_s;
+            oe = next + this->m_zero_cnt[k] + ones_e;
+        }
+
+        //! Descends from the node of the level k of the cursor to its smallest value, whose first k bits are 'prefix'.
+        value_type min_below(wm_range_cursor &cursor, uint32_t k, value_type prefix) const {
+            size_type zs, ze, os, oe;
+            for (; k < this->m_max_level; ++k) {
+                children(k, cursor.m_s[k], cursor.m_e[k], zs, ze, os, oe);
+                prefix <<= 1;
+                if (zs < ze) {
+                    cursor.m_s[k + 1] = zs;
+                    cursor.m_e[k + 1] = ze;
+                } else {
+                    cursor.m_s[k + 1] = os;
+                    cursor.m_e[k + 1] = oe;
+                    prefix |= 1;
+                }
+            }
+            cursor.m_found = true;
+            cursor.m_value = prefix;
+            return prefix;
+        }
+
+    public:
+        //! Smallest value greater than or equal to x in [l, r], or 0 if there is none. It resumes from 'cursor'.
+        /*!
+        * Equivalent to range_next_value(x, l, r). The descent starts at the deepest node of the path of
+        * the previous answer that is a prefix of x, and the path of the new answer is left in the cursor.
+        */
+        value_type range_next_value(const value_type x, const size_type l, const size_type r,
+                                    wm_range_cursor &cursor) const {
+            const uint32_t levels = this->m_max_level;
+            if (levels > wm_range_cursor::max_levels) return range_next_value(x, l, r);
+            if (l > r || (x >> levels) != 0) return 0;
+            if (cursor.m_owner != this || cursor.m_l != l || cursor.m_r != r) {
+                cursor.m_owner = this;
+                cursor.m_l = l;
+                cursor.m_r = r;
+                cursor.m_found = false;
+                cursor.m_levels = levels;
+                cursor.m_s[0] = l;
+                cursor.m_e[0] = r + 1;
+            }
+            // Deepest node of the previous path that is an ancestor of x: the common prefix of both values.
+            uint32_t k = 0;
+            if (cursor.m_found) {
+                if (cursor.m_value == x) return x;
+                k = levels - (64 - __builtin_clzll(cursor.m_value ^ x));
+            }
+            cursor.m_found = false;
+            const uint32_t start = k;
+            // Deepest level where x has a 0 and the node has a child with a 1, the next subtree after x.
+            uint32_t next_k = levels;
+            size_type next_s = 0, next_e = 0;
+            size_type zs, ze, os, oe;
+            for (; k < levels; ++k) {
+                children(k, cursor.m_s[k], cursor.m_e[k], zs, ze, os, oe);
+                if ((x >> (levels - 1 - k)) & 1ULL) {
+                    if (os == oe) break;
+                    cursor.m_s[k + 1] = os;
+                    cursor.m_e[k + 1] = oe;
+                } else {
+                    if (os < oe) {
+                        next_k = k;
+                        next_s = os;
+                        next_e = oe;
+                    }
+                    if (zs == ze) break;
+                    cursor.m_s[k + 1] = zs;
+                    cursor.m_e[k + 1] = ze;
+                }
+            }
+            if (k == levels) { // x is in the range
+                cursor.m_found = true;
+                cursor.m_value = x;
+                return x;
+            }
+            if (next_k == levels) {
+                // The next subtree is not below the node where the descent started, but next to one of its ancestors.
+                // Their path took the child with a 0, so the child with a 1 follows from both nodes without ranks.
+                for (k = start; k-- > 0;) {
+                    if ((x >> (levels - 1 - k)) & 1ULL) continue;
+                    const size_type next = (k + 1) * this->m_size;
+                    os = next + this->m_zero_cnt[k] + (cursor.m_s[k] - k * this->m_size) - (cursor.m_s[k + 1] - next);
+                    oe = next + this->m_zero_cnt[k] + (cursor.m_e[k] - k * this->m_size) - (cursor.m_e[k + 1] - next);
+                    if (os < oe) {
+                        next_k = k;
+                        next_s = os;
+                        next_e = oe;
+                        break;
+                    }
+                }
+                if (next_k == levels) return 0;
+            }
+            cursor.m_s[next_k + 1] = next_s;
+            cursor.m_e[next_k + 1] = next_e;
+            return min_below(cursor, next_k + 1, ((x >> (levels - 1 - next_k)) | 1ULL));
+        }
+
+        //! Calls f(v) for every distinct value v in [l, r], in increasing order.
+        /*!
+        * A depth-first traversal with its stack in fixed arrays (there is at most one pending node per
+        * level), so it does not allocate.
+        */
+        template<class t_f>
+        void for_each_value_in_range(const size_type l, const size_type r, t_f f) const {
+            if (l > r) return;
+            const uint32_t levels = this->m_max_level;
+            size_type stack_s[65], stack_e[65];
+            value_type stack_v[65];
+            uint32_t stack_k[65];
+            uint32_t top = 0;
+            stack_s[0] = l;
+            stack_e[0] = r + 1;
+            stack_v[0] = 0;
+            stack_k[0] = 0;
+            ++top;
+            size_type zs, ze, os, oe;
+            while (top > 0) {
+                --top;
+                size_type s = stack_s[top], e = stack_e[top];
+                value_type v = stack_v[top];
+                for (uint32_t k = stack_k[top]; k < levels; ++k) {
+                    children(k, s, e, zs, ze, os, oe);
+                    if (os < oe) {
+                        if (zs < ze) { // the child with a 1 waits until the values of the other one are reported
+                            stack_s[top] = os;
+                            stack_e[top] = oe;
+                            stack_v[top] = (v << 1) | 1ULL;
+                            stack_k[top] = k + 1;
+                            ++top;
+                        } else {
+                            s = os;
+                            e = oe;
+                            v = (v << 1) | 1ULL;
+                            continue;
+                        }
+                    }
+                    s = zs;
+                    e = ze;
+                    v <<= 1;
+                }
+                f(v);
+            }
+        }
+
+        //! Distinct values in [l, r], in increasing order, written to 'values' (which is cleared first).
+        /*!
+        * Equivalent to all_values_in_range(l, r), but it reuses the capacity of 'values'.
+        */
+        void all_values_in_range(const size_type l, const size_type r, std::vector<value_type> &values) const {
+            values.clear();
+            for_each_value_in_range(l, r, [&values](const value_type v) { values.push_back(v); });
+        }
+    };
+}
+
+#endif //RING_WAVELET_MATRIX_HPP
@@ -0,0 +1,86 @@
+"""Load generator for query-server: replays a query file over several concurrent connections
+and reports the throughput and latency percentiles."""
+import argparse
+import os
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from ring_client import RingClient
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    k = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[k]
+
+
+def worker(socket_path, queries, offset, args, deadline, latencies, counters, lock):
+    client = RingClient(socket_path)
+    local_latencies = []
+    results = errors = 0
+    i = offset
+    try:
+        while (args.Requests and len(local_latencies) + errors < args.Requests) or \
+                (not args.Requests and time.time() < deadline):
+            query = queries[i % len(queries)]
+            i += 1
+            start = time.time()
+            try:
+                _, _, count, _, _ = client.query(query, args.Results, args.Timeout, on_row=lambda row: None)
+                results += count
+                local_latencies.append(time.time() - start)
+            except RuntimeError:
+                errors += 1
+    finally:
+        client.close()
+    with lock:
+        latencies.extend(local_latencies)
+        counters["results"] += results
+        counters["errors"] += errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measures the throughput of query-server.")
+    parser.add_argument("-s", "--Socket", help="Socket of query-server.", required=True)
+    parser.add_argument("-q", "--Queries", help="Queries file.", required=True)
+    parser.add_argument("-c", "--Clients", type=int, default=4, help="Concurrent connections (default 4).")
+    parser.add_argument("-n", "--Requests", type=int, default=0, help="Requests per connection (default: use --Duration).")
+    parser.add_argument("-d", "--Duration", type=float, default=10.0, help="Seconds of load (default 10).")
+    parser.add_argument("-r", "--Results", type=int, help="Number of results.")
+    parser.add_argument("-t", "--Timeout", type=int, help="Query timeout (seconds).")
+    args = parser.parse_args()
+
+    with open(args.Queries) as f:
+        queries = [q.strip() for q in f if q.strip()]
+    if not queries:
+        sys.exit("No queries in " + args.Queries)
+
+    latencies = []
+    counters = {"results": 0, "errors": 0}
+    lock = threading.Lock()
+    start = time.time()
+    deadline = start + args.Duration
+    threads = [threading.Thread(target=worker,
+                                args=(args.Socket, queries, c * len(queries) // args.Clients, args, deadline,
+                                      latencies, counters, lock))
+               for c in range(args.Clients)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.time() - start
+
+    print("Clients: %d" % args.Clients)
+    print("Queries answered: %d (%d errors) in %.3f seconds" % (len(latencies), counters["errors"], elapsed))
+    print("Throughput: %.2f queries/s, %.2f results/s" % (len(latencies) / elapsed, counters["results"] / elapsed))
+    print("Latency (ms): p50 %.3f p95 %.3f p99 %.3f max %.3f" % (
+        percentile(latencies, 50) * 1000, percentile(latencies, 95) * 1000,
+        percentile(latencies, 99) * 1000, max(latencies or [0]) * 1000))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,87 @@
+"""Client of query-server: sends queries to its Unix domain socket and prints the answers."""
+import argparse
+import socket
+import sys
+
+
+class RingClient:
+    """Connection to a query-server socket. One request is answered at a time."""
+
+    def __init__(self, socket_path):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(socket_path)
+        self.reader = self.sock.makefile("r")
+        self.writer = self.sock.makefile("w")
+
+    def close(self):
+        try:
+            self.writer.write("quit\n")
+            self.writer.flush()
+        except OSError:
+            pass
+        self.sock.close()
+
+    def query(self, query, limit=None, timeout=None, on_row=None):
+        """Sends a query and reads its answer.
+
+        on_row is called with every result line (a list of values) as it arrives; when it is None
+        the rows are returned. Returns (variables, rows, number_of_results, nanoseconds, gao).
+        Raises RuntimeError if the server rejects the query.
+        """
+        request = ""
+        if limit is not None:
+            request += "limit=%d " % limit
+        if timeout is not None:
+            request += "timeout=%d " % timeout
+        self.writer.write(request + query.strip() + "\n")
+        self.writer.flush()
+        header = self.reader.readline()
+        if not header:
+            raise RuntimeError("Connection closed by the server")
+        if header.startswith("ERROR"):
+            raise RuntimeError(header[6:].strip())
+        variables = header.split()[1:]
+        rows = []
+        for line in self.reader:
+            if line.startswith("END"):
+                fields = line.split(" ", 3)
+                gao = fields[3].strip() if len(fields) > 3 else ""
+                return variables, rows, int(fields[1]), int(fields[2]), gao
+            row = line.split()
+            if on_row is None:
+                rows.append(row)
+            else:
+                on_row(row)
+        raise RuntimeError("Connection closed by the server")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Sends queries to query-server.")
+    parser.add_argument("-s", "--Socket", help="Socket of query-server.", required=True)
+    parser.add_argument("-q", "--Queries", help="Queries file (default: stdin).")
+    parser.add_argument("-r", "--Results", type=int, help="Number of results.")
+    parser.add_argument("-t", "--Timeout", type=int, help="Query timeout (seconds).")
+    parser.add_argument("-c", "--CountOnly", action="store_true",
+                        help="Print 'nQ;results;time;gao' like query-index instead of the results.")
+    args = parser.parse_args()
+
+    queries = open(args.Queries) if args.Queries else sys.stdin
+    client = RingClient(args.Socket)
+    try:
+        for nq, query in enumerate(q for q in queries if q.strip()):
+            on_row = None if args.CountOnly else (lambda row: print(" ".join(row)))
+            try:
+                variables, _, count, nanoseconds, gao = client.query(query, args.Results, args.Timeout, on_row)
+            except RuntimeError as e:
+                print("%d;error;%s" % (nq, e))
+                continue
+            if args.CountOnly:
+                print("%d;%d;%d;%s" % (nq, count, nanoseconds, gao))
+            else:
+                print("# %d results in %d ns (%s)" % (count, nanoseconds, " ".join(variables)))
+    finally:
+        client.close()
+
+
+if __name__ == "__main__":
+    main()
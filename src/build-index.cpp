@@ -22,9 +22,11 @@
 #include "ring.hpp"
 #include "reverse_ring.hpp"
 #include <fstream>
+#include <functional>
 #include <sdsl/construct.hpp>
 #include <ltj_algorithm.hpp>
 #include "crc_arrays.hpp"
+#include "dense_ids.hpp"
 
 using namespace std;
 
@@ -34,125 +36,310 @@ using timer = std::chrono::high_resolution_clock;
 typedef ring::ring<> ring_spo;
 typedef ring::reverse_ring<> ring_sop;
 typedef ring::c_ring cring_spo;
+typedef ring::c_reverse_ring cring_sop;
+typedef ring::rl_ring rlring_spo;
+typedef ring::rl_reverse_ring rlring_sop;
 typedef ring::crc_arrays<> crc_arrays;
-template<class ring, class crc_arrays>
-void build_index(const std::string &dataset, const std::string &output){
+typedef ring::rl_ring::crc_arrays_type rlcrc_arrays;
+namespace parallel = ring::parallel;
+namespace external = ring::external;
+typedef ring::binary_triples binary_triples;
+
+//! Column L from which the CRC arrays are built.
+template<class bv>
+const typename ring::bwt<bv>::bwt_type& crc_L(const ring::bwt<bv> &bwt){
+    return bwt.get_L();
+}
+
+//! The CRC arrays are queried with ranges of the whole column, not of the run heads, so they read the runs in order.
+template<class bv>
+typename ring::rl_bwt<bv>::column_reader crc_L(const ring::rl_bwt<bv> &bwt){
+    return bwt.column();
+}
+
+//! Reports the runs of the L columns of the run-length rings, which the order of the IDs (--order) lengthens.
+template<class ring_t>
+void report_runs(const ring_t &){}
+
+void report_runs(const rlring_spo &index){
+    std::cout << "  Runs of L (S, P, O): " << index.get_m_bwt_s().runs() << " " << index.get_m_bwt_p().runs()
+              << " " << index.get_m_bwt_o().runs() << std::endl;
+}
+
+void report_runs(const rlring_sop &index){
+    std::cout << "  Runs of L (S, P, O): " << index.get_m_bwt_s().runs() << " " << index.get_m_bwt_p().runs()
+              << " " << index.get_m_bwt_o().runs() << std::endl;
+}
+
+//! One of the two rings of the index (SPO or SOP), built by build_rings.
+struct ring_part {
+    std::string name;
+    std::function<void(uint64_t)> build;     // builds the ring with the given number of threads
+    std::function<uint64_t()> size;          // size of the ring in bytes
+    std::function<void()> report_runs;
+    std::function<void(uint64_t)> build_crc; // builds its CRC arrays with the given number of threads
+    std::function<void()> store;             // stores the ring and frees it
+};
+
+template<class ring_t, class crc_arrays>
+ring_part spo_part(ring_t &index, crc_arrays &crc_a, const std::string &output, const std::function<void(uint64_t)> &build){
+    return {"SPO", build,
+            [&index]() { return (uint64_t) sdsl::size_in_bytes(index); },
+            [&index]() { report_runs(index); },
+            [&index, &crc_a](const uint64_t threads) {
+                crc_a.build_spo_arrays(crc_L(index.get_m_bwt_s()), crc_L(index.get_m_bwt_p()), crc_L(index.get_m_bwt_o()), threads);
+            },
+            [&index, output]() { sdsl::store_to_file(index, output + ".spo"); index = ring_t(); }};
+}
+
+template<class reverse_ring_t, class crc_arrays>
+ring_part sop_part(reverse_ring_t &index, crc_arrays &crc_a, const std::string &output, const std::function<void(uint64_t)> &build){
+    return {"SOP", build,
+            [&index]() { return (uint64_t) sdsl::size_in_bytes(index); },
+            [&index]() { report_runs(index); },
+            [&index, &crc_a](const uint64_t threads) {
+                crc_a.build_sop_arrays(crc_L(index.get_m_bwt_s()), crc_L(index.get_m_bwt_o()), crc_L(index.get_m_bwt_p()), threads);
+            },
+            [&index, output]() { sdsl::store_to_file(index, output + ".sop"); index = reverse_ring_t(); }};
+}
+
+//! Builds the given rings concurrently, sharing 'threads' threads, then their CRC arrays, and stores the rings.
+template<class crc_arrays>
+void build_rings(const std::vector<ring_part> &parts, const crc_arrays &crc_a, const uint64_t threads){
+    std::string names = parts[0].name;
+    for (uint64_t i = 1; i < parts.size(); i++) names += " and " + parts[i].name;
+    const bool plural = parts.size() > 1;
+    //Every ring gets its share of the threads, at least one.
+    auto tasks = [&](const std::function<void(const ring_part &, uint64_t)> &f) {
+        std::vector<parallel::task_type> list;
+        for (uint64_t i = 0; i < parts.size(); i++) {
+            const uint64_t t = std::max<uint64_t>(1, threads / parts.size() + (i < threads % parts.size()));
+            list.push_back([&f, &parts, i, t]() { f(parts[i], t); });
+        }
+        return list;
+    };
+
+    std::cout << " Building the " << names << (plural ? " Indexes " : " Index ") << std::endl;
+
+    sdsl::memory_monitor::start();
+    auto start = timer::now();
+
+    parallel::run_tasks(tasks([](const ring_part &part, uint64_t t) { part.build(t); }), parts.size());
+
+    auto stop = timer::now();
+    sdsl::memory_monitor::stop();
+
+    uint64_t bytes = 0;
+    for (const auto &part : parts) bytes += part.size();
+    std::cout << (plural ? "  Indexes built  " : "  Index built  ") << bytes << " bytes" << std::endl;
+    for (const auto &part : parts) part.report_runs();
+    std::cout << duration_cast<seconds>(stop-start).count() << " seconds." << std::endl;
+    std::cout << sdsl::memory_monitor::peak() << " bytes." << std::endl;
+
+    sdsl::memory_monitor::start();
+    start = timer::now();
+
+    std::cout << "Building " << names << " crc arrays" << std::endl;
+    parallel::run_tasks(tasks([](const ring_part &part, uint64_t t) { part.build_crc(t); }), parts.size());
+
+    stop = timer::now();
+    sdsl::memory_monitor::stop();
+
+    std::cout << " CRC arrays built " << sdsl::size_in_bytes(crc_a) << " bytes" << std::endl;
+    std::cout << duration_cast<seconds>(stop-start).count() << " seconds." << std::endl;
+    std::cout << sdsl::memory_monitor::peak() << " bytes." << std::endl;
+
+    for (const auto &part : parts) part.store();
+    std::cout << (plural ? "Indexes saved" : "Index saved") << endl;
+}
+
+template<class ring_t, class reverse_ring_t, class crc_arrays>
+void build_index(const std::string &dataset, const std::string &output, const uint64_t threads, const bool dense,
+                 const ring::id_order_type order){
     std::vector<spo_triple> D, E;
 
     //1. Read the source file.
-    std::ifstream ifs(dataset);
-    uint64_t s, p , o;
-    do {
-        ifs >> s >> p >> o;
-        D.push_back(spo_triple(s, p, o));
-    } while (!ifs.eof());
+    if (binary_triples::is_binary(dataset)) {
+        binary_triples triples(dataset);
+        triples.copy_to(D);
+    } else {
+        binary_triples::read_text(dataset, [&D](const uint64_t s, const uint64_t p, const uint64_t o) {
+            D.push_back(spo_triple(s, p, o));
+        });
+    }
 
     D.shrink_to_fit();
+    if (dense) {
+        //Subjects and objects, and predicates, are remapped to 1..sigma of their role.
+        ring::dense_ids ids(D);
+        ids.reorder(D, order);
+        for (auto &t : D) t = ids.remap(t);
+        sdsl::store_to_file(ids, output + ".ids");
+        std::cout << "--Dense IDs: " << ids.so().size() << " subjects and objects, " << ids.p().size() << " predicates" << std::endl;
+    } else {
+        std::remove((output + ".ids").c_str());
+    }
+    std::cout << "--Using " << threads << " threads" << std::endl;
+    std::cout << "--Indexing " << D.size() << " triples" << std::endl;
 
-    //2. Building the Index SPO - OSP - POS (Cyclic)
+    //2. Building the Indexes SPO - OSP - POS and SOP - PSO - OPS (Cyclic).
+    //   With several threads both are built concurrently, which requires a second copy of the triples for the
+    //   SOP ring. Otherwise the triples of the SOP ring are obtained in place once the SPO ring is stored.
+    const bool concurrent = threads > 1;
+    if (concurrent) {
+        E.reserve(D.size());
+        for (const auto &t : D) E.push_back(spo_triple(std::get<0>(t), std::get<2>(t), std::get<1>(t)));
+    }
+    ring_t ring_spo;
+    reverse_ring_t ring_sop;
     crc_arrays crc_a;
-    {
-        std::cout << " Building the SPO Index " << std::endl;
-        std::cout << "--Indexing " << D.size() << " triples" << std::endl;
-
-        sdsl::memory_monitor::start();
-        auto start = timer::now();
-
-        ring_spo ring_spo(D);
-        
-        auto stop = timer::now();
-        sdsl::memory_monitor::stop();
-
-        std::cout << "  Index built  " << sdsl::size_in_bytes(ring_spo) << " bytes" << std::endl;
-        std::cout << duration_cast<seconds>(stop-start).count() << " seconds." << std::endl;
-        std::cout << sdsl::memory_monitor::peak() << " bytes." << std::endl;
-
-        sdsl::memory_monitor::start();
-        start = timer::now();
-        
-        std::cout << "Building SPO crc arrays" << std::endl;
-        crc_a.build_spo_arrays((ring_spo.get_m_bwt_s()).get_L(), (ring_spo.get_m_bwt_p()).get_L(), (ring_spo.get_m_bwt_o()).get_L() );
-        
-        stop = timer::now();
-        sdsl::memory_monitor::stop();
-        
-        std::cout << " CRC arrays built " << sdsl::size_in_bytes(crc_a) << " bytes" << std::endl;
-        std::cout << duration_cast<seconds>(stop-start).count() << " seconds." << std::endl;
-        std::cout << sdsl::memory_monitor::peak() << " bytes." << std::endl;
-        
-        sdsl::store_to_file(ring_spo, output+".spo");
-        std::cout << "Index saved" << endl;
+    auto spo = spo_part(ring_spo, crc_a, output, [&](const uint64_t t) {
+        ring_spo = ring_t(D, t);
+        if (concurrent) {
+            D.clear();
+            D.shrink_to_fit();
+        }
+    });
+    auto sop = sop_part(ring_sop, crc_a, output, [&](const uint64_t t) {
+        if (!concurrent) {
+            //Due to space efficiency spo is used to build sop ring.
+            for (auto &triple : D) triple = spo_triple(std::get<0>(triple), std::get<2>(triple), std::get<1>(triple));
+            E.swap(D);
+        }
+        ring_sop = reverse_ring_t(E, t);
+    });
+    if (concurrent) {
+        build_rings({spo, sop}, crc_a, threads);
+    } else {
+        build_rings({spo}, crc_a, 1);
+        build_rings({sop}, crc_a, 1);
     }
 
-    for (uint64_t i = 0; i < D.size(); i++){
-        auto& t = D[i];
-        auto s = std::get<0>(t);
-        auto p = std::get<1>(t);
-        auto o = std::get<2>(t);
-        //Due to space efficiency spo is used to build sop ring.
-        t = spo_triple(s, o, p);
-    }
+    sdsl::store_to_file(crc_a, output + ".crc");
+    std::cout << "CRC array saved" << endl;
+}
+
+//! Builds the index sorting the triples on disk, so that the sorting buffers use at most max_memory bytes.
+template<class ring_t, class reverse_ring_t, class crc_arrays>
+void build_index_external(const std::string &dataset, const std::string &output, const uint64_t max_memory, const bool dense,
+                          const ring::id_order_type order){
+    const std::string tmp_prefix = output + ".tmp";
 
-    //3. Building the reverse Index SOP - PSO - OPS (Cyclic)
-    {
-        std::cout << " Building the SOP Index " << std::endl;
-        std::cout << "--Indexing " << D.size() << " triples" << std::endl;
-
-        sdsl::memory_monitor::start();
-        auto start = timer::now();
-
-        ring_sop ring_sop(D);
-        D.clear();
-        
-        auto stop = timer::now();
-        sdsl::memory_monitor::stop();
-        
-        std::cout << "  Index built  " << sdsl::size_in_bytes(ring_sop) << " bytes" << std::endl;
-        std::cout << duration_cast<seconds>(stop-start).count() << " seconds." << std::endl;
-        std::cout << sdsl::memory_monitor::peak() << " bytes." << std::endl;
-
-        sdsl::memory_monitor::start();
-        start = timer::now();
-        
-        std::cout << "Building SOP crc arrays" << std::endl;
-        crc_a.build_sop_arrays(ring_sop.get_m_bwt_s().get_L(), ring_sop.get_m_bwt_o().get_L(), ring_sop.get_m_bwt_p().get_L());
-        
-        stop = timer::now();
-        sdsl::memory_monitor::stop();
-        
-        std::cout << " CRC arrays built " << sdsl::size_in_bytes(crc_a) << " bytes" << std::endl;
-        std::cout << duration_cast<seconds>(stop-start).count() << " seconds." << std::endl;
-        std::cout << sdsl::memory_monitor::peak() << " bytes." << std::endl;
-
-        sdsl::store_to_file(ring_sop, output+".sop");
-        std::cout << "Index saved" << endl;
+    //1. Read the source file into a binary file of triples, unless it already is one.
+    const bool is_binary = binary_triples::is_binary(dataset);
+    external::triple_file triples;
+    external::run_phase("Reading triples", [&]() {
+        if (is_binary) {
+            triples = external::triple_file::from_binary(dataset, max_memory);
+        } else {
+            triples = external::triple_file::from_text(dataset, tmp_prefix + ".triples", max_memory);
+        }
+    });
+    if (dense) {
+        ring::dense_ids ids;
+        external::run_phase("Remapping to dense IDs", [&]() {
+            auto dense_triples = external::to_dense_ids(triples, ids, tmp_prefix + ".dense", max_memory, order);
+            if (!is_binary) std::remove(triples.file().c_str());
+            triples = dense_triples;
+        });
+        sdsl::store_to_file(ids, output + ".ids");
+        std::cout << "--Dense IDs: " << ids.so().size() << " subjects and objects, " << ids.p().size() << " predicates" << std::endl;
+    } else {
+        std::remove((output + ".ids").c_str());
     }
+    std::cout << "--Indexing " << triples.size() << " triples within " << max_memory << " bytes" << std::endl;
+
+    //2. Building the Index SPO - OSP - POS (Cyclic), then the reverse Index SOP - PSO - OPS (Cyclic)
+    ring_t ring_spo;
+    reverse_ring_t ring_sop;
+    crc_arrays crc_a;
+    build_rings({spo_part(ring_spo, crc_a, output, [&](const uint64_t) {
+        ring_spo = ring_t(triples, max_memory, tmp_prefix);
+    })}, crc_a, 1);
+    build_rings({sop_part(ring_sop, crc_a, output, [&](const uint64_t) {
+        ring_sop = reverse_ring_t(triples.permuted(0, 2, 1), max_memory, tmp_prefix);
+    })}, crc_a, 1);
+    if (!is_binary || dense) std::remove(triples.file().c_str());
 
     sdsl::store_to_file(crc_a, output + ".crc");
     std::cout << "CRC array saved" << endl;
+}
 
+void print_usage(const char *name){
+    std::cout << "Usage: " << name << " <dataset> [ring|c-ring|rl-ring] [--threads N] [--max-memory <bytes>] [--dense-ids] [--order degree|bfs]" << std::endl;
+    std::cout << "  rl-ring (run-length compressed columns) is experimental." << std::endl;
 }
 
 int main(int argc, char **argv)
 {
 
-    if(argc != 3){
-        std::cout << "Usage: " << argv[0] << "<dataset> [ring|c-ring]" << std::endl;
+    if(argc < 3){
+        print_usage(argv[0]);
         return 0;
     }
 
     std::string dataset = argv[1];
     std::string type    = argv[2];
+    uint64_t threads = 1;
+    uint64_t max_memory = 0;
+    bool dense = false;
+    ring::id_order_type order = ring::rank_order;
+    for(int i = 3; i < argc; i++){
+        std::string option = argv[i];
+        if(option == "--threads" && i + 1 < argc){
+            threads = std::stoull(argv[++i]);
+            if(threads == 0) threads = parallel::hardware_threads();
+        }else if(option == "--max-memory" && i + 1 < argc){
+            max_memory = std::stoull(argv[++i]);
+        }else if(option == "--dense-ids"){
+            dense = true;
+        }else if(option == "--order" && i + 1 < argc){
+            std::string name = argv[++i];
+            if(name == "degree"){
+                order = ring::degree_order;
+            }else if(name == "bfs"){
+                order = ring::bfs_order;
+            }else{
+                print_usage(argv[0]);
+                return 0;
+            }
+            dense = true;
+        }else{
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    if(max_memory > 0 && order == ring::bfs_order){
+        std::cout << "--order bfs traverses the graph in memory, it cannot be used with --max-memory." << std::endl;
+        return 0;
+    }
+    if(max_memory > 0 && threads > 1){
+        std::cout << "--max-memory builds the index sequentially, --threads is ignored." << std::endl;
+    }
     if(type == "ring"){
         std::string index_name = dataset + ".ring";
-        build_index<ring_spo, crc_arrays>(dataset, index_name);
+        if(max_memory > 0){
+            build_index_external<ring_spo, ring_sop, crc_arrays>(dataset, index_name, max_memory, dense, order);
+        }else{
+            build_index<ring_spo, ring_sop, crc_arrays>(dataset, index_name, threads, dense, order);
+        }
     }else if (type == "c-ring"){
         std::string index_name = dataset + ".c-ring";
-        build_index<cring_spo, crc_arrays>(dataset, index_name);
+        if(max_memory > 0){
+            build_index_external<cring_spo, cring_sop, crc_arrays>(dataset, index_name, max_memory, dense, order);
+        }else{
+            build_index<cring_spo, cring_sop, crc_arrays>(dataset, index_name, threads, dense, order);
+        }
+    }else if (type == "rl-ring"){
+        std::string index_name = dataset + ".rl-ring";
+        if(max_memory > 0){
+            build_index_external<rlring_spo, rlring_sop, rlcrc_arrays>(dataset, index_name, max_memory, dense, order);
+        }else{
+            build_index<rlring_spo, rlring_sop, rlcrc_arrays>(dataset, index_name, threads, dense, order);
+        }
     }else{
-        std::cout << "Usage: " << argv[0] << "<dataset> [ring|c-ring]" << std::endl;
+        print_usage(argv[0]);
     }
 
     return 0;
 }
-
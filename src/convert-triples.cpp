@@ -0,0 +1,45 @@
+/*
+ * convert-triples.cpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <iostream>
+#include <chrono>
+#include "binary_triples.hpp"
+
+using namespace std::chrono;
+using timer = std::chrono::high_resolution_clock;
+
+int main(int argc, char **argv)
+{
+    if(argc != 3){
+        std::cout << "Usage: " << argv[0] << " <dataset> <binary-file>" << std::endl;
+        return 0;
+    }
+
+    std::string dataset = argv[1];
+    std::string output  = argv[2];
+
+    auto start = timer::now();
+    auto header = ring::binary_triples::convert(dataset, output);
+    auto stop = timer::now();
+
+    std::cout << header.n << " triples converted (max S = " << header.max_s << ", max P = " << header.max_p
+              << ", max O = " << header.max_o << ")" << std::endl;
+    std::cout << duration_cast<seconds>(stop-start).count() << " seconds." << std::endl;
+    return 0;
+}
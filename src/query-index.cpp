@@ -26,6 +26,7 @@
 #include <ltj_algorithm.hpp>
 #include <ltj_algorithm_spo_sop.hpp>
 #include <ltj_algorithm_spo_sop_leap.hpp>
+#include <query_engine.hpp>
 #include "utils.hpp"
 
 using namespace std;
@@ -58,208 +59,118 @@ bool get_file_content(string filename, vector<string> & vector_of_strings)
     return true;
 }
 
-std::string ltrim(const std::string &s)
-{
-    size_t start = s.find_first_not_of(' ');
-    return (start == std::string::npos) ? "" : s.substr(start);
-}
-
-std::string rtrim(const std::string &s)
-{
-    size_t end = s.find_last_not_of(' ');
-    return (end == std::string::npos) ? "" : s.substr(0, end + 1);
-}
-
-std::string trim(const std::string &s) {
-    return rtrim(ltrim(s));
-}
-
-std::vector<std::string> tokenizer(const std::string &input, const char &delimiter){
-    std::stringstream stream(input);
-    std::string token;
-    std::vector<std::string> res;
-    while(getline(stream, token, delimiter)){
-        res.emplace_back(trim(token));
-    }
-    return res;
-}
-
-bool is_variable(string & s)
-{
-    return (s.at(0) == '?');
-}
-
-uint8_t get_variable(string &s, std::unordered_map<std::string, uint8_t> &hash_table_vars){
-    auto var = s.substr(1);
-    auto it = hash_table_vars.find(var);
-    if(it == hash_table_vars.end()){
-        uint8_t id = hash_table_vars.size();
-        hash_table_vars.insert({var, id });
-        return id;
-    }else{
-        return it->second;
-    }
-}
-
-uint64_t get_constant(string &s){
-    return std::stoull(s);
-}
-
-ring::triple_pattern get_triple(string & s, std::unordered_map<std::string, uint8_t> &hash_table_vars) {
-    vector<string> terms = tokenizer(s, ' ');
-
-    ring::triple_pattern triple;
-    if(is_variable(terms[0])){
-        triple.var_s(get_variable(terms[0], hash_table_vars));
-    }else{
-        triple.const_s(get_constant(terms[0]));
-    }
-    if(is_variable(terms[1])){
-        triple.var_p(get_variable(terms[1], hash_table_vars));
-    }else{
-        triple.const_p(get_constant(terms[1]));
-    }
-    if(is_variable(terms[2])){
-        triple.var_o(get_variable(terms[2], hash_table_vars));
-    }else{
-        triple.const_o(get_constant(terms[2]));
-    }
-    return triple;
-}
-
 std::string get_type(const std::string &file){
     auto p = file.find_last_of('.');
     return file.substr(p+1);
 }
 
 template<class ring_type, class reverse_ring_type, class wm_type = sdsl::bit_vector>
-void query(const std::string &file, const std::string &queries, uint64_t number_of_results = 1000, uint64_t timeout_in_millis = 600){
+void query(const std::string &file, const std::string &queries, uint64_t number_of_results = 1000, uint64_t timeout_seconds = 600,
+           uint64_t threads = 1, uint64_t query_threads = 1, bool count_only = false){
     vector<string> dummy_queries;
     bool result = get_file_content(queries, dummy_queries);
 
-    ring_type graph;
-    reverse_ring_type reverse_graph;
-    if(ring::util::configuration.is_verbose()){
-        cout << " Loading the index SPO..."; fflush(stdout);
-    }
-    sdsl::load_from_file(graph, file+".spo");
-    if(ring::util::configuration.is_verbose()){
-        std::cout << endl << " Index loaded " << sdsl::size_in_bytes(graph) << " bytes" << endl;
-    }
-    if(ring::util::configuration.uses_reverse_index()){
-        if(ring::util::configuration.is_verbose()){
-            std::cout << " Loading the index SOP..."; fflush(stdout);
-        }
-        sdsl::load_from_file(reverse_graph, file+".sop");
-        if(ring::util::configuration.is_verbose()){
-            std::cout << endl << " Index loaded " << sdsl::size_in_bytes(reverse_graph) << " bytes" << endl;
-        }
-    }
-    if(ring::util::configuration.uses_muthu()){
-        if(ring::util::configuration.is_verbose()){
-            std::cout << " Loading the wavelet matrices that support Muthukrishnan's Colored range counting algorithm." << std::endl;
-        }
-        graph.load_crc_arrays(file);
-    }
+    ring::query_engine<ring_type, reverse_ring_type, wm_type> engine;
+    engine.load(file);
 
     if(ring::util::configuration.is_verbose()){
-        std::cout << "Max number of results: " << number_of_results << " Timeout : " << timeout_in_millis << "." << std::endl;
+        std::cout << "Max number of results: " << number_of_results << " Timeout : " << timeout_seconds << "." << std::endl;
+        std::cout << "Threads: " << threads << " Threads per query: " << query_threads << std::endl;
     }
-    //graph.store_Ls();
-    std::ifstream ifs;
-    uint64_t nQ = 0;
-
-    high_resolution_clock::time_point start, stop;
-    double total_time = 0.0;
-    duration<double> time_span;
 
     if(result)
     {
-
-        int count = 1;
-        for (string& query_string : dummy_queries) {
-
-            //vector<Term*> terms_created;
-            //vector<Triple*> query;
-            std::unordered_map<std::string, uint8_t> hash_table_vars;
-            std::vector<ring::triple_pattern> query;
-            vector<string> tokens_query = tokenizer(query_string, '.');
-            for (string& token : tokens_query) {
-                auto triple_pattern = get_triple(token, hash_table_vars);
-                query.push_back(triple_pattern);
-            }
-
-            // vector<string> gao = get_gao(query);
-            // vector<string> gao = get_gao_min_opt(query, graph);
-            // cout << gao [0] << " - " << gao [1] << " - " << gao[2] << endl;
-
-            typedef std::vector<typename ring::ltj_algorithm<>::tuple_type> results_type;
-            results_type res;
-            start = high_resolution_clock::now();
-            if(ring::util::configuration.uses_reverse_index()){
-                if(ring::util::configuration.uses_leap()){
-                    ring::ltj_algorithm_spo_sop_leap<ring_type,reverse_ring_type, wm_type> ltj(&query, &graph, &reverse_graph);
-                    ltj.join(res, number_of_results, timeout_in_millis);
-
-                    stop = high_resolution_clock::now();
-                    time_span = duration_cast<microseconds>(stop - start);
-                    total_time = time_span.count();
-
-                    std::unordered_map<uint8_t, std::string> ht;
-                    for(const auto &p : hash_table_vars){
-                        ht.insert({p.second, p.first});
-                    }
-
-                    cout << nQ <<  ";" << res.size() << ";" << (unsigned long long)(total_time*1000000000ULL) << ";"<< ltj.get_gao(ht) << endl;
+        //Number of results, time and gao of every query, kept in input order whatever the order in which they finish.
+        //A query that cannot be parsed or evaluated keeps its error instead, and the other ones go on.
+        struct query_outcome {
+            uint64_t results;
+            unsigned long long time;
+            std::string gao;
+            std::string error;
+            bool unsupported = false; // the query is valid, but the index cannot evaluate it
+        };
+        std::vector<query_outcome> outcomes(dummy_queries.size());
+
+        //The index is shared by all the queries, but every query builds its own algorithm and iterators.
+        auto run_query = [&](const uint64_t nQ){
+            try{
+                ring::bgp_query query = ring::query_parser::parse(dummy_queries[nQ]);
+                //Only the number of results is printed, so they are counted instead of kept.
+                ring::count_sink res;
+                uint64_t count = 0;
+                high_resolution_clock::time_point start = high_resolution_clock::now();
+                if(count_only){
+                    outcomes[nQ].gao = engine.count(query, count, timeout_seconds * 1000, query_threads);
                 }else{
-                    ring::ltj_algorithm_spo_sop<ring_type,reverse_ring_type, wm_type> ltj(&query, &graph, &reverse_graph);
-                    ltj.join(res, number_of_results, timeout_in_millis);
-
-                    stop = high_resolution_clock::now();
-                    time_span = duration_cast<microseconds>(stop - start);
-                    total_time = time_span.count();
-
-                    std::unordered_map<uint8_t, std::string> ht;
-                    for(const auto &p : hash_table_vars){
-                        ht.insert({p.second, p.first});
-                    }
-
-                    cout << nQ <<  ";" << res.size() << ";" << (unsigned long long)(total_time*1000000000ULL) << ";"<< ltj.get_gao(ht) << endl;
+                    outcomes[nQ].gao = engine.join(query, res, number_of_results, timeout_seconds * 1000, query_threads);
+                    count = res.count();
                 }
+                high_resolution_clock::time_point stop = high_resolution_clock::now();
+                duration<double> time_span = duration_cast<microseconds>(stop - start);
+                double total_time = time_span.count();
+                outcomes[nQ].results = count;
+                outcomes[nQ].time = (unsigned long long)(total_time*1000000000ULL);
+            }catch(const ring::unsupported_query &e){
+                outcomes[nQ].error = e.what();
+                outcomes[nQ].unsupported = true;
+            }catch(const std::exception &e){
+                outcomes[nQ].error = e.what();
             }
-            else{
-                ring::ltj_algorithm<ring_type> ltj(&query, &graph);
-                ltj.join(res, number_of_results, timeout_in_millis);
-
-                stop = high_resolution_clock::now();
-                time_span = duration_cast<microseconds>(stop - start);
-                total_time = time_span.count();
-
-                std::unordered_map<uint8_t, std::string> ht;
-                for(const auto &p : hash_table_vars){
-                    ht.insert({p.second, p.first});
-                }
-
-                cout << nQ <<  ";" << res.size() << ";" << (unsigned long long)(total_time*1000000000ULL) << ";"<< ltj.get_gao(ht) << endl;
+        };
+        auto print_query = [&](const uint64_t nQ){
+            if(!outcomes[nQ].error.empty()){
+                cout << nQ << (outcomes[nQ].unsupported ? ";unsupported;" : ";error;") << outcomes[nQ].error << endl;
+                return;
             }
+            cout << nQ <<  ";" << outcomes[nQ].results << ";" << outcomes[nQ].time << ";"<< outcomes[nQ].gao << endl;
+        };
 
-            
-            nQ++;
-
-            // cout << std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count() << std::endl;
-
-            //cout << "RESULTS QUERY " << count << ": " << number_of_results << endl;
-            count += 1;
+        if(threads <= 1){
+            for (uint64_t nQ = 0; nQ < dummy_queries.size(); ++nQ) {
+                run_query(nQ);
+                print_query(nQ);
+            }
+        }else{
+            //Every worker takes the next pending query, so long queries do not hold back the others.
+            std::vector<ring::parallel::task_type> tasks;
+            for (uint64_t nQ = 0; nQ < dummy_queries.size(); ++nQ) {
+                tasks.push_back([&run_query, nQ](){ run_query(nQ); });
+            }
+            ring::parallel::run_tasks(tasks, threads);
+            for (uint64_t nQ = 0; nQ < dummy_queries.size(); ++nQ) {
+                print_query(nQ);
+            }
         }
-
     }
 }
 
 int main(int argc, char* argv[])
 {
     //typedef ring::c_ring ring_type;
-    if(argc < 3 || argc > 8){
-        std::cout << "Usage: " << argv[0] << "<index> <queries> "+ ring::util::configuration.get_configuration_options() << std::endl;
+    //'--threads N', '--query-threads N' and '--count' may appear anywhere, the remaining arguments are positional.
+    uint64_t threads = 1;
+    uint64_t query_threads = 1;
+    bool count_only = false;
+    int positional = 1;
+    for(int i = 1; i < argc; ++i){
+        if(std::string(argv[i]) == "--count"){
+            count_only = true;
+            continue;
+        }
+        if(std::string(argv[i]) == "--threads" && i + 1 < argc){
+            threads = std::stoull(argv[++i]);
+            if(threads == 0) threads = ring::parallel::hardware_threads();
+        }else if(std::string(argv[i]) == "--query-threads" && i + 1 < argc){
+            query_threads = std::stoull(argv[++i]);
+            if(query_threads == 0) query_threads = ring::parallel::hardware_threads();
+        }else{
+            argv[positional++] = argv[i];
+        }
+    }
+    argc = positional;
+    argv[argc] = nullptr;
+    if(argc < 3 || argc > 9){
+        std::cout << "Usage: " << argv[0] << "<index> <queries> "+ ring::util::configuration.get_configuration_options() << " [--threads N] [--query-threads N] [--count]" << std::endl;
         return 0;
     }
 
@@ -289,17 +200,29 @@ int main(int argc, char* argv[])
     if(argc >= 7 && argv[7]){
         timeout = std::stoull(argv[7]);
     }
+    std::string load_mode = "file";
+    if(argc >= 8 && argv[8]){
+        load_mode = argv[8];
+    }
     ring::util::configuration.configure(mode, print_gao, verbose);
+    ring::util::configuration.set_load_mode(load_mode);
     //print configuration.
     ring::util::configuration.print_configuration();
 
     //Starting quering the index.
-    if(type == "ring"){
-        query<ring::ring<>, ring::reverse_ring<>>(index, queries, number_of_results, timeout);
-    }else if (type == "c-ring"){
-        query<ring::c_ring, ring::c_reverse_ring, sdsl::rrr_vector<15>>(index, queries, number_of_results, timeout);
-    }else{
-        std::cout << "Type of index: " << type << " is not supported." << std::endl;
+    try{
+        if(type == "ring"){
+            query<ring::ring<>, ring::reverse_ring<>>(index, queries, number_of_results, timeout, threads, query_threads, count_only);
+        }else if (type == "c-ring"){
+            query<ring::c_ring, ring::c_reverse_ring, sdsl::rrr_vector<15>>(index, queries, number_of_results, timeout, threads, query_threads, count_only);
+        }else if (type == "rl-ring"){
+            query<ring::rl_ring, ring::rl_reverse_ring>(index, queries, number_of_results, timeout, threads, query_threads, count_only);
+        }else{
+            std::cout << "Type of index: " << type << " is not supported." << std::endl;
+        }
+    }catch(const std::exception &e){
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
 
 
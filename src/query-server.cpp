@@ -0,0 +1,333 @@
+/*
+ * query-server.cpp
+ * Copyright (C) 2022, Fabrizio
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Loads the index once and answers queries with a line protocol, read from stdin/stdout or from the
+ * connections of a Unix domain socket (one thread per connection, whose queries run concurrently).
+ *
+ * Request (one line):  [limit=<n>] [timeout=<seconds> | timeout_ms=<milliseconds>] [count | page=<n>] ?x1 353 ?x2 . ?x2 7 ?x3
+ * Response:            OK ?x1 ?x2 ?x3                 (variables, in order of appearance or of SELECT)
+ *                      <x1> <x2> <x3>                 (one line per result, streamed)
+ *                      ...
+ *                      END <results> <nanoseconds> <gao>
+ *                  or  ERROR <message>
+ *                  or  UNSUPPORTED <message>       (valid query that the index cannot evaluate)
+ * With "count" no result is written, only their number (COUNT(*)).
+ * With "page=<n>" only the first n results are written and the response ends with MORE instead of END
+ * while there are more results. The request "[timeout=...] next" writes the next page of the last query
+ * of the connection, without the OK line, resuming the search where it paused. The limit is ignored.
+ * The query can project some variables: SELECT ?x1 ?x3 WHERE { ?x1 353 ?x2 . ?x2 7 ?x3 } (distinct results).
+ * The line "quit" closes the connection.
+ */
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <query_engine.hpp>
+#include "utils.hpp"
+
+using namespace std::chrono;
+
+struct server_options {
+    std::string socket_path;
+    uint64_t number_of_results = 1000;
+    uint64_t timeout = 600;
+    uint64_t query_threads = 1;
+};
+
+static std::string socket_path;
+
+void remove_socket(int){
+    if(!socket_path.empty()){
+        unlink(socket_path.c_str());
+    }
+    _exit(0);
+}
+
+//! Writes the values of some variables of the results of a request, separated by spaces, and counts them.
+struct response_sink : public ring::result_sink {
+    FILE *out;
+    std::vector<uint64_t> columns;
+    uint64_t count = 0;
+
+    response_sink(FILE *out, const std::vector<uint64_t> &columns) : out(out), columns(columns) {}
+
+    bool push(const value_type *row) override {
+        ++count;
+        for(uint64_t i = 0; i < columns.size(); ++i){
+            if(i > 0) fputc(' ', out);
+            fprintf(out, "%llu", (unsigned long long) row[columns[i]]);
+        }
+        return fputc('\n', out) != EOF;
+    }
+};
+
+//! Query of a connection whose results are written a page at a time.
+struct paged_query {
+    std::unique_ptr<ring::query_cursor> cursor;
+    std::vector<uint64_t> columns;
+    uint64_t page = 0;
+};
+
+//! Writes the next page of the paged query of a connection.
+void answer_page(paged_query &paged, const uint64_t timeout_millis, FILE *out){
+    response_sink res(out, paged.columns);
+    ring::cancellation_token token(timeout_millis);
+    high_resolution_clock::time_point start = high_resolution_clock::now();
+    paged.cursor->next_batch(res, paged.page, &token);
+    high_resolution_clock::time_point stop = high_resolution_clock::now();
+    fprintf(out, "%s %lu %llu %s\n", paged.cursor->done() ? "END" : "MORE", (unsigned long) res.count,
+            (unsigned long long) duration_cast<nanoseconds>(stop - start).count(),
+            ring::query_parser::trim(paged.cursor->gao()).c_str());
+    if(paged.cursor->done()){
+        paged.cursor.reset();
+    }
+}
+
+template<class engine_type>
+void answer(const engine_type &engine, const std::string &request, const server_options &options,
+            paged_query &paged, FILE *out){
+    uint64_t number_of_results = options.number_of_results;
+    uint64_t timeout_millis = options.timeout * 1000;
+    uint64_t page = 0;
+    bool count_only = false;
+    std::string query_string = ring::query_parser::trim(request);
+    //Options precede the query.
+    while(query_string.compare(0, 6, "limit=") == 0 || query_string.compare(0, 8, "timeout=") == 0
+          || query_string.compare(0, 11, "timeout_ms=") == 0 || query_string.compare(0, 6, "count ") == 0
+          || query_string.compare(0, 5, "page=") == 0){
+        auto end = query_string.find(' ');
+        std::string option = query_string.substr(0, end);
+        if(option == "count"){
+            count_only = true;
+        }else if(option[0] == 'p'){
+            page = std::stoull(option.substr(option.find('=') + 1));
+            if(page == 0) throw std::invalid_argument("the size of a page must be positive");
+        }else if(option[0] == 'l'){
+            number_of_results = std::stoull(option.substr(option.find('=') + 1));
+        }else if(option.compare(0, 11, "timeout_ms=") == 0){
+            timeout_millis = std::stoull(option.substr(option.find('=') + 1));
+        }else{
+            timeout_millis = std::stoull(option.substr(option.find('=') + 1)) * 1000;
+        }
+        query_string = (end == std::string::npos) ? "" : ring::query_parser::trim(query_string.substr(end));
+    }
+    if(query_string == "next"){
+        if(!paged.cursor) throw std::invalid_argument("there is no paged query");
+        answer_page(paged, timeout_millis, out);
+        return;
+    }
+    ring::bgp_query query = ring::query_parser::parse(query_string);
+    //Before the header, so an unsupported query is answered with a single line.
+    engine.check(query);
+
+    auto ht = query.variable_names();
+    std::vector<uint64_t> columns(query.projection.begin(), query.projection.end());
+    if(columns.empty()){
+        for(uint64_t v = 0; v < query.number_of_variables(); ++v){
+            columns.push_back(v);
+        }
+    }
+    std::string line = "OK";
+    for(uint64_t v : columns){
+        line += " ?" + ht[v];
+    }
+    fprintf(out, "%s\n", line.c_str());
+    if(page > 0 && !count_only){
+        //The previous paged query of the connection, if any, is discarded.
+        paged.cursor = engine.open(query);
+        paged.columns = columns;
+        paged.page = page;
+        answer_page(paged, timeout_millis, out);
+        return;
+    }
+    //Results are written in the order of the header, whatever the order of the GAO was, as soon as they are found.
+    response_sink res(out, columns);
+    uint64_t count = 0;
+    high_resolution_clock::time_point start = high_resolution_clock::now();
+    std::string gao;
+    if(count_only){
+        gao = engine.count(query, count, timeout_millis, options.query_threads);
+    }else{
+        gao = engine.join(query, res, number_of_results, timeout_millis, options.query_threads);
+        count = res.count;
+    }
+    high_resolution_clock::time_point stop = high_resolution_clock::now();
+    fprintf(out, "END %lu %llu %s\n", (unsigned long) count,
+            (unsigned long long) duration_cast<nanoseconds>(stop - start).count(), ring::query_parser::trim(gao).c_str());
+}
+
+//! Answers the requests read from 'in' until the end of the stream or "quit".
+template<class engine_type>
+void session(const engine_type &engine, const server_options &options, FILE *in, FILE *out){
+    char *buffer = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    paged_query paged;
+    while((length = getline(&buffer, &capacity, in)) != -1){
+        std::string request(buffer, length);
+        while(!request.empty() && (request.back() == '\n' || request.back() == '\r')){
+            request.pop_back();
+        }
+        request = ring::query_parser::trim(request);
+        if(request.empty()) continue;
+        if(request == "quit") break;
+        try{
+            answer(engine, request, options, paged, out);
+        }catch(const ring::unsupported_query &e){
+            fprintf(out, "UNSUPPORTED %s\n", e.what());
+        }catch(const std::exception &e){
+            fprintf(out, "ERROR %s\n", e.what());
+        }
+        if(fflush(out) != 0) break;
+    }
+    free(buffer);
+}
+
+template<class engine_type>
+int serve_socket(const engine_type &engine, const server_options &options){
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(server < 0){
+        perror("socket");
+        return 1;
+    }
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(options.socket_path.size() >= sizeof(address.sun_path)){
+        std::cerr << "Socket path " << options.socket_path << " is too long." << std::endl;
+        return 1;
+    }
+    strncpy(address.sun_path, options.socket_path.c_str(), sizeof(address.sun_path) - 1);
+    unlink(options.socket_path.c_str());
+    if(bind(server, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(server, SOMAXCONN) < 0){
+        perror("bind");
+        return 1;
+    }
+    socket_path = options.socket_path;
+    signal(SIGINT, remove_socket);
+    signal(SIGTERM, remove_socket);
+    std::cerr << "Listening on " << options.socket_path << std::endl;
+    while(true){
+        int client = accept(server, nullptr, nullptr);
+        if(client < 0){
+            if(errno == EINTR) continue;
+            perror("accept");
+            break;
+        }
+        std::thread([&engine, &options, client](){
+            FILE *in = fdopen(client, "r");
+            FILE *out = fdopen(dup(client), "w");
+            if(in != nullptr && out != nullptr){
+                session(engine, options, in, out);
+            }
+            if(out != nullptr) fclose(out);
+            if(in != nullptr) fclose(in); else close(client);
+        }).detach();
+    }
+    close(server);
+    unlink(options.socket_path.c_str());
+    return 1;
+}
+
+template<class ring_type, class reverse_ring_type, class wm_type = sdsl::bit_vector>
+int serve(const std::string &file, const server_options &options){
+    ring::query_engine<ring_type, reverse_ring_type, wm_type> engine;
+    high_resolution_clock::time_point start = high_resolution_clock::now();
+    engine.load(file);
+    std::cerr << "Index loaded in " << duration_cast<milliseconds>(high_resolution_clock::now() - start).count()
+              << " ms. Default limit: " << options.number_of_results << " Default timeout: " << options.timeout << "." << std::endl;
+    if(options.socket_path.empty()){
+        session(engine, options, stdin, stdout);
+        return 0;
+    }
+    return serve_socket(engine, options);
+}
+
+void print_usage(const char *program){
+    std::cout << "Usage: " << program << " <index> [--socket <path>] [--mode <execution_mode>] [--limit N] [--timeout T] [--load file|mapped-read] [--query-threads N]" << std::endl;
+    std::cout << "Without --socket the requests are read from stdin and answered on stdout." << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2){
+        print_usage(argv[0]);
+        return 0;
+    }
+    std::string index = argv[1];
+    std::string mode = "";
+    std::string load_mode = "file";
+    server_options options;
+    for(int i = 2; i < argc; ++i){
+        std::string arg = argv[i];
+        if(i + 1 >= argc){
+            print_usage(argv[0]);
+            return 1;
+        }
+        if(arg == "--socket"){
+            options.socket_path = argv[++i];
+        }else if(arg == "--mode"){
+            mode = argv[++i];
+        }else if(arg == "--limit"){
+            options.number_of_results = std::stoull(argv[++i]);
+        }else if(arg == "--timeout"){
+            options.timeout = std::stoull(argv[++i]);
+        }else if(arg == "--query-threads"){
+            options.query_threads = std::stoull(argv[++i]);
+            if(options.query_threads == 0) options.query_threads = ring::parallel::hardware_threads();
+        }else if(arg == "--load"){
+            load_mode = argv[++i];
+        }else{
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    //Nothing but responses is written on stdout.
+    ring::util::configuration.configure(mode, false, false);
+    ring::util::configuration.set_load_mode(load_mode);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string type = index.substr(index.find_last_of('.') + 1);
+    try{
+        if(type == "ring"){
+            return serve<ring::ring<>, ring::reverse_ring<>>(index, options);
+        }else if (type == "c-ring"){
+            return serve<ring::c_ring, ring::c_reverse_ring, sdsl::rrr_vector<15>>(index, options);
+        }else if (type == "rl-ring"){
+            return serve<ring::rl_ring, ring::rl_reverse_ring>(index, options);
+        }else{
+            std::cout << "Type of index: " << type << " is not supported." << std::endl;
+        }
+    }catch(const std::exception &e){
+        std::cerr << e.what() << std::endl;
+    }
+    return 1;
+}
@@ -0,0 +1,101 @@
+
+/*! \file test_ltj_batches.cpp
+    \brief Checks that a join taken a batch at a time (start / next_batch) reports the same results as the full
+    join, also when the paused engine is moved or swapped between two batches.
+    \author Fabrizio Barisione
+*/
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include "ring.hpp"
+#include "reverse_ring.hpp"
+#include "ltj_algorithm.hpp"
+#include "ltj_algorithm_spo_sop.hpp"
+#include "ltj_algorithm_spo_sop_leap.hpp"
+#include "query_parser.hpp"
+#include "result_sink.hpp"
+
+typedef ring::ring<> ring_spo;
+typedef ring::reverse_ring<> ring_sop;
+typedef ring_spo::spo_triple_type spo_triple_type;
+
+//! Evaluates the query with every batch size, and compares the sorted results with the ones of the full join.
+template<class algorithm_t, class... rings_t>
+uint64_t check_query(const std::string &name, const std::string &query_string, const rings_t*... rings)
+{
+    typedef typename algorithm_t::tuple_type tuple_type;
+    ring::bgp_query query = ring::query_parser::parse(query_string);
+    std::vector<tuple_type> expected;
+    {
+        algorithm_t ltj(&query.patterns, rings...);
+        ltj.join(expected);
+    }
+    std::sort(expected.begin(), expected.end());
+
+    uint64_t errors = 0;
+    for (uint64_t batch : {1, 2, 7, 1000}) {
+        for (uint64_t mode = 0; mode < 3; ++mode) {
+            std::vector<tuple_type> res;
+            ring::tuple_sink<tuple_type> sink(res);
+            std::unique_ptr<algorithm_t> ltj(new algorithm_t(&query.patterns, rings...));
+            ltj->start();
+            for (uint64_t k = 1; !ltj->done(); ++k) {
+                if (ltj->next_batch(sink, batch) == 0) break;
+                if (k % 2 == 0) continue;
+                // The search goes on in another engine, which takes the state of the paused one.
+                if (mode == 1) {
+                    ltj.reset(new algorithm_t(std::move(*ltj)));
+                } else if (mode == 2) {
+                    std::unique_ptr<algorithm_t> other(new algorithm_t(&query.patterns, rings...));
+                    other->swap(*ltj);
+                    ltj = std::move(other);
+                }
+            }
+            std::sort(res.begin(), res.end());
+            if (res != expected) {
+                ++errors;
+                std::cout << "  " << name << " '" << query_string << "' batch = " << batch << ", mode = " << mode
+                          << ": " << res.size() << " results, expected " << expected.size() << std::endl;
+            }
+        }
+    }
+    return errors;
+}
+
+int main()
+{
+    std::cout << ">> Starting test_ltj_batches" << std::endl;
+    std::mt19937 gen(2022);
+    std::set<spo_triple_type> triples;
+    std::uniform_int_distribution<uint32_t> so(1, 60), p(1, 5);
+    while (triples.size() < 2000) {
+        triples.insert(spo_triple_type(so(gen), p(gen), so(gen)));
+    }
+    std::vector<spo_triple_type> D(triples.begin(), triples.end());
+    std::vector<spo_triple_type> E;
+    for (const auto &t : D) E.push_back(spo_triple_type(std::get<0>(t), std::get<2>(t), std::get<1>(t)));
+    ring_spo graph(D);
+    ring_sop reverse_graph(E);
+
+    const std::vector<std::string> queries = {
+        "?x 1 ?y",
+        "?x 1 ?y . ?y 2 ?z",
+        "?x 1 ?y . ?y 2 ?z . ?z 3 ?x",
+        "?x 4 ?y . ?x 5 ?y",
+        "7 ?p ?y . ?y 1 ?z",
+        "?x 2 ?y . ?x 3 ?z . ?x 4 ?w",
+        "?x 99 ?y . ?y 1 ?z"
+    };
+    uint64_t errors = 0;
+    for (const auto &q : queries) {
+        errors += check_query<ring::ltj_algorithm<ring_spo>>("ltj_algorithm", q, &graph);
+        errors += check_query<ring::ltj_algorithm_spo_sop<ring_spo, ring_sop>>("ltj_algorithm_spo_sop", q,
+                                                                              &graph, &reverse_graph);
+        errors += check_query<ring::ltj_algorithm_spo_sop_leap<ring_spo, ring_sop>>("ltj_algorithm_spo_sop_leap", q,
+                                                                                   &graph, &reverse_graph);
+    }
+    std::cout << (errors ? ">> test_ltj_batches FAILED" : ">> test_ltj_batches OK") << std::endl;
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+
+/*! \file test_ring_construction.cpp
+    \brief Checks that the L columns and C arrays of a ring built by radix sorting the triples are the same as
+    the ones of the suffix array construction (3n text of the triples + qsufsort).
+    \author Fabrizio Barisione
+*/
+#include <array>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include "ring.hpp"
+
+typedef ring::ring<> ring_spo;
+typedef ring_spo::spo_triple_type spo_triple_type;
+
+//! A column of the ring as built from the suffix array: L and C.
+struct reference_bwt {
+    sdsl::int_vector<> L;
+    std::vector<uint64_t> C;
+};
+
+//! C array of a column whose F column holds the values counted in M, with values in [1, sigma].
+std::vector<uint64_t> reference_C(const std::map<uint64_t, uint64_t> &M, uint64_t sigma, uint64_t n)
+{
+    std::vector<uint64_t> C;
+    uint64_t cur_pos = 1;
+    C.push_back(0); // Dummy value
+    C.push_back(cur_pos);
+    for (uint64_t c = 2; c <= sigma; c++) {
+        auto it = M.find(c - 1);
+        cur_pos += (it == M.end()) ? 0 : it->second;
+        C.push_back(cur_pos);
+    }
+    C.push_back(n + 1);
+    return C;
+}
+
+//! Builds the columns O, S and P of the ring as the suffix array construction did.
+void build_reference(std::vector<spo_triple_type> D, reference_bwt &O, reference_bwt &S, reference_bwt &P)
+{
+    uint64_t n = D.size(), max_s = 0, max_p = 0, max_o = 0;
+    std::map<uint64_t, uint64_t> M_S, M_P, M_O;
+    for (const auto &t : D) {
+        max_s = std::max<uint64_t>(max_s, std::get<0>(t));
+        max_p = std::max<uint64_t>(max_p, std::get<1>(t));
+        max_o = std::max<uint64_t>(max_o, std::get<2>(t));
+        ++M_S[std::get<0>(t)];
+        ++M_P[std::get<1>(t)];
+        ++M_O[std::get<2>(t)];
+    }
+    uint64_t alphabet_SO = (max_s < max_o) ? max_o : max_s;
+    std::sort(D.begin(), D.end());
+
+    sdsl::int_vector<> t(3 * n + 2);
+    for (uint64_t i = 0; i < n; i++) {
+        t[3 * i] = std::get<0>(D[i]);
+        t[3 * i + 1] = std::get<1>(D[i]) + max_s;
+        t[3 * i + 2] = std::get<2>(D[i]) + max_s + max_p;
+    }
+    t[3 * n] = max_s + max_p + max_o + 1;
+    t[3 * n + 1] = 0;
+    sdsl::util::bit_compress(t);
+
+    sdsl::int_vector<> bwt_aux(3 * n);
+    {
+        sdsl::int_vector<> sa;
+        sdsl::qsufsort::construct_sa(sa, t);
+        for (uint64_t i = 0, j = 0; i < sa.size(); i++) {
+            if (sa[i] >= 3 * n) continue;
+            bwt_aux[j++] = (sa[i] == 0) ? t[t.size() - 3] : t[sa[i] - 1];
+        }
+    }
+
+    uint64_t i, j;
+    O.L = sdsl::int_vector<>(n + 1);
+    O.L[0] = 0;
+    for (i = 1, j = 1; i < n; i++)
+        O.L[j++] = bwt_aux[i] - (max_s + max_p);
+    O.L[j] = bwt_aux[0] - (max_s + max_p);
+    O.C = reference_C(M_S, alphabet_SO, n);
+
+    S.L = sdsl::int_vector<>(n + 1);
+    S.L[0] = 0;
+    for (j = 1; i < 2 * n; i++)
+        S.L[j++] = bwt_aux[i];
+    S.C = reference_C(M_P, max_p, n);
+
+    P.L = sdsl::int_vector<>(n + 1);
+    P.L[0] = 0;
+    for (j = 1; i < 3 * n; i++)
+        P.L[j++] = bwt_aux[i] - max_s;
+    P.C = reference_C(M_O, alphabet_SO, n);
+}
+
+//! Compares a column of the ring with its reference. Returns the number of differences.
+template<class t_bwt>
+uint64_t compare(const std::string &name, const t_bwt &bwt, const reference_bwt &ref)
+{
+    uint64_t errors = 0;
+    const auto &L = bwt.get_L();
+    if (L.size() != ref.L.size()) {
+        std::cout << "  " << name << ": |L| = " << L.size() << " expected " << ref.L.size() << std::endl;
+        return 1;
+    }
+    for (uint64_t i = 0; i < L.size(); i++) {
+        if (L[i] != ref.L[i]) {
+            if (errors++ < 5)
+                std::cout << "  " << name << ": L[" << i << "] = " << L[i] << " expected " << ref.L[i] << std::endl;
+        }
+    }
+    for (uint64_t c = 1; c < ref.C.size(); c++) {
+        if (bwt.get_C(c) != ref.C[c]) {
+            if (errors++ < 5)
+                std::cout << "  " << name << ": C[" << c << "] = " << bwt.get_C(c) << " expected " << ref.C[c] << std::endl;
+        }
+    }
+    return errors;
+}
+
+int main()
+{
+    std::cout << ">> Starting test_ring_construction" << std::endl;
+    std::mt19937 gen(2022);
+    // Small alphabets, alphabets over 16 bits (two radix passes) and S, P, O of different sizes.
+    const std::vector<std::array<uint32_t, 4>> configs = {
+        {{1, 1, 1, 1}}, {{20, 5, 3, 5}}, {{500, 40, 7, 40}}, {{5000, 200000, 30, 100}}, {{5000, 100, 100000, 300000}}
+    };
+    uint64_t errors = 0;
+    for (const auto &cfg : configs) {
+        std::set<spo_triple_type> triples;
+        std::uniform_int_distribution<uint32_t> s(1, cfg[1]), p(1, cfg[2]), o(1, cfg[3]);
+        for (uint32_t k = 0; k < cfg[0]; k++) {
+            triples.insert(spo_triple_type(s(gen), p(gen), o(gen)));
+        }
+        std::vector<spo_triple_type> D(triples.begin(), triples.end());
+        std::shuffle(D.begin(), D.end(), gen);
+
+        reference_bwt O, S, P;
+        build_reference(D, O, S, P);
+        for (uint64_t threads : {1, 3}) {
+            std::vector<spo_triple_type> D_ring = D;
+            ring_spo graph(D_ring, threads);
+            uint64_t e = compare("bwt_o", graph.get_m_bwt_o(), O)
+                         + compare("bwt_s", graph.get_m_bwt_s(), S)
+                         + compare("bwt_p", graph.get_m_bwt_p(), P);
+            std::cout << "  n = " << D.size() << ", threads = " << threads << ": "
+                      << (e ? "FAILED" : "OK") << std::endl;
+            errors += e;
+        }
+    }
+    std::cout << (errors ? ">> test_ring_construction FAILED" : ">> test_ring_construction OK") << std::endl;
+    return errors ? 1 : 0;
+}
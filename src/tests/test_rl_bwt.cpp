@@ -0,0 +1,110 @@
+
+/*! \file test_rl_bwt.cpp
+    \brief Checks the operations of the run-length BWT (rl_bwt) against the ones of bwt on the same L column,
+    and that the CRC arrays built from both columns are the same.
+    \author Fabrizio Barisione
+*/
+#include <array>
+#include <iostream>
+#include <random>
+#include "bwt.hpp"
+#include "rl_bwt.hpp"
+#include "crc_array.hpp"
+
+typedef ring::bwt<> bwt_type;
+typedef ring::rl_bwt<> rl_bwt_type;
+
+uint64_t errors = 0;
+
+void check(bool ok, const std::string &what, uint64_t a, uint64_t b)
+{
+    if (!ok && errors++ < 10) {
+        std::cout << "  " << what << " differs at (" << a << ", " << b << ")" << std::endl;
+    }
+}
+
+int main()
+{
+    std::cout << ">> Starting test_rl_bwt" << std::endl;
+    std::mt19937_64 gen(2022);
+    // {n, sigma, maximum run length}: from no runs at all to long runs.
+    const std::vector<std::array<uint64_t, 3>> configs = {
+        {{1, 1, 1}}, {{100, 3, 1}}, {{1000, 20, 8}}, {{5000, 300, 50}}, {{5000, 5000, 3}}
+    };
+    for (const auto &cfg : configs) {
+        const uint64_t n = cfg[0], sigma = cfg[1];
+        // L[0] = 0 as in the columns of the ring, the rest in [1, sigma].
+        sdsl::int_vector<> L(n + 1);
+        L[0] = 0;
+        for (uint64_t i = 1; i <= n;) {
+            uint64_t v = 1 + gen() % sigma, run = 1 + gen() % cfg[2];
+            for (; run > 0 && i <= n; --run) L[i++] = v;
+        }
+        sdsl::util::bit_compress(L);
+        // C of a column with sigma symbols: C[1] = 1 and C[sigma + 1] = n + 1.
+        std::vector<uint64_t> C = {0, 1};
+        for (uint64_t c = 2; c <= sigma; c++) {
+            C.push_back(C.back() + gen() % (2 * n / sigma + 1));
+        }
+        for (auto &c : C) c = std::min(c, n + 1);
+        C.push_back(n + 1);
+
+        bwt_type bwt(L, C);
+        rl_bwt_type rl(L, C);
+        const auto &wm = bwt.get_L();
+
+        check(rl.size() == L.size(), "size", rl.size(), L.size());
+        auto column = rl.column();
+        for (uint64_t i = 0; i < L.size(); i++) {
+            check(rl.access(i) == wm[i], "access", i, 0);
+            check(column[i] == wm[i], "column", i, 0);
+            if (i > 0) check(rl.LF(i) == bwt.LF(i), "LF", i, 0);
+        }
+        for (uint64_t c = 1; c <= sigma + 1; c++) {
+            check(rl.get_C(c) == bwt.get_C(c), "get_C", c, 0);
+        }
+        for (uint64_t q = 0; q < 2000; q++) {
+            const uint64_t pos = gen() % (L.size() + 1), val = gen() % (sigma + 1);
+            check(rl.ranky(pos, val) == bwt.ranky(pos, val), "ranky", pos, val);
+            const uint64_t p = 1 + gen() % sigma;
+            check(rl.rank(p, val) == bwt.rank(p, val), "rank", p, val);
+            check(rl.rank_in_range(p, val) == bwt.rank_in_range(p, val), "rank_in_range", p, val);
+            // As the ring does, select_next is bounded by the occurrences of val.
+            const uint64_t occ = bwt.ranky(L.size(), val);
+            if (bwt.rank(p, val) < occ) {
+                check(rl.select_next(p, val, occ) == bwt.select_next(p, val, occ), "select_next", p, val);
+            }
+            if (occ > 0) {
+                const uint64_t k = 1 + gen() % occ;
+                check(rl.select(k, val) == bwt.select(k, val), "select", k, val);
+            }
+
+            uint64_t l = gen() % L.size(), r = gen() % L.size();
+            if (l > r) std::swap(l, r);
+            check(rl.backward_step(l, r, val) == bwt.backward_step(l, r, val), "backward_step", l, r);
+            check(rl.min_in_range(l, r) == bwt.min_in_range(l, r), "min_in_range", l, r);
+            check(rl.values_in_range(l, r) == bwt.values_in_range(l, r), "values_in_range", l, r);
+            check(rl.range_next_value(val, l, r) == bwt.range_next_value(val, l, r), "range_next_value", l, r);
+            // The cursors are used on ranges of different matrices (the heads of rl_bwt and L of bwt).
+            ring::wm_range_cursor rl_cursor, cursor;
+            for (uint64_t x = val; x <= sigma; x++) {
+                const uint64_t v = rl.range_next_value(x, l, r, rl_cursor);
+                check(v == bwt.range_next_value(x, l, r, cursor), "range_next_value with cursor", x, l);
+                if (v == 0) break;
+                x = v;
+            }
+        }
+
+        // The CRC arrays only read the column, so both have to be the same.
+        ring::crc<> crc_bwt(wm), crc_rl(rl.column());
+        for (uint64_t q = 0; q < 200; q++) {
+            uint64_t l = 1 + gen() % n, r = 1 + gen() % n;
+            if (l > r) std::swap(l, r);
+            check(crc_rl.get_number_distinct_values(l, r) == crc_bwt.get_number_distinct_values(l, r), "crc", l, r);
+        }
+        std::cout << "  n = " << L.size() << ", runs = " << rl.runs() << ", sigma = " << sigma << ": "
+                  << (errors ? "FAILED" : "OK") << std::endl;
+    }
+    std::cout << (errors ? ">> test_rl_bwt FAILED" : ">> test_rl_bwt OK") << std::endl;
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+
+/*! \file test_wm_range_cursor.cpp
+    \brief Checks range_next_value with a cursor and for_each_value_in_range of ring::wavelet_matrix against
+    range_next_value and all_values_in_range of sdsl::wm_int.
+    \author Fabrizio Barisione
+*/
+#include <iostream>
+#include <random>
+#include "configuration.hpp"
+#include "wavelet_matrix.hpp"
+
+typedef sdsl::wm_int<sdsl::bit_vector> sdsl_wm_type;
+typedef ring::wavelet_matrix<sdsl::bit_vector> wm_type;
+
+int main()
+{
+    std::cout << ">> Starting test_wm_range_cursor" << std::endl;
+    std::mt19937_64 gen(2022);
+    // Alphabets of one symbol, small ones and one of 20 bits; runs of equal values and random ones.
+    const std::vector<std::pair<uint64_t, uint64_t>> configs = {
+        {1, 1}, {50, 2}, {300, 7}, {2000, 64}, {2000, 1000}, {3000, 1ULL << 20}
+    };
+    uint64_t errors = 0, queries = 0;
+    for (const auto &cfg : configs) {
+        const uint64_t n = cfg.first, sigma = cfg.second;
+        sdsl::int_vector<> vec(n);
+        for (uint64_t i = 0; i < n;) {
+            uint64_t v = gen() % sigma, run = 1 + gen() % 4;
+            for (; run > 0 && i < n; --run) vec[i++] = v;
+        }
+        sdsl_wm_type sdsl_wm;
+        wm_type wm;
+        construct_im(sdsl_wm, vec);
+        construct_im(wm, vec);
+
+        // One cursor shared by all the ranges: it has to reset itself when the range changes.
+        ring::wm_range_cursor cursor;
+        const uint64_t limit = 1ULL << wm.max_level; // values are queried below it
+        for (uint64_t q = 0; q < 200; ++q) {
+            uint64_t l = gen() % n, r = gen() % n;
+            if (l > r) std::swap(l, r);
+
+            std::vector<uint64_t> values;
+            wm.for_each_value_in_range(l, r, [&values](const uint64_t v) { values.push_back(v); });
+            std::vector<uint64_t> expected = sdsl_wm.all_values_in_range(l, r);
+            if (values != expected) {
+                if (errors++ < 5)
+                    std::cout << "  for_each_value_in_range(" << l << ", " << r << ") differs" << std::endl;
+            }
+
+            // Increasing values as bwt_interval does, with some jumps over several values.
+            uint64_t x = (q % 2) ? gen() % limit : 0;
+            while (true) {
+                uint64_t v = wm.range_next_value(x, l, r, cursor);
+                uint64_t w = sdsl_wm.range_next_value(x, l, r);
+                ++queries;
+                if (v != w) {
+                    if (errors++ < 5)
+                        std::cout << "  range_next_value(" << x << ", " << l << ", " << r << ") = " << v
+                                  << " expected " << w << std::endl;
+                    break;
+                }
+                if (v == 0 && x > 0) break;
+                x = (gen() % 4) ? v + 1 : v + 1 + gen() % (sigma / 8 + 1);
+                if (x >= limit) break;
+            }
+            // Values below the previous answer, which are not on its path.
+            uint64_t y = gen() % limit;
+            if (wm.range_next_value(y, l, r, cursor) != sdsl_wm.range_next_value(y, l, r)) {
+                if (errors++ < 5)
+                    std::cout << "  range_next_value(" << y << ", " << l << ", " << r << ") after a larger value differs" << std::endl;
+            }
+        }
+        std::cout << "  n = " << n << ", sigma = " << sigma << ": " << (errors ? "FAILED" : "OK") << std::endl;
+    }
+    std::cout << "  " << queries << " calls to range_next_value" << std::endl;
+    std::cout << (errors ? ">> test_wm_range_cursor FAILED" : ">> test_wm_range_cursor OK") << std::endl;
+    return errors ? 1 : 0;
+}